@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Neptune/Board.hpp"
+#include "Neptune/Match.hpp"
+#include "Neptune/PackedPosition.hpp"
+
+// Records each thread collects before writing them out in one go
+#define WRITE_BUFFER_RECORDS 8192
+
+struct DatagenSettings {
+  std::string output = "data.bin";
+  uint64_t positions = 1000000;
+  int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  uint64_t nodes = 5000;
+  int randomPlies = 8;
+  uint64_t seed = 0;
+};
+
+void PrintUsage() {
+  std::cout << "Usage: NeptuneDatagen [options]\n"
+               "  -output <file>      records are appended here (default data.bin)\n"
+               "  -positions <n>      positions to write (default 1000000)\n"
+               "  -threads <n>        games played at once (default: all cores)\n"
+               "  -nodes <n>          nodes per move (default 5000)\n"
+               "  -randomplies <n>    random moves opening every game (default 8)\n"
+               "  -seed <n>           seed for the random openings (default: from the clock)\n";
+}
+
+bool ParseArguments(int argc, char **argv, DatagenSettings &settings) {
+  settings.seed = std::chrono::steady_clock::now().time_since_epoch().count();
+
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    bool hasValue = i + 1 < argc;
+
+    if (argument == "-output" && hasValue) {
+      settings.output = argv[++i];
+    } else if (argument == "-positions" && hasValue) {
+      settings.positions = std::strtoull(argv[++i], nullptr, 10);
+    } else if (argument == "-threads" && hasValue) {
+      settings.threads = std::max(1, std::atoi(argv[++i]));
+    } else if (argument == "-nodes" && hasValue) {
+      settings.nodes = std::strtoull(argv[++i], nullptr, 10);
+    } else if (argument == "-randomplies" && hasValue) {
+      settings.randomPlies = std::atoi(argv[++i]);
+    } else if (argument == "-seed" && hasValue) {
+      settings.seed = std::strtoull(argv[++i], nullptr, 10);
+    } else {
+      PrintUsage();
+      return false;
+    }
+  }
+  return true;
+}
+
+// Random legal moves from the starting position, so no two games are alike
+std::string RandomOpening(std::mt19937_64 &random, int plies) {
+  Board board;
+  board.Reset();
+  int color = WHITE;
+  std::string opening;
+
+  for (int ply = 0; ply < plies; ++ply) {
+    MoveList moves;
+    board.GenerateLegalMoves(color, moves);
+    if (moves.IsEmpty()) {
+      break;
+    }
+    Move move = moves[random() % moves.Size()];
+    board.MakeMove(move, color);
+    color = !color;
+    opening += move.ToAlgebraicNotation() + " ";
+  }
+  return opening;
+}
+
+int main(int argc, char **argv) {
+  DatagenSettings settings;
+  if (!ParseArguments(argc, argv, settings)) {
+    return 1;
+  }
+
+  FILE *output = std::fopen(settings.output.c_str(), "ab");
+  if (!output) {
+    std::cerr << "Can't open " << settings.output << std::endl;
+    return 1;
+  }
+
+  Board board;
+  board.InitMoves();
+
+  std::atomic<uint64_t> written{0};
+  std::atomic<uint64_t> games{0};
+  std::mutex outputMutex;
+  auto startTime = std::chrono::steady_clock::now();
+
+  auto worker = [&](int thread) {
+    std::mt19937_64 random(settings.seed + thread);
+    Searcher searchers[2];
+    searchers[WHITE].verbose = searchers[BLACK].verbose = false;
+
+    TimeControl timeControl;
+    timeControl.nodes = settings.nodes;
+
+    std::vector<PackedPosition> gameRecords;
+    std::vector<PackedPosition> buffer;
+    buffer.reserve(WRITE_BUFFER_RECORDS);
+
+    auto flush = [&]() {
+      std::lock_guard<std::mutex> lock(outputMutex);
+      std::fwrite(buffer.data(), sizeof(PackedPosition), buffer.size(), output);
+      buffer.clear();
+    };
+
+    while (written < settings.positions) {
+      gameRecords.clear();
+      int ply = settings.randomPlies;
+
+      // Quiet positions only: the score of a position in check or before a capture says little about it
+      auto record = [&](const Board &position, int color, const SearchResult &result) {
+        int positionPly = ply++;
+        if (std::abs(result.score) >= MATE_BOUND || position.IsInCheck(color)
+            || position.IsCapture(result.bestMove) || result.bestMove.promotionPiece != EMPTY) {
+          return;
+        }
+        PackedPosition packed = PackedPosition::FromBoard(position, color);
+        packed.score = color == WHITE ? result.score : -result.score;
+        packed.ply = positionPly;
+        gameRecords.push_back(packed);
+      };
+
+      // Every game from empty tables, as after ucinewgame
+      searchers[WHITE].table.Clear();
+      searchers[BLACK].table.Clear();
+      Game game = PlayGame(searchers[WHITE], searchers[BLACK], RandomOpening(random, settings.randomPlies), timeControl, record);
+
+      int8_t result = game.result == WHITE_WINS ? 1 : game.result == BLACK_WINS ? -1 : 0;
+      for (PackedPosition &packed : gameRecords) {
+        packed.result = result;
+        buffer.push_back(packed);
+        if (buffer.size() == WRITE_BUFFER_RECORDS) {
+          flush();
+        }
+      }
+
+      uint64_t total = written += gameRecords.size();
+      if (++games % 100 == 0) {
+        int64_t elapsed = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - startTime).count();
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::cout << "Games: " << games << " Positions: " << total << " Positions/hour: " << total * 3600 / (elapsed + 1) << std::endl;
+      }
+    }
+
+    flush();
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < settings.threads; ++i) {
+    threads.emplace_back(worker, i);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  std::fclose(output);
+  std::cout << "Wrote " << written << " positions from " << games << " games to " << settings.output << std::endl;
+  return 0;
+}
@@ -1,76 +1,989 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
 #include <string>
-#include <algorithm>
+#include <thread>
+#include <vector>
 
+#include "Neptune/BatchEval.hpp"
 #include "Neptune/Board.hpp"
+#include "Neptune/Cluster.hpp"
+#include "Neptune/MateSearch.hpp"
+#include "Neptune/Pgn.hpp"
+#include "Neptune/Search.hpp"
+#include "Neptune/Server.hpp"
+#include "Neptune/Syzygy.hpp"
+#include "Neptune/Trace.hpp"
 
-int main() {
-  Board board;
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Bench positions, as moves played from the starting position
+const char *benchPositions[] = {
+  "",
+  "e2e4 e7e5 g1f3 b8c6 f1b5 a7a6 b5a4 g8f6 e1g1 f8e7",
+  "d2d4 g8f6 c2c4 e7e6 b1c3 f8b4 e2e3 e8g8 f1d3 d7d5",
+  "e2e4 c7c5 g1f3 d7d6 d2d4 c5d4 f3d4 g8f6 b1c3 a7a6",
+  "c2c4 e7e5 b1c3 g8f6 g2g3 d7d5 c4d5 f6d5 f1g2 d5b6",
+  "e2e4 e7e6 d2d4 d7d5 b1c3 f8b4 e4e5 c7c5 a2a3 b4c3 b2c3 g8e7",
+};
+
+// Mate puzzles for matebench: a position, the moves of the mate asked for, and
+// whether there is one that short
+struct MatePuzzle {
+  const char *fen;
+  int moves;
+  bool mate;
+};
+
+// Mates from well known games and from self-play, checked with a full width
+// search to the depth of the mate, then mates asked for in fewer moves
+const MatePuzzle matePuzzles[] = {
+  {"r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 4 4", 1, true},
+  {"6k1/5ppp/8/8/8/8/8/R3K3 w - - 0 1", 1, true},
+  {"r2qkbnr/ppp2ppp/2np4/4N3/2B1P1b1/2N5/PPPP1PPP/R1BbK2R w KQkq - 0 6", 2, true},
+  {"8/8/8/8/8/8/k7/2K4R w - - 0 1", 2, true},
+  {"r1b3kr/ppp1Bp1p/1b6/n2P4/2p3q1/2Q2N2/P4PPP/RN2R1K1 w - - 1 0", 3, true},
+  {"r1b1k2B/pp1p4/3Qp1p1/5p2/2B2P2/2N4p/PK3NPP/3R3R w - - 0 1", 3, true},
+  {"3Bk2r/3np1bp/2Q3p1/P3N3/6P1/2pP4/P1P2P1P/R4K1R w - - 1 1", 3, true},
+  {"1k5q/rpR1Q2B/8/p2p4/P3P3/1P1P4/7P/2R4K w - - 0 1", 4, true},
+  {"rnb2b1r/p1Npnp1p/1p3qp1/2p1pk2/P7/1QP2PP1/1P1PP2P/R1B1KBNR w KQ - 13 1", 4, true},
+  {"2b1q3/rppp4/p4p1k/3B2p1/P4P2/6QP/RBPP2R1/5K2 w - - 0 1", 4, true},
+  {"3r3r/pk3p1p/2n5/5q2/8/P7/P2P1PRP/2Bn2K1 b - - 1 1", 4, true},
+  {"8/rp1R4/4p2k/4N3/3P3P/8/P5PK/R7 w - - 1 1", 4, true},
+  {"8/p3p3/8/1p6/4B3/2B3k1/RPK3PR/8 w - - 1 1", 4, true},
+  {"r5k1/p1p3p1/3p4/1b2p3/p7/P2P4/1qPKQ2r/8 b - - 5 1", 5, true},
+  {"5R2/p2R4/5pp1/k3p1p1/p5P1/8/P3PP2/2K5 w - - 0 1", 5, true},
+  {"8/8/1Q6/8/4P3/3P4/7K/k7 w - - 3 1", 5, true},
+  {"4k3/1r2Pp2/1p6/5K2/8/6P1/1P1b3r/2n5 b - - 1 1", 5, true},
+  {"6k1/6b1/3pp3/3n4/4q3/8/2P1PR1K/8 b - - 3 1", 5, true},
+  {"8/6p1/8/3r2P1/4nK2/8/6k1/8 b - - 18 1", 5, true},
+  {"r2qkbnr/ppp2ppp/2np4/4N3/2B1P1b1/2N5/PPPP1PPP/R1BbK2R w KQkq - 0 6", 1, false},
+  {"r1b3kr/ppp1Bp1p/1b6/n2P4/2p3q1/2Q2N2/P4PPP/RN2R1K1 w - - 1 0", 2, false},
+  {"8/8/1Q6/8/4P3/3P4/7K/k7 w - - 3 1", 4, false},
+  {"r1bqk2r/1pppbppp/p1n2n2/4p3/B3P3/5N2/PPPP1PPP/RNBQ1RK1 w kq - 4 6", 2, false},
+};
+
+// What the UCI options set beyond the search options
+struct EngineSettings {
+  int multiPV = 1;
+  size_t hashMegabytes = DEFAULT_HASH_MB;
+  bool largePages = true;
+  TraceWriter trace;  // open while TraceFile names a file
+  std::unique_ptr<ClusterCoordinator> cluster;  // go searches on its workers when set
+  std::unique_ptr<MateSearcher> mate;  // made by the first go mate
+};
+
+// position (startpos | fen <fen>) [moves ...]
+void SetPosition(std::istringstream &input, Board &board, int &currentPlayer, PositionHistory &history) {
   board.Reset();
-  board.InitMoves();
-  int currentPlayer = WHITE;
+  currentPlayer = WHITE;
+  history.Clear();
+
+  std::string token, fen;
+  input >> token;
+  if (token == "fen") {
+    while (input >> token && token != "moves") {
+      fen += token + " ";
+    }
+    if (!board.FromFEN(fen, currentPlayer)) {
+      std::cout << "info string invalid fen " << fen << std::endl;
+    }
+  } else {
+    while (input >> token && token != "moves") {
+    }
+  }
 
-  while (true) {
-    // Generate legal moves for the current player
-    auto moves = board.GenerateLegalMoves(currentPlayer);
-    
-    if (moves.empty()) {
-      std::cout << "Game over. " << (currentPlayer == WHITE ? "White" : "Black") << " has no legal moves." << std::endl;
+  while (input >> token) {
+    Move inputMove = Move::FromAlgebraicNotation(token);
+    AttackInfo attacks;
+    board.ComputeAttackInfo(currentPlayer, attacks);
+    if (!board.IsPseudoLegal(inputMove, currentPlayer) || !board.IsLegal(inputMove, currentPlayer, attacks)) {
+      std::cout << "info string illegal move " << token << std::endl;
       break;
     }
+    history.Push(board.GetKey());
+    board.MakeMove(inputMove, currentPlayer);
+    currentPlayer = (currentPlayer == WHITE) ? BLACK : WHITE;
+  }
+}
+
+// setoption name <name> value <value>
+void SetOption(std::istringstream &input, Searcher &searcher, EngineSettings &settings) {
+  std::string token, name, value;
 
-    std::cout << "Current board:" << std::endl;
-    board.Log();
-    std::cout << "Eval: " << board.EvaluateBoard() << std::endl;
+  input >> token;
+  while (input >> token && token != "value") {
+    name += (name.empty() ? "" : " ") + token;
+  }
+  std::getline(input >> std::ws, value);
 
-    // If it's White's turn, let the human decide
-    if (currentPlayer == WHITE) {
-      std::cout << "WHITE moves available:" << std::endl;
-      for (const auto& move : moves) {
-        std::cout << move.ToAlgebraicNotation() << " ";
+  if (name == "SyzygyPath") {
+    Syzygy::Init(value);
+  } else if (name == "Hash" || name == "LargePages") {
+    size_t megabytes = name == "Hash" ? std::max(1, std::atoi(value.c_str())) : settings.hashMegabytes;
+    bool largePages = name == "LargePages" ? value == "true" : settings.largePages;
+    if (searcher.table.Resize(megabytes, largePages)) {
+      settings.hashMegabytes = megabytes;
+      settings.largePages = largePages;
+    } else {
+      std::cout << "info string can't allocate " << megabytes << " MB for the hash table" << std::endl;
+    }
+  } else if (name == "SharedHash") {
+    // Every engine given the same name shares one table, sized by the first
+    // from its Hash. An empty name goes back to a table of this process alone.
+    if (value.empty() || value == "<empty>") {
+      if (searcher.table.IsShared()) {
+        searcher.table.Resize(settings.hashMegabytes, settings.largePages);
+      }
+    } else if (searcher.table.AttachShared(value, settings.hashMegabytes)) {
+      settings.hashMegabytes = std::max<size_t>(searcher.table.SizeInBytes() >> 20, 1);
+      std::cout << "info string shared hash " << value << ", " << settings.hashMegabytes << " MB, "
+                << searcher.table.AttachedProcesses() << " processes attached" << std::endl;
+    } else {
+      std::cout << "info string can't attach shared hash " << value << std::endl;
+    }
+  } else if (name == "ClusterWorkers") {
+    // Comma separated [host:]port of each worker, empty to search in this process again
+    settings.cluster.reset();
+    std::istringstream addresses(value == "<empty>" ? "" : value);
+    std::string address;
+    while (std::getline(addresses, address, ',')) {
+      if (!settings.cluster) {
+        settings.cluster.reset(new ClusterCoordinator());
       }
-      std::cout << std::endl;
+      if (!settings.cluster->Connect(address)) {
+        std::cout << "info string can't connect to cluster worker " << address << std::endl;
+      }
+    }
+    if (settings.cluster) {
+      std::cout << "info string searching on " << settings.cluster->WorkerCount() << " cluster workers" << std::endl;
+    }
+  } else if (name == "TraceFile") {
+    searcher.trace = nullptr;
+    settings.trace.Close();
+    if (!NP_TRACE) {
+      std::cout << "info string tracing needs a build with NP_TRACE=1" << std::endl;
+    } else if (!value.empty() && value != "<empty>") {
+      if (settings.trace.Open(value)) {
+        searcher.trace = settings.trace.AddThread();
+      } else {
+        std::cout << "info string can't create " << value << std::endl;
+      }
+    }
+  } else if (name == "MultiPV") {
+    settings.multiPV = std::clamp(std::atoi(value.c_str()), 1, MAX_MULTIPV);
+  } else {
+    searcher.options.Set(name, value == "true");
+  }
+}
 
-      std::string inputMoveStr;
-      std::cout << "Enter your move: ";
-      std::cin >> inputMoveStr;
+// go [depth <plies>] [nodes <count>] [movetime <ms>] [wtime <ms> btime <ms> [winc <ms> binc <ms>] [movestogo <n>]]
+//    [mate <moves>] [searchmoves <move> ...]
+// With mate the proof-number search looks for a mate in at most that many
+// moves first. When it finds none the usual search takes over, to the depth of
+// the mate unless a depth is given.
+void Go(std::istringstream &input, Searcher &searcher, EngineSettings &settings, Board &board, int currentPlayer,
+        const PositionHistory &history) {
+  SearchLimits limits;
+  limits.multiPV = settings.multiPV;
+  int64_t time[2] = {0, 0};
+  int64_t increment[2] = {0, 0};
+  int movesToGo = 30;
+  bool searchMoves = false;  // the moves after searchmoves run up to the next keyword
+  bool depthGiven = false;
+  int mateMoves = 0;
 
-      // Convert the input string to a Move object
-      Move inputMove = Move::FromAlgebraicNotation(inputMoveStr);
+  std::string token;
+  while (input >> token) {
+    if (token == "depth") {
+      input >> limits.depth;
+      depthGiven = true;
+    } else if (token == "mate") {
+      input >> mateMoves;
+    } else if (token == "nodes") {
+      input >> limits.nodes;
+    } else if (token == "movetime") {
+      input >> limits.moveTime;
+    } else if (token == "wtime") {
+      input >> time[WHITE];
+    } else if (token == "btime") {
+      input >> time[BLACK];
+    } else if (token == "winc") {
+      input >> increment[WHITE];
+    } else if (token == "binc") {
+      input >> increment[BLACK];
+    } else if (token == "movestogo") {
+      input >> movesToGo;
+    } else if (token == "searchmoves") {
+      searchMoves = true;
+    } else if (searchMoves && limits.searchMoves.Size() < MAX_MOVES) {
+      limits.searchMoves.Add(Move::FromAlgebraicNotation(token));
+    }
+  }
 
-      // Verify that the move is legal
-      if (std::find(moves.begin(), moves.end(), inputMove) != moves.end()) {
-        board.MakeMove(inputMove, currentPlayer);
-      } else {
-        std::cout << "Illegal move. Try again." << std::endl;
+  if (time[currentPlayer]) {
+    limits.moveTime = TimeForMove(time[currentPlayer], increment[currentPlayer], movesToGo);
+  }
+
+  if (mateMoves > 0) {
+    if (!settings.mate) {
+      settings.mate = std::make_unique<MateSearcher>();
+    }
+    auto mateStart = std::chrono::steady_clock::now();
+    MateResult mate = settings.mate->Search(board, currentPlayer, mateMoves, limits);
+    int64_t mateElapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - mateStart).count();
+    if (mate.status == MATE_PROVEN) {
+      std::cout << "bestmove " << mate.bestMove.ToAlgebraicNotation() << std::endl;
+      return;
+    }
+    std::cout << "info string " << (mate.status == MATE_DISPROVEN ? "no mate" : "found no mate") << " in "
+              << mateMoves << std::endl;
+    if (!depthGiven) {
+      limits.depth = std::min(2 * mateMoves - 1, MAX_PLY - 1);
+    }
+    // The search after it has what the mate search left of the time and nodes
+    if (limits.moveTime) {
+      limits.moveTime = std::max<int64_t>(limits.moveTime - mateElapsed, 1);
+    }
+    if (limits.nodes) {
+      limits.nodes = std::max<uint64_t>(limits.nodes - std::min(limits.nodes, mate.nodes), 1);
+    }
+  }
+
+  SearchResult result;
+  if (settings.cluster && settings.cluster->WorkerCount()) {
+    // The workers report nothing until they are done, so there is one info line per line at the end
+    result = settings.cluster->Search(board, currentPlayer, limits, history);
+    for (int line = 0; line < result.lineCount; ++line) {
+      std::cout << "info depth " << result.depth << " multipv " << line + 1 << " score ";
+      WriteScore(std::cout, result.lines[line].score);
+      std::cout << " nodes " << result.nodes << " pv " << result.lines[line].move.ToAlgebraicNotation() << std::endl;
+    }
+  } else {
+    result = searcher.Search(board, currentPlayer, limits, history);
+  }
+
+  if (result.bestMove.fromSquare == result.bestMove.toSquare) {
+    std::cout << "bestmove 0000" << std::endl;
+  } else {
+    std::cout << "bestmove " << result.bestMove.ToAlgebraicNotation() << std::endl;
+  }
+}
+
+// Searches the bench positions to a fixed depth, each from an empty table so the
+// node counts don't depend on the order. Returns the nodes searched and adds the
+// time spent searching, clearing the table left out, to searchTime.
+uint64_t RunBench(Searcher &searcher, const SearchLimits &limits, bool print, int64_t &searchTime) {
+  uint64_t totalNodes = 0;
+  searcher.verbose = false;
+
+  for (const char *moves : benchPositions) {
+    Board board;
+    int currentPlayer;
+    PositionHistory history;
+    std::istringstream position(std::string("startpos moves ") + moves);
+    SetPosition(position, board, currentPlayer, history);
+
+    searcher.table.Clear();
+    auto startTime = std::chrono::steady_clock::now();
+    SearchResult result = searcher.Search(board, currentPlayer, limits, history);
+    searchTime += std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+
+    totalNodes += result.nodes;
+    if (print) {
+      std::cout << "bestmove " << result.bestMove.ToAlgebraicNotation() << " score " << result.score << " nodes " << result.nodes << std::endl;
+    }
+  }
+
+  searcher.verbose = true;
+  return totalNodes;
+}
+
+// bench [depth]: fixed depth search over the bench positions, for comparing node counts and speed
+void Bench(std::istringstream &input, Searcher &searcher) {
+  SearchLimits limits;
+  limits.depth = 5;
+  input >> limits.depth;
+
+  int64_t elapsed = 0;
+  uint64_t totalNodes = RunBench(searcher, limits, true, elapsed);
+  std::cout << "Nodes searched: " << totalNodes << std::endl;
+  std::cout << "Nodes/second: " << totalNodes * 1000 / (elapsed + 1) << std::endl;
+}
+
+// hashbench [depth]: bench speed with 1, 4 and 16 GB tables, each on huge pages
+// and on small ones, to see what TLB misses cost. Sizes that can't be allocated
+// are skipped. The table is set back to the configured size afterwards.
+void HashBench(std::istringstream &input, Searcher &searcher, const EngineSettings &settings) {
+  SearchLimits limits;
+  limits.depth = 7;
+  input >> limits.depth;
+
+  for (size_t megabytes : {1024, 4096, 16384}) {
+    for (bool largePages : {true, false}) {
+      std::cout << "Hash " << megabytes << " MB";
+      if (!searcher.table.Resize(megabytes, largePages)) {
+        std::cout << ": can't allocate" << std::endl;
         continue;
       }
+      int64_t elapsed = 0;
+      uint64_t totalNodes = RunBench(searcher, limits, false, elapsed);
+      std::cout << ", " << PageTypeName(searcher.table.GetPageType())
+                << ": Nodes/second " << totalNodes * 1000 / (elapsed + 1) << std::endl;
+    }
+  }
+
+  searcher.table.Resize(settings.hashMegabytes, settings.largePages);
+}
+
+// evalbench [positions]: evaluation speed over positions from random games,
+// one board at a time through EvaluateBoard, then in batches with and
+// without SIMD. Each is checked against EvaluateBoard.
+void EvalBench(std::istringstream &input) {
+  size_t count = 100000;
+  input >> count;
+
+  std::vector<Board> boards;
+  boards.reserve(count);
+  std::mt19937_64 random(1070372);
+  MoveList moves;
+  while (boards.size() < count) {
+    Board board;
+    board.Reset();
+    int color = WHITE;
+    for (int ply = 0; ply < 120 && boards.size() < count; ++ply) {
+      board.GenerateLegalMoves(color, moves);
+      if (moves.IsEmpty()) {
+        break;
+      }
+      board.MakeMove(moves[random() % moves.Size()], color);
+      color = !color;
+      boards.push_back(board);
+    }
+  }
 
-    } else { // If it's Black's turn, let the engine decide
-      int bestMoveValue = 9999;
-      Move bestMove(-1, -1);
+  std::vector<int> expected(count), scores(count);
+  auto run = [&](const char *name, auto evaluate) {
+    const int passes = 20;
+    auto startTime = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; ++pass) {
+      evaluate();
+    }
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << name << ": " << count * passes * 1000000 / (elapsed + 1) << " positions/second"
+              << (scores == expected ? "" : ", wrong scores") << std::endl;
+  };
 
-      for (Move move : moves) {
-        Board tempBoard = board;
-        tempBoard.MakeMove(move, currentPlayer);
-        int moveValue = MiniMax(tempBoard, 4, true);  // Depth 3, and White's turn to move next
-        std::cout << moveValue << std::endl;
+  run("EvaluateBoard", [&]() {
+    for (size_t i = 0; i < count; ++i) {
+      expected[i] = scores[i] = boards[i].EvaluateBoard();
+    }
+  });
+  run("EvaluateBatchScalar", [&]() { EvaluateBatchScalar(boards, scores); });
+  if (HasSimdEvaluation()) {
+    run("EvaluateBatch (AVX2)", [&]() { EvaluateBatch(boards, scores); });
+  }
+}
+
+// matebench [nodes <count>]
+// Solves the mate puzzles with the proof-number search and with the usual one,
+// each from an empty table and with at most count nodes (5M by default). The
+// usual search has a mate once it reports one of the length asked for, and no
+// mate once it completed the depth of one without.
+void MateBench(std::istringstream &input, const SearchOptions &options) {
+  SearchLimits limits;
+  limits.nodes = 5000000;
+  std::string token;
+  while (input >> token) {
+    if (token == "nodes") {
+      input >> limits.nodes;
+    }
+  }
 
-        if (moveValue < bestMoveValue) {
-          bestMoveValue = moveValue;
-          bestMove = move;
+  MateSearcher mateSearcher;
+  mateSearcher.verbose = false;
+  Searcher searcher;
+  searcher.verbose = false;
+  searcher.options = options;
+
+  int solved[2] = {0, 0};
+  uint64_t totalNodes[2] = {0, 0};
+  int64_t totalTime[2] = {0, 0};
+  for (const MatePuzzle &puzzle : matePuzzles) {
+    Board board;
+    int color;
+    board.FromFEN(puzzle.fen, color);
+    int mateScore = MATE_SCORE - (2 * puzzle.moves - 1);
+
+    mateSearcher.Clear();
+    auto startTime = std::chrono::steady_clock::now();
+    MateResult mate = mateSearcher.Search(board, color, puzzle.moves, limits);
+    auto middleTime = std::chrono::steady_clock::now();
+
+    // Stopped as soon as it has the mate, the mate is also looked for past its depth
+    std::stop_source stop;
+    SearchLimits searchLimits = limits;
+    searchLimits.depth = puzzle.mate ? MAX_PLY - 1 : 2 * puzzle.moves - 1;
+    searchLimits.stop = stop.get_token();
+    bool foundMate = false;
+    searcher.progress = [&](const SearchProgress &progress) {
+      if (progress.score >= mateScore) {
+        foundMate = true;
+        stop.request_stop();
+      }
+    };
+    searcher.table.Clear();
+    SearchResult searched = searcher.Search(board, color, searchLimits);
+    auto endTime = std::chrono::steady_clock::now();
+    searcher.progress = nullptr;
+
+    bool mateRight = mate.status == (puzzle.mate ? MATE_PROVEN : MATE_DISPROVEN) && (!puzzle.mate || mate.moves == puzzle.moves);
+    bool searchRight = puzzle.mate ? foundMate : !foundMate && searched.depth >= searchLimits.depth;
+    int64_t mateElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(middleTime - startTime).count();
+    int64_t searchElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - middleTime).count();
+    solved[0] += mateRight;
+    solved[1] += searchRight;
+    totalNodes[0] += mate.nodes;
+    totalNodes[1] += searched.nodes;
+    totalTime[0] += mateElapsed;
+    totalTime[1] += searchElapsed;
+
+    std::cout << (puzzle.mate ? "mate in " : "no mate in ") << puzzle.moves << ": proof-number "
+              << (mateRight ? "" : "failed, ") << mate.nodes << " nodes " << mateElapsed << " ms, alpha-beta "
+              << (searchRight ? "" : "failed, ") << searched.nodes << " nodes " << searchElapsed << " ms" << std::endl;
+  }
+
+  int count = static_cast<int>(std::size(matePuzzles));
+  std::cout << "Proof-number: " << solved[0] << "/" << count << " solved, " << totalNodes[0] << " nodes, "
+            << totalTime[0] << " ms" << std::endl;
+  std::cout << "Alpha-beta: " << solved[1] << "/" << count << " solved, " << totalNodes[1] << " nodes, "
+            << totalTime[1] << " ms" << std::endl;
+  std::cout << "Nodes ratio: " << static_cast<double>(totalNodes[1]) / std::max<uint64_t>(totalNodes[0], 1)
+            << ", time ratio: " << static_cast<double>(totalTime[1] + 1) / (totalTime[0] + 1) << std::endl;
+}
+
+// Operand of an EPD operation, e.g. WAC.001 for: id "WAC.001";
+std::string EpdOperand(const std::string &operations, const std::string &opcode) {
+  std::istringstream input(operations);
+  std::string operation;
+  while (std::getline(input >> std::ws, operation, ';')) {
+    std::istringstream fields(operation);
+    std::string name, operand;
+    fields >> name;
+    if (name == opcode) {
+      std::getline(fields >> std::ws, operand);
+      if (operand.size() >= 2 && operand.front() == '"' && operand.back() == '"') {
+        operand = operand.substr(1, operand.size() - 2);
+      }
+      return operand;
+    }
+  }
+  return "";
+}
+
+// hashsave <file>
+void SaveHash(std::istringstream &input, const Searcher &searcher) {
+  std::string path;
+  input >> path;
+  if (!searcher.table.SaveSnapshot(path)) {
+    std::cout << "info string can't write " << path << std::endl;
+  }
+}
+
+// hashload <file> [verify]
+// The table takes the snapshot's size, the next Hash option drops it again
+void LoadHash(std::istringstream &input, Searcher &searcher, EngineSettings &settings) {
+  std::string path, token;
+  input >> path >> token;
+  if (!searcher.table.LoadSnapshot(path, token == "verify")) {
+    std::cout << "info string can't load " << path << std::endl;
+    return;
+  }
+  settings.hashMegabytes = std::max<size_t>(searcher.table.SizeInBytes() >> 20, 1);
+}
+
+// analyze <epd file> [depth <plies>] [nodes <count>] [movetime <ms>] [threads <n>] [multipv <lines>] [trace <file>]
+// Searches every position in the file, spread over the threads, and prints a
+// line per position as soon as it is done. Positions are read as they are
+// needed, so files of any size work. With multipv the best lines follow as
+// "multipv <n> <move> <score>". With trace (NP_TRACE builds) every thread
+// records its searches to the file.
+void Analyze(std::istringstream &input, const SearchOptions &options) {
+  std::string path;
+  input >> path;
+
+  SearchLimits limits;
+  limits.depth = 0;
+  int threadCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  std::string tracePath;
+
+  std::string token;
+  while (input >> token) {
+    if (token == "depth") {
+      input >> limits.depth;
+    } else if (token == "nodes") {
+      input >> limits.nodes;
+    } else if (token == "movetime") {
+      input >> limits.moveTime;
+    } else if (token == "threads") {
+      input >> threadCount;
+    } else if (token == "multipv") {
+      input >> limits.multiPV;
+    } else if (token == "trace") {
+      input >> tracePath;
+    }
+  }
+  if (!limits.depth) {
+    limits.depth = limits.nodes || limits.moveTime ? MAX_PLY - 1 : 8;
+  }
+
+  std::ifstream file(path);
+  if (!file) {
+    std::cout << "info string can't open " << path << std::endl;
+    return;
+  }
+
+  TraceWriter trace;
+  if (!tracePath.empty()) {
+    if (!NP_TRACE) {
+      std::cout << "info string tracing needs a build with NP_TRACE=1" << std::endl;
+    } else if (!trace.Open(tracePath)) {
+      std::cout << "info string can't create " << tracePath << std::endl;
+      return;
+    }
+  }
+
+  std::mutex inputMutex, outputMutex;
+  uint64_t nextIndex = 0;
+  std::atomic<uint64_t> positions{0}, totalNodes{0};
+  auto startTime = std::chrono::steady_clock::now();
+
+  auto worker = [&]() {
+    Searcher searcher;
+    searcher.verbose = false;
+    searcher.options = options;
+    if (trace.IsOpen()) {
+      searcher.trace = trace.AddThread();
+    }
+
+    std::string line;
+    while (true) {
+      uint64_t index;
+      {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        if (!std::getline(file, line)) {
+          break;
+        }
+        index = ++nextIndex;
+      }
+
+      // The first four fields are the position, operations follow
+      std::istringstream fields(line);
+      std::string fen, field, operations;
+      for (int i = 0; i < 4 && fields >> field; ++i) {
+        fen += (fen.empty() ? "" : " ") + field;
+      }
+      std::getline(fields >> std::ws, operations);
+      if (fen.empty()) {
+        continue;
+      }
+
+      Board board;
+      int color;
+      std::string id = EpdOperand(operations, "id");
+      std::ostringstream output;
+      output << index << " " << (id.empty() ? fen : id);
+
+      if (!board.FromFEN(fen, color)) {
+        output << " invalid position";
+      } else {
+        SearchResult result = searcher.Search(board, color, limits);
+        positions++;
+        totalNodes += result.nodes;
+
+        output << " bestmove " << (result.bestMove.fromSquare == result.bestMove.toSquare ? "0000" : result.bestMove.ToAlgebraicNotation());
+        output << " score ";
+        WriteScore(output, result.score);
+        output << " depth " << result.depth << " nodes " << result.nodes;
+        if (limits.multiPV > 1) {
+          for (int line = 0; line < result.lineCount; ++line) {
+            output << " multipv " << line + 1 << " " << result.lines[line].move.ToAlgebraicNotation() << " ";
+            WriteScore(output, result.lines[line].score);
+          }
         }
       }
 
-      // Make the best move for Black
-      std::cout << "Engine chooses move: " << bestMove.ToAlgebraicNotation() << std::endl;
-      board.MakeMove(bestMove, currentPlayer);
+      std::lock_guard<std::mutex> lock(outputMutex);
+      std::cout << output.str() << std::endl;
     }
+  };
 
-    // Switch the current player for the next turn
-    currentPlayer = (currentPlayer == WHITE) ? BLACK : WHITE;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < std::max(threadCount, 1); ++i) {
+    threads.emplace_back(worker);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
   }
+  trace.Close();
 
-  return 0;
+  int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+  std::cout << "Positions analyzed: " << positions << std::endl;
+  std::cout << "Nodes searched: " << totalNodes << std::endl;
+  std::cout << "Nodes/second: " << totalNodes * 1000 / (elapsed + 1) << std::endl;
 }
 
+// replay <pgn file> [output <pgn file>]
+// Plays through every game of the file, checking each move, and reports the
+// speed in games per second. With an output file the games are written back out.
+void Replay(std::istringstream &input) {
+  std::string path, token, outputPath;
+  input >> path;
+  while (input >> token) {
+    if (token == "output") {
+      input >> outputPath;
+    }
+  }
+
+  PgnReader reader;
+  if (!reader.Open(path)) {
+    std::cout << "info string can't open " << path << std::endl;
+    return;
+  }
+  FILE *output = outputPath.empty() ? nullptr : std::fopen(outputPath.c_str(), "wb");
+
+  PgnGame game;
+  PgnWriter writer;
+  uint64_t games = 0, plies = 0, errors = 0;
+  auto startTime = std::chrono::steady_clock::now();
+
+  while (reader.NextGame(game)) {
+    games++;
+    Board board;
+    int color;
+    if (!SetupGame(game, board, color)) {
+      errors++;
+      continue;
+    }
+
+    if (output) {
+      writer.BeginGame();
+      for (const PgnTag &tag : game.tags) {
+        writer.AddTag(tag.name, tag.value);
+      }
+    }
+
+    for (std::string_view san : game.moves) {
+      Move move;
+      if (!ParseSAN(board, color, san, move)) {
+        errors++;
+        break;
+      }
+      if (output) {
+        writer.AddMove(board, color, move);
+      }
+      board.MakeMove(move, color);
+      color = !color;
+      plies++;
+    }
+
+    if (output) {
+      writer.EndGame(game.result.empty() ? "*" : game.result);
+      // Write in large blocks
+      if (writer.Buffer().size() >= (1 << 20)) {
+        writer.Flush(output);
+      }
+    }
+  }
+
+  if (output) {
+    writer.Flush(output);
+    std::fclose(output);
+  }
+
+  int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+  std::cout << "Games: " << games << std::endl;
+  std::cout << "Plies: " << plies << std::endl;
+  std::cout << "Errors: " << errors << std::endl;
+  std::cout << "Games/second: " << games * 1000 / (elapsed + 1) << std::endl;
+}
+
+// server <port | unix:path> [threads <n>] [hash <mb>] [depth <plies>] [nodes <count>] [movetime <ms>] [budget <nodes>]
+// Serves analysis sessions over a local socket until a client sends shutdown.
+// The limits cap every request, the budget is per session.
+void Serve(std::istringstream &input, const SearchOptions &options) {
+  std::string address, token;
+  input >> address;
+  int threadCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  size_t hashMegabytes = DEFAULT_HASH_MB * threadCount;
+  SessionLimits limits;
+
+  while (input >> token) {
+    if (token == "threads") {
+      input >> threadCount;
+    } else if (token == "hash") {
+      input >> hashMegabytes;
+    } else if (token == "depth") {
+      input >> limits.depth;
+    } else if (token == "nodes") {
+      input >> limits.nodes;
+    } else if (token == "movetime") {
+      input >> limits.moveTime;
+    } else if (token == "budget") {
+      input >> limits.nodeBudget;
+    }
+  }
+
+  AnalysisPool pool(threadCount, hashMegabytes, options);
+  AnalysisServer server(pool, limits);
+  if (!server.Listen(address)) {
+    std::cout << "info string can't listen on " << address << std::endl;
+    return;
+  }
+  std::cout << "info string serving on " << address << " with " << threadCount << " threads" << std::endl;
+
+  auto startTime = std::chrono::steady_clock::now();
+  server.Run();
+
+  int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+  std::cout << "Positions analyzed: " << pool.PositionsAnalyzed() << std::endl;
+  std::cout << "Nodes searched: " << pool.NodesSearched() << std::endl;
+  std::cout << "Nodes/second: " << pool.NodesSearched() * 1000 / (elapsed + 1) << std::endl;
+}
+
+// clusterworker [host:]port [hash <mb>]
+// Searches for a coordinator, see the ClusterWorkers option, until one sends quit.
+// Without a host only connections from this machine are taken.
+void ClusterWork(std::istringstream &input, const SearchOptions &options) {
+  std::string address, token;
+  input >> address;
+  size_t hashMegabytes = DEFAULT_HASH_MB;
+  while (input >> token) {
+    if (token == "hash") {
+      input >> hashMegabytes;
+    }
+  }
+
+  ClusterWorker worker(hashMegabytes, options);
+  if (!worker.Listen(address)) {
+    std::cout << "info string can't listen on " << address << std::endl;
+    return;
+  }
+  std::cout << "info string cluster worker on port " << worker.Port() << std::endl;
+  worker.Run();
+}
+
+// clusterbench [workers <n>] [depth <plies>] [hash <mb>]
+// Starts n local worker processes (2 by default) and searches the bench
+// positions both in this process and on the cluster, every search from empty
+// tables. Speedup is the time of this process over that of the cluster,
+// efficiency the speedup per worker.
+void ClusterBench(std::istringstream &input, const SearchOptions &options) {
+#ifndef _WIN32
+  int workerCount = 2;
+  SearchLimits limits;
+  limits.depth = 8;
+  size_t hashMegabytes = DEFAULT_HASH_MB;
+  std::string token;
+  while (input >> token) {
+    if (token == "workers") {
+      input >> workerCount;
+    } else if (token == "depth") {
+      input >> limits.depth;
+    } else if (token == "hash") {
+      input >> hashMegabytes;
+    }
+  }
+
+  // Each worker tells its port through a pipe once it listens
+  std::cout << std::flush;
+  ClusterCoordinator cluster;
+  std::vector<pid_t> children;
+  for (int i = 0; i < std::max(workerCount, 1); ++i) {
+    int channel[2];
+    if (pipe(channel) == -1) {
+      break;
+    }
+    pid_t child = fork();
+    if (child == 0) {
+      ::close(channel[0]);
+      ClusterWorker worker(hashMegabytes, options);
+      int port = worker.Listen("0") ? worker.Port() : 0;
+      ssize_t written = write(channel[1], &port, sizeof(port));
+      ::close(channel[1]);
+      if (port && written == sizeof(port)) {
+        worker.Run();
+      }
+      _exit(0);
+    }
+    ::close(channel[1]);
+    int port = 0;
+    if (child == -1 || read(channel[0], &port, sizeof(port)) != sizeof(port) || !port
+        || !cluster.Connect(std::to_string(port))) {
+      std::cout << "info string can't start cluster worker " << i + 1 << std::endl;
+    }
+    ::close(channel[0]);
+    if (child != -1) {
+      children.push_back(child);
+    }
+  }
+
+  Searcher searcher;
+  searcher.verbose = false;
+  searcher.options = options;
+  searcher.table.Resize(hashMegabytes);
+
+  int64_t singleTime = 0, clusterTime = 0;
+  uint64_t singleNodes = 0, clusterNodes = 0;
+  for (const char *moves : benchPositions) {
+    Board board;
+    int currentPlayer;
+    PositionHistory history;
+    std::istringstream position(std::string("startpos moves ") + moves);
+    SetPosition(position, board, currentPlayer, history);
+
+    searcher.table.Clear();
+    auto startTime = std::chrono::steady_clock::now();
+    SearchResult single = searcher.Search(board, currentPlayer, limits, history);
+    auto middleTime = std::chrono::steady_clock::now();
+    SearchResult clustered = cluster.Search(board, currentPlayer, limits, history, true);
+    auto endTime = std::chrono::steady_clock::now();
+
+    int64_t singleElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(middleTime - startTime).count();
+    int64_t clusterElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - middleTime).count();
+    singleTime += singleElapsed;
+    clusterTime += clusterElapsed;
+    singleNodes += single.nodes;
+    clusterNodes += clustered.nodes;
+    std::cout << "single " << single.bestMove.ToAlgebraicNotation() << " " << singleElapsed << " ms " << single.nodes
+              << " nodes, cluster " << clustered.bestMove.ToAlgebraicNotation() << " " << clusterElapsed << " ms "
+              << clustered.nodes << " nodes" << std::endl;
+  }
+
+  double speedup = static_cast<double>(singleTime + 1) / (clusterTime + 1);
+  std::cout << "Single process: " << singleTime << " ms, " << singleNodes << " nodes" << std::endl;
+  std::cout << "Cluster of " << cluster.WorkerCount() << ": " << clusterTime << " ms, " << clusterNodes << " nodes, "
+            << cluster.EntriesExchanged() << " entries exchanged" << std::endl;
+  std::cout << "Node overhead: " << static_cast<double>(clusterNodes) / std::max<uint64_t>(singleNodes, 1) << std::endl;
+  std::cout << "Speedup: " << speedup << ", efficiency: " << speedup / std::max(cluster.WorkerCount(), 1)
+            << " (" << std::thread::hardware_concurrency() << " cores)" << std::endl;
+
+  cluster.Shutdown();
+  for (pid_t child : children) {
+    waitpid(child, nullptr, 0);
+  }
+#else
+  (void)input;
+  (void)options;
+  std::cout << "info string no cluster on this platform" << std::endl;
+#endif
+}
+
+int main(int argc, char **argv) {
+  Board board;
+  board.Reset();
+  board.InitMoves();
+  int currentPlayer = WHITE;
+  PositionHistory history;
+  Searcher searcher;
+  EngineSettings settings;
+
+  // Arguments are run as a single command, e.g. NeptuneEngine analyze suite.epd depth 10
+  std::string line;
+  for (int i = 1; i < argc; ++i) {
+    line += std::string(i > 1 ? " " : "") + argv[i];
+  }
+  bool fromArguments = argc > 1;
+
+  while (fromArguments || std::getline(std::cin, line)) {
+    std::istringstream input(line);
+    std::string command;
+    input >> command;
+
+    if (command == "uci") {
+      std::cout << "id name Neptune" << std::endl;
+      std::cout << "id author Olle Lukowski" << std::endl;
+      std::cout << "option name Hash type spin default " << DEFAULT_HASH_MB << " min 1 max 65536" << std::endl;
+      std::cout << "option name LargePages type check default true" << std::endl;
+      std::cout << "option name MultiPV type spin default 1 min 1 max " << MAX_MULTIPV << std::endl;
+      std::cout << "option name SyzygyPath type string default <empty>" << std::endl;
+      std::cout << "option name SharedHash type string default <empty>" << std::endl;
+      std::cout << "option name ClusterWorkers type string default <empty>" << std::endl;
+      if (NP_TRACE) {
+        std::cout << "option name TraceFile type string default <empty>" << std::endl;
+      }
+      std::cout << "option name NullMove type check default " << (NP_NULL_MOVE ? "true" : "false") << std::endl;
+      std::cout << "option name LMR type check default " << (NP_LMR ? "true" : "false") << std::endl;
+      std::cout << "option name ReverseFutility type check default " << (NP_REVERSE_FUTILITY ? "true" : "false") << std::endl;
+      std::cout << "option name Futility type check default " << (NP_FUTILITY ? "true" : "false") << std::endl;
+      std::cout << "option name LateMovePruning type check default " << (NP_LATE_MOVE_PRUNING ? "true" : "false") << std::endl;
+      std::cout << "option name CheckExtensions type check default " << (NP_CHECK_EXTENSIONS ? "true" : "false") << std::endl;
+      std::cout << "option name QuiescenceChecks type check default false" << std::endl;
+      std::cout << "uciok" << std::endl;
+    } else if (command == "isready") {
+      std::cout << "readyok" << std::endl;
+    } else if (command == "setoption") {
+      SetOption(input, searcher, settings);
+    } else if (command == "ucinewgame") {
+      // A shared table is still in use by the other engines
+      if (!searcher.table.IsShared()) {
+        searcher.table.Clear();
+      }
+      if (settings.mate) {
+        settings.mate->Clear();
+      }
+      board.Reset();
+      currentPlayer = WHITE;
+      history.Clear();
+    } else if (command == "position") {
+      SetPosition(input, board, currentPlayer, history);
+    } else if (command == "go") {
+      Go(input, searcher, settings, board, currentPlayer, history);
+    } else if (command == "bench") {
+      Bench(input, searcher);
+    } else if (command == "hashbench") {
+      HashBench(input, searcher, settings);
+    } else if (command == "evalbench") {
+      EvalBench(input);
+    } else if (command == "matebench") {
+      MateBench(input, searcher.options);
+    } else if (command == "hashsave") {
+      SaveHash(input, searcher);
+    } else if (command == "hashload") {
+      LoadHash(input, searcher, settings);
+    } else if (command == "analyze") {
+      Analyze(input, searcher.options);
+    } else if (command == "replay") {
+      Replay(input);
+    } else if (command == "server") {
+      Serve(input, searcher.options);
+    } else if (command == "clusterworker") {
+      ClusterWork(input, searcher.options);
+    } else if (command == "clusterbench") {
+      ClusterBench(input, searcher.options);
+    } else if (command == "d") {
+      board.Log();
+      std::cout << "Fen: " << board.ToFEN(currentPlayer) << std::endl;
+      std::cout << "Eval: " << board.EvaluateBoard() << std::endl;
+    } else if (command == "quit") {
+      break;
+    }
+
+    if (fromArguments) {
+      break;
+    }
+  }
+
+  return 0;
+}
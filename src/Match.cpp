@@ -0,0 +1,228 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Neptune/Board.hpp"
+#include "Neptune/Match.hpp"
+#include "Neptune/Syzygy.hpp"
+
+// Openings as moves from the starting position, each played with both colors
+const char *defaultOpenings[] = {
+  "e2e4 e7e5 g1f3 b8c6 f1b5 a7a6",
+  "e2e4 e7e5 g1f3 b8c6 f1c4 f8c5",
+  "e2e4 c7c5 g1f3 d7d6 d2d4 c5d4 f3d4 g8f6 b1c3",
+  "e2e4 c7c5 b1c3 b8c6 g2g3",
+  "e2e4 e7e6 d2d4 d7d5 b1c3 g8f6",
+  "e2e4 c7c6 d2d4 d7d5 e4e5 c8f5",
+  "e2e4 d7d6 d2d4 g8f6 b1c3 g7g6",
+  "d2d4 d7d5 c2c4 e7e6 b1c3 g8f6",
+  "d2d4 d7d5 c2c4 c7c6 g1f3 g8f6",
+  "d2d4 g8f6 c2c4 e7e6 b1c3 f8b4",
+  "d2d4 g8f6 c2c4 g7g6 b1c3 f8g7 e2e4 d7d6",
+  "d2d4 f7f5 g2g3 g8f6 f1g2 e7e6",
+  "c2c4 e7e5 b1c3 g8f6 g2g3",
+  "c2c4 c7c5 g1f3 b8c6 b1c3",
+  "g1f3 d7d5 g2g3 g8f6 f1g2",
+  "b2b3 e7e5 c1b2 b8c6",
+};
+
+struct MatchSettings {
+  int games = 100;
+  int concurrency = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  TimeControl timeControl;
+  SearchOptions options[2];
+  std::vector<std::string> openings;
+  bool useSPRT = false;
+  SPRT sprt;
+};
+
+void PrintUsage() {
+  std::cout << "Usage: NeptuneMatch [options]\n"
+               "  -games <n>               games to play (default 100)\n"
+               "  -concurrency <n>         games played at once (default: all cores)\n"
+               "  -nodes <n>               nodes per move\n"
+               "  -movetime <ms>           time per move\n"
+               "  -tc <ms>+<ms>            time per game plus increment\n"
+               "  -openings <file>         one opening per line, as moves from the starting position\n"
+               "  -engine1 <name=value,..> options of the first engine, e.g. LMR=false\n"
+               "  -engine2 <name=value,..> options of the second engine\n"
+               "  -sprt <elo0> <elo1> [alpha beta]  stop once the test accepts or rejects\n"
+               "  -syzygy <path>           tablebases for both engines\n";
+}
+
+bool ParseEngineOptions(const std::string &list, SearchOptions &options) {
+  std::istringstream input(list);
+  std::string option;
+  while (std::getline(input, option, ',')) {
+    size_t separator = option.find('=');
+    if (separator == std::string::npos || !options.Set(option.substr(0, separator), option.substr(separator + 1) == "true")) {
+      std::cerr << "Unknown engine option: " << option << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LoadOpenings(const std::string &path, std::vector<std::string> &openings) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Can't open " << path << std::endl;
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(file, line)) {
+    if (!line.empty() && line[0] != '#') {
+      openings.push_back(line);
+    }
+  }
+  return !openings.empty();
+}
+
+bool ParseArguments(int argc, char **argv, MatchSettings &settings) {
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    bool hasValue = i + 1 < argc;
+
+    if (argument == "-games" && hasValue) {
+      settings.games = std::atoi(argv[++i]);
+    } else if (argument == "-concurrency" && hasValue) {
+      settings.concurrency = std::max(1, std::atoi(argv[++i]));
+    } else if (argument == "-nodes" && hasValue) {
+      settings.timeControl.nodes = std::strtoull(argv[++i], nullptr, 10);
+    } else if (argument == "-movetime" && hasValue) {
+      settings.timeControl.moveTime = std::atoll(argv[++i]);
+    } else if (argument == "-tc" && hasValue) {
+      std::string value = argv[++i];
+      size_t plus = value.find('+');
+      settings.timeControl.base = std::atoll(value.substr(0, plus).c_str());
+      settings.timeControl.increment = plus == std::string::npos ? 0 : std::atoll(value.substr(plus + 1).c_str());
+    } else if (argument == "-openings" && hasValue) {
+      if (!LoadOpenings(argv[++i], settings.openings)) {
+        return false;
+      }
+    } else if ((argument == "-engine1" || argument == "-engine2") && hasValue) {
+      if (!ParseEngineOptions(argv[++i], settings.options[argument == "-engine2"])) {
+        return false;
+      }
+    } else if (argument == "-sprt" && i + 2 < argc) {
+      settings.useSPRT = true;
+      settings.sprt.elo0 = std::atof(argv[++i]);
+      settings.sprt.elo1 = std::atof(argv[++i]);
+      if (i + 2 < argc && argv[i + 1][0] != '-') {
+        settings.sprt.alpha = std::atof(argv[++i]);
+        settings.sprt.beta = std::atof(argv[++i]);
+      }
+    } else if (argument == "-syzygy" && hasValue) {
+      Syzygy::Init(argv[++i]);
+    } else {
+      PrintUsage();
+      return false;
+    }
+  }
+
+  if (!settings.timeControl.nodes && !settings.timeControl.moveTime && !settings.timeControl.base) {
+    settings.timeControl.nodes = 10000;
+  }
+  if (settings.openings.empty()) {
+    settings.openings.assign(std::begin(defaultOpenings), std::end(defaultOpenings));
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  MatchSettings settings;
+  if (!ParseArguments(argc, argv, settings)) {
+    return 1;
+  }
+
+  // The move tables are shared by every game, fill them before the threads start
+  Board board;
+  board.InitMoves();
+
+  MatchScore score;
+  std::mutex scoreMutex;
+  std::atomic<int> nextGame{0};
+  std::atomic<bool> finished{false};
+
+  // One game at a time per thread, each thread with its own pair of searchers
+  auto worker = [&]() {
+    Searcher engines[2];
+    for (int engine = 0; engine < 2; ++engine) {
+      engines[engine].verbose = false;
+      engines[engine].options = settings.options[engine];
+    }
+
+    int gameNumber;
+    while (!finished && (gameNumber = nextGame++) < settings.games) {
+      // Openings are played twice in a row, the first engine white in the first game
+      const std::string &opening = settings.openings[(gameNumber / 2) % settings.openings.size()];
+      bool firstIsWhite = gameNumber % 2 == 0;
+      Searcher &white = engines[firstIsWhite ? 0 : 1];
+      Searcher &black = engines[firstIsWhite ? 1 : 0];
+
+      // Every game from empty tables, as after ucinewgame, so the second game of
+      // a pair doesn't start from what the first left behind
+      white.table.Clear();
+      black.table.Clear();
+      Game game = PlayGame(white, black, opening, settings.timeControl);
+
+      std::lock_guard<std::mutex> lock(scoreMutex);
+      if (game.result == DRAWN) {
+        score.draws++;
+      } else if ((game.result == WHITE_WINS) == firstIsWhite) {
+        score.wins++;
+      } else {
+        score.losses++;
+      }
+
+      std::cout << "Game " << gameNumber + 1 << " (" << GameEndName(game.end) << ", " << game.plies << " plies)"
+                << " Score: " << score.wins << " - " << score.losses << " - " << score.draws
+                << " [" << std::fixed << std::setprecision(3) << score.Score() << "]"
+                << " Elo: " << std::setprecision(1) << score.Elo() << " +/- " << score.EloMargin();
+      if (settings.useSPRT) {
+        double llr = settings.sprt.LLR(score);
+        std::cout << " LLR: " << std::setprecision(2) << llr
+                  << " (" << settings.sprt.LowerBound() << ", " << settings.sprt.UpperBound() << ")";
+        if (!finished && (llr <= settings.sprt.LowerBound() || llr >= settings.sprt.UpperBound())) {
+          finished = true;
+        }
+      }
+      std::cout << std::endl;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < settings.concurrency; ++i) {
+    threads.emplace_back(worker);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  std::cout << "Finished " << score.Games() << " games: " << score.wins << " - " << score.losses << " - " << score.draws
+            << ", Elo " << std::fixed << std::setprecision(1) << score.Elo() << " +/- " << score.EloMargin() << std::endl;
+
+  if (settings.useSPRT) {
+    double llr = settings.sprt.LLR(score);
+    if (llr >= settings.sprt.UpperBound()) {
+      std::cout << "SPRT: H1 accepted" << std::endl;
+      return 0;
+    }
+    if (llr <= settings.sprt.LowerBound()) {
+      std::cout << "SPRT: H0 accepted" << std::endl;
+      return 2;
+    }
+    std::cout << "SPRT: inconclusive" << std::endl;
+    return 3;
+  }
+  return 0;
+}
@@ -0,0 +1,197 @@
+#include "AsyncEngine.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threadCount) {
+  for (int i = 0; i < std::max(threadCount, 1); ++i) {
+    threads.emplace_back(&ThreadPool::Worker, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  taskReady.notify_all();
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Post(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(std::move(task));
+  }
+  taskReady.notify_one();
+}
+
+void ThreadPool::Worker() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    taskReady.wait(lock, [this]() { return stopping || !tasks.empty(); });
+    if (tasks.empty()) {
+      return;
+    }
+    std::function<void()> task = std::move(tasks.front());
+    tasks.pop_front();
+
+    lock.unlock();
+    task();
+    lock.lock();
+  }
+}
+
+AsyncEngine::AsyncEngine(Executor executor, size_t hashMegabytes) : executor(std::move(executor)) {
+  if (!this->executor) {
+    ownPool = std::make_unique<ThreadPool>(1);
+    this->executor = ownPool->GetExecutor();
+  }
+  searcher.verbose = false;
+  searcher.table.Resize(hashMegabytes, true);
+
+  board.InitMoves();
+  board.Reset();
+}
+
+AsyncEngine::~AsyncEngine() {
+  Stop();
+  Wait();
+}
+
+bool AsyncEngine::SetPosition(const std::string &fen, const std::vector<std::string> &moves) {
+  Board newBoard;
+  int newColor = WHITE;
+  PositionHistory newHistory;
+  newBoard.Reset();
+  if (fen != "startpos" && !newBoard.FromFEN(fen, newColor)) {
+    return false;
+  }
+
+  for (const std::string &name : moves) {
+    Move move = Move::FromAlgebraicNotation(name);
+    AttackInfo attacks;
+    newBoard.ComputeAttackInfo(newColor, attacks);
+    if (!newBoard.IsPseudoLegal(move, newColor) || !newBoard.IsLegal(move, newColor, attacks)) {
+      return false;
+    }
+    newHistory.Push(newBoard.GetKey());
+    newBoard.MakeMove(move, newColor);
+    newColor = newColor == WHITE ? BLACK : WHITE;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  board = newBoard;
+  color = newColor;
+  history = newHistory;
+  return true;
+}
+
+void AsyncEngine::SetOptions(const SearchOptions &newOptions) {
+  std::lock_guard<std::mutex> lock(mutex);
+  options = newOptions;
+}
+
+std::future<SearchResult> AsyncEngine::Search(const SearchLimits &limits, ProgressFunction progress, std::stop_token stop) {
+  auto promise = std::make_shared<std::promise<SearchResult>>();
+  std::future<SearchResult> result = promise->get_future();
+
+  auto job = std::make_unique<Job>();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job->run = [this, promise, limits = limits, progress = std::move(progress), stop = std::move(stop), board = board,
+                color = color, history = history, options = options](std::stop_source source) mutable {
+      // The caller's token and Stop both end the search through the job's own
+      std::stop_callback link(stop, [&source]() { source.request_stop(); });
+      limits.stop = source.get_token();
+      searcher.options = options;
+      searcher.progress = std::move(progress);
+      SearchResult searched = searcher.Search(board, color, limits, history);
+      searcher.progress = nullptr;
+      promise->set_value(searched);
+    };
+  }
+  Enqueue(std::move(job));
+  return result;
+}
+
+std::future<bool> AsyncEngine::ResizeHash(size_t megabytes) {
+  auto promise = std::make_shared<std::promise<bool>>();
+  std::future<bool> result = promise->get_future();
+
+  auto job = std::make_unique<Job>();
+  job->run = [this, promise, megabytes](std::stop_source) { promise->set_value(searcher.table.Resize(megabytes, true)); };
+  Enqueue(std::move(job));
+  return result;
+}
+
+std::future<void> AsyncEngine::NewGame() {
+  auto promise = std::make_shared<std::promise<void>>();
+  std::future<void> result = promise->get_future();
+
+  auto job = std::make_unique<Job>();
+  job->run = [this, promise](std::stop_source) {
+    // A table shared with other processes is theirs too
+    if (!searcher.table.IsShared()) {
+      searcher.table.Clear();
+    }
+    promise->set_value();
+  };
+  Enqueue(std::move(job));
+  return result;
+}
+
+void AsyncEngine::Stop() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (running) {
+    running->stop.request_stop();
+  }
+  for (const std::unique_ptr<Job> &job : queue) {
+    job->stop.request_stop();
+  }
+}
+
+void AsyncEngine::Wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  idle.wait(lock, [this]() { return !scheduled; });
+}
+
+bool AsyncEngine::IsIdle() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return !scheduled;
+}
+
+void AsyncEngine::Enqueue(std::unique_ptr<Job> job) {
+  bool post = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(std::move(job));
+    post = !scheduled;
+    scheduled = true;
+  }
+  if (post) {
+    executor([this]() { RunNext(); });
+  }
+}
+
+void AsyncEngine::RunNext() {
+  std::unique_lock<std::mutex> lock(mutex);
+  running = std::move(queue.front());
+  queue.pop_front();
+  lock.unlock();
+
+  running->run(running->stop);
+
+  lock.lock();
+  running.reset();
+  if (queue.empty()) {
+    scheduled = false;
+    idle.notify_all();
+    return;
+  }
+  lock.unlock();
+
+  // One job per task, so other engines on the executor get their turn
+  executor([this]() { RunNext(); });
+}
@@ -0,0 +1,116 @@
+#ifndef NP_ASYNC_ENGINE_HPP
+#define NP_ASYNC_ENGINE_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Search.hpp"
+
+// Runs a task on some thread of the application's, e.g. by posting it to a pool
+using Executor = std::function<void(std::function<void()> task)>;
+// Gets the lines of a running search, see Searcher::progress
+using ProgressFunction = std::function<void(const SearchProgress &progress)>;
+
+// A fixed set of threads taking tasks in the order they were posted, for
+// applications that have no pool of their own to give an AsyncEngine
+class ThreadPool {
+public:
+  explicit ThreadPool(int threadCount);
+  // Runs the tasks still queued, then joins the threads
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  void Post(std::function<void()> task);
+  // Posts to this pool, which has to outlive whatever it is given to
+  Executor GetExecutor() {
+    return [this](std::function<void()> task) { Post(std::move(task)); };
+  }
+
+private:
+  void Worker();
+
+private:
+  std::mutex mutex;
+  std::condition_variable taskReady;
+  std::deque<std::function<void()>> tasks;
+  bool stopping = false;
+  std::vector<std::thread> threads;
+};
+
+// An engine to embed: a position, a table kept between searches, and searches
+// that run on the executor's threads while the caller gets a future. The
+// engine never starts a thread of its own per call. Searches of one engine run
+// one after another, in the order they were started, each from the position
+// set when it was started, and every search is a task of its own, so engines
+// sharing a pool take turns between searches. All members may be called from
+// any thread.
+class AsyncEngine {
+public:
+  // Without an executor the engine gets a pool of one thread to itself
+  explicit AsyncEngine(Executor executor = Executor(), size_t hashMegabytes = DEFAULT_HASH_MB);
+  // Stops the searches and waits for them, the futures all get their results
+  ~AsyncEngine();
+
+  AsyncEngine(const AsyncEngine &) = delete;
+  AsyncEngine &operator=(const AsyncEngine &) = delete;
+
+  // "startpos" or a FEN, then the moves played from it, in coordinate notation.
+  // False, with the position left as it was, if the FEN or a move is invalid.
+  bool SetPosition(const std::string &fen, const std::vector<std::string> &moves = {});
+  // For the searches started from now on
+  void SetOptions(const SearchOptions &options);
+
+  // Starts a search of the current position. Progress gets every line it
+  // finishes; stop, like Stop, ends it early with the best move found so far.
+  std::future<SearchResult> Search(const SearchLimits &limits, ProgressFunction progress = ProgressFunction(),
+                                   std::stop_token stop = std::stop_token());
+  // Resizes or clears the table once the searches started before are done.
+  // Resize's future is false, with the old table kept, if there isn't the memory.
+  std::future<bool> ResizeHash(size_t megabytes);
+  std::future<void> NewGame();
+
+  // Ends the running search and those still queued, each with what it has
+  void Stop();
+  // Blocks until no search is queued or running
+  void Wait();
+  bool IsIdle();
+
+private:
+  struct Job {
+    std::function<void(std::stop_source stop)> run;
+    std::stop_source stop;
+  };
+
+  void Enqueue(std::unique_ptr<Job> job);
+  // Runs the next job, and posts itself again while there are more
+  void RunNext();
+
+private:
+  std::unique_ptr<ThreadPool> ownPool;
+  Executor executor;
+  Searcher searcher;
+
+  std::mutex mutex;
+  std::condition_variable idle;
+  Board board;
+  int color = WHITE;
+  PositionHistory history;
+  SearchOptions options;
+
+  std::deque<std::unique_ptr<Job>> queue;
+  std::unique_ptr<Job> running;
+  // A RunNext is posted or running
+  bool scheduled = false;
+};
+
+#endif // NP_ASYNC_ENGINE_HPP
@@ -0,0 +1,111 @@
+#include "BatchEval.hpp"
+
+#include <cstdint>
+
+#include "EvalParams.hpp"
+
+#if NP_AVX2 && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define NP_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
+// What each piece adds to the score from white's view, its material value
+// included, indexed by color * 6 + pieceType. Black uses the tables turned
+// around and counts negative, like EvaluateBoard.
+struct PieceSquareValues {
+  int32_t values[12][64];
+};
+
+constexpr PieceSquareValues GeneratePieceSquareValues() {
+  PieceSquareValues table{};
+  const int *tables[6] = {pawnTable, knightTable, bishopTable, rookTable, queenTable, kingTable};
+  for (int color = WHITE; color <= BLACK; ++color) {
+    for (int pieceType = PAWN; pieceType <= KING; ++pieceType) {
+      for (int square = 0; square < 64; ++square) {
+        int value = tables[pieceType][color == BLACK ? 63 - square : square] + materialValues[pieceType];
+        table.values[color * 6 + pieceType][square] = color == WHITE ? value : -value;
+      }
+    }
+  }
+  return table;
+}
+
+constexpr PieceSquareValues pieceSquare = GeneratePieceSquareValues();
+
+void EvaluateBatchScalar(std::span<const Board> boards, std::span<int> scores) {
+  for (size_t i = 0; i < boards.size(); ++i) {
+    int score = 0;
+    for (int kind = 0; kind < 12; ++kind) {
+      Bitboard pieces = boards[i].GetPieces(kind / 6, kind % 6);
+      while (pieces.IsNotEmpty()) {
+        score += pieceSquare.values[kind][pieces.PopLeastSignificantBit()];
+      }
+    }
+    scores[i] = score;
+  }
+}
+
+#ifdef NP_AVX2_KERNEL
+__attribute__((target("avx2"))) static void EvaluateBatchAvx2(std::span<const Board> boards, std::span<int> scores) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i exponentMask = _mm256_set1_epi32(0xFF);
+  const __m256i exponentBias = _mm256_set1_epi32(127);
+
+  size_t i = 0;
+  for (; i + 8 <= boards.size(); i += 8) {
+    // For every kind of piece, one half of the bitboard of each of the eight boards side by side
+    alignas(32) uint32_t halves[12][2][8];
+    for (int board = 0; board < 8; ++board) {
+      for (int color = WHITE; color <= BLACK; ++color) {
+        for (int pieceType = PAWN; pieceType <= KING; ++pieceType) {
+          uint64_t pieces = boards[i + board].GetPieces(color, pieceType).GetBoard();
+          halves[color * 6 + pieceType][0][board] = static_cast<uint32_t>(pieces);
+          halves[color * 6 + pieceType][1][board] = static_cast<uint32_t>(pieces >> 32);
+        }
+      }
+    }
+
+    __m256i sum = zero;
+    for (int kind = 0; kind < 12; ++kind) {
+      for (int half = 0; half < 2; ++half) {
+        const int *values = pieceSquare.values[kind] + half * 32;
+        __m256i bits = _mm256_load_si256(reinterpret_cast<const __m256i *>(halves[kind][half]));
+        while (!_mm256_testz_si256(bits, bits)) {
+          // A single bit converts to a float that is exactly its power of
+          // two, so the exponent is the square. Lanes that ran out of pieces
+          // come out as nothing and are masked off.
+          __m256i lowest = _mm256_and_si256(bits, _mm256_sub_epi32(zero, bits));
+          __m256i exponent = _mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(lowest)), 23);
+          __m256i square = _mm256_sub_epi32(_mm256_and_si256(exponent, exponentMask), exponentBias);
+          __m256i present = _mm256_andnot_si256(_mm256_cmpeq_epi32(lowest, zero), _mm256_set1_epi32(-1));
+          sum = _mm256_add_epi32(sum, _mm256_mask_i32gather_epi32(zero, values, square, present, 4));
+          bits = _mm256_and_si256(bits, _mm256_sub_epi32(bits, one));
+        }
+      }
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(scores.data() + i), sum);
+  }
+
+  EvaluateBatchScalar(boards.subspan(i), scores.subspan(i));
+}
+#endif
+
+bool HasSimdEvaluation() {
+#ifdef NP_AVX2_KERNEL
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  return avx2;
+#else
+  return false;
+#endif
+}
+
+void EvaluateBatch(std::span<const Board> boards, std::span<int> scores) {
+#ifdef NP_AVX2_KERNEL
+  if (HasSimdEvaluation()) {
+    EvaluateBatchAvx2(boards, scores);
+    return;
+  }
+#endif
+  EvaluateBatchScalar(boards, scores);
+}
@@ -0,0 +1,25 @@
+#ifndef NP_BATCH_EVAL_HPP
+#define NP_BATCH_EVAL_HPP
+
+#include <span>
+
+#include "Board.hpp"
+
+// The AVX2 kernel is picked at run time on CPUs that have it, building with
+// NP_AVX2=0 leaves only the scalar loop
+#ifndef NP_AVX2
+#define NP_AVX2 1
+#endif
+
+// EvaluateBoard of every board, into scores (at least as long as boards).
+// For scoring many unrelated positions, e.g. a whole EPD file or a batch of
+// training data: eight boards are taken at a time and their bitboards laid
+// side by side, so every step looks up a piece of each of the eight.
+void EvaluateBatch(std::span<const Board> boards, std::span<int> scores);
+// The same one board at a time, for CPUs without AVX2 and for comparison
+void EvaluateBatchScalar(std::span<const Board> boards, std::span<int> scores);
+
+// Whether EvaluateBatch runs the AVX2 kernel here
+bool HasSimdEvaluation();
+
+#endif // NP_BATCH_EVAL_HPP
@@ -83,6 +83,22 @@ public:
     return lsbIndex;
   }
 
+  inline int Count() const {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(board);
+#elif defined(_MSC_VER)
+    return static_cast<int>(__popcnt64(board));
+#else
+    uint64_t bb = board;
+    int count = 0;
+    while (bb) {
+      bb &= (bb - 1);
+      ++count;
+    }
+    return count;
+#endif
+  }
+
   inline bool IsEmpty() const {
     return board == 0;
   }
@@ -233,13 +249,13 @@ public:
     return *this;
   }
 
-  Bitboard operator|(const Bitboard &bb) {
+  Bitboard operator|(const Bitboard &bb) const {
     Bitboard result;
     result.SetBoard(board | bb.GetBoard());
     return result;
   }
 
-  Bitboard operator&(const Bitboard &bb) {
+  Bitboard operator&(const Bitboard &bb) const {
     Bitboard result;
     result.SetBoard(board & bb.GetBoard());
     return result;
@@ -255,7 +271,18 @@ public:
     return *this;
   }
 
-  Bitboard operator~() {
+  Bitboard operator^(const Bitboard &bb) const {
+    Bitboard result;
+    result.SetBoard(board ^ bb.GetBoard());
+    return result;
+  }
+
+  Bitboard &operator^=(const Bitboard &bb) {
+    board ^= bb.GetBoard();
+    return *this;
+  }
+
+  Bitboard operator~() const {
     Bitboard result;
     result.SetBoard(~board);
     return result;
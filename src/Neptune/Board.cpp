@@ -1,6 +1,13 @@
 #include "Board.hpp"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+
+#include "EvalParams.hpp"
 
 Bitboard pawnMoves[2][64];
 Bitboard pawnCaptureMoves[2][64];
@@ -9,72 +16,9 @@ Bitboard bishopMoves[64];
 Bitboard rookMoves[64];
 Bitboard queenMoves[64];
 Bitboard kingMoves[64];
-
-const int pawnTable[64] = {
-  0,  0,  0,  0,  0,  0,  0,  0,
-  50, 50, 50, 50, 50, 50, 50, 50,
-  10, 10, 20, 30, 30, 20, 10, 10,
-  5,  5, 10, 25, 25, 10,  5,  5,
-  0,  0,  0, 20, 20,  0,  0,  0,
-  5, -5,-10,  0,  0,-10, -5,  5,
-  5, 10, 10,-20,-20, 10, 10,  5,
-  0,  0,  0,  0,  0,  0,  0,  0
-};
-
-const int knightTable[64] = {
-  -50,-40,-30,-30,-30,-30,-40,-50,
-  -40,-20,  0,  0,  0,  0,-20,-40,
-  -30,  0, 10, 15, 15, 10,  0,-30,
-  -30,  5, 15, 20, 20, 15,  5,-30,
-  -30,  0, 15, 20, 20, 15,  0,-30,
-  -30,  5, 10, 15, 15, 10,  5,-30,
-  -40,-20,  0,  5,  5,  0,-20,-40,
-  -50,-40,-30,-30,-30,-30,-40,-50,
-};
-
-const int bishopTable[64] = {
-  -20,-10,-10,-10,-10,-10,-10,-20,
-  -10,  0,  0,  0,  0,  0,  0,-10,
-  -10,  0,  5, 10, 10,  5,  0,-10,
-  -10,  5,  5, 10, 10,  5,  5,-10,
-  -10,  0, 10, 10, 10, 10,  0,-10,
-  -10, 10, 10, 10, 10, 10, 10,-10,
-  -10,  5,  0,  0,  0,  0,  5,-10,
-  -20,-10,-10,-10,-10,-10,-10,-20,
-};
-
-const int rookTable[64] = {
-    0,  0,  0,  0,  0,  0,  0,  0,
-    5, 10, 10, 10, 10, 10, 10,  5,
-   -5,  0,  0,  0,  0,  0,  0, -5,
-   -5,  0,  0,  0,  0,  0,  0, -5,
-   -5,  0,  0,  0,  0,  0,  0, -5,
-   -5,  0,  0,  0,  0,  0,  0, -5,
-   -5,  0,  0,  0,  0,  0,  0, -5,
-    0,  0,  0,  5,  5,  0,  0,  0
-};
-
-const int queenTable[64] = {
-  -20,-10,-10, -5, -5,-10,-10,-20,
-  -10,  0,  0,  0,  0,  0,  0,-10,
-  -10,  0,  5,  5,  5,  5,  0,-10,
-   -5,  0,  5,  5,  5,  5,  0, -5,
-    0,  0,  5,  5,  5,  5,  0, -5,
-  -10,  5,  5,  5,  5,  5,  0,-10,
-  -10,  0,  5,  0,  0,  0,  0,-10,
-  -20,-10,-10, -5, -5,-10,-10,-20
-};
-
-const int kingTable[64] = {
-  -30,-40,-40,-50,-50,-40,-40,-30,
-  -30,-40,-40,-50,-50,-40,-40,-30,
-  -30,-40,-40,-50,-50,-40,-40,-30,
-  -30,-40,-40,-50,-50,-40,-40,-30,
-  -20,-30,-30,-40,-40,-30,-30,-20,
-  -10,-20,-20,-20,-20,-20,-20,-10,
-   20, 20,  0,  0,  0,  0, 20, 20,
-   20, 30, 10,  0,  0, 10, 30, 20
-};
+// Squares strictly between two squares on a line, and the whole line through them
+Bitboard squaresBetween[64][64];
+Bitboard lineThrough[64][64];
 
 const int kingEndGameTable[64] = {
   -50,-40,-30,-20,-20,-30,-40,-50,
@@ -87,6 +31,64 @@ const int kingEndGameTable[64] = {
   -50,-30,-30,-30,-30,-30,-30,-50
 };
 
+struct ZobristKeys {
+  uint64_t pieces[2][6][64];
+  uint64_t castling[16];
+  uint64_t enPassant[8];
+  uint64_t side;
+};
+
+// Fixed seed xorshift64*, so keys are the same on every run and platform
+constexpr ZobristKeys GenerateZobristKeys() {
+  ZobristKeys keys{};
+  uint64_t seed = 1070372;
+  auto next = [&seed]() {
+    seed ^= seed >> 12;
+    seed ^= seed << 25;
+    seed ^= seed >> 27;
+    return seed * 2685821657736338717ULL;
+  };
+
+  for (int color = WHITE; color <= BLACK; ++color) {
+    for (int piece = PAWN; piece <= KING; ++piece) {
+      for (int square = 0; square < 64; ++square) {
+        keys.pieces[color][piece][square] = next();
+      }
+    }
+  }
+  for (int rights = 0; rights < 16; ++rights) {
+    keys.castling[rights] = rights ? next() : 0;
+  }
+  for (int file = 0; file < 8; ++file) {
+    keys.enPassant[file] = next();
+  }
+  keys.side = next();
+  return keys;
+}
+
+constexpr ZobristKeys zobrist = GenerateZobristKeys();
+
+// Castling rights that stay after a move from or to each square
+struct CastlingMasks {
+  uint8_t kept[64];
+};
+
+constexpr CastlingMasks GenerateCastlingMasks() {
+  CastlingMasks masks{};
+  for (int square = 0; square < 64; ++square) {
+    masks.kept[square] = 0xF;
+  }
+  masks.kept[4] &= ~(WHITE_KINGSIDE_CASTLE | WHITE_QUEENSIDE_CASTLE);
+  masks.kept[60] &= ~(BLACK_KINGSIDE_CASTLE | BLACK_QUEENSIDE_CASTLE);
+  masks.kept[WHITE_KINGSIDE_ROOK_FROM_SQUARE] &= ~WHITE_KINGSIDE_CASTLE;
+  masks.kept[WHITE_QUEENSIDE_ROOK_FROM_SQUARE] &= ~WHITE_QUEENSIDE_CASTLE;
+  masks.kept[BLACK_KINGSIDE_ROOK_FROM_SQUARE] &= ~BLACK_KINGSIDE_CASTLE;
+  masks.kept[BLACK_QUEENSIDE_ROOK_FROM_SQUARE] &= ~BLACK_QUEENSIDE_CASTLE;
+  return masks;
+}
+
+constexpr CastlingMasks castlingMasks = GenerateCastlingMasks();
+
 Bitboard SingleBit(int index) {
   Bitboard bb;
   bb.SetBit(index);
@@ -111,123 +113,319 @@ Board::Board() {
 }
 
 void Board::Reset() {
+  const uint64_t startingBoards[2][6] = {
+    {WHITE_PAWN_STARTING_BOARD, WHITE_KNIGHT_STARTING_BOARD, WHITE_BISHOP_STARTING_BOARD,
+     WHITE_ROOK_STARTING_BOARD, WHITE_QUEEN_STARTING_BOARD, WHITE_KING_STARTING_BOARD},
+    {BLACK_PAWN_STARTING_BOARD, BLACK_KNIGHT_STARTING_BOARD, BLACK_BISHOP_STARTING_BOARD,
+     BLACK_ROOK_STARTING_BOARD, BLACK_QUEEN_STARTING_BOARD, BLACK_KING_STARTING_BOARD},
+  };
+
+  Clear();
   for (int color = WHITE; color <= BLACK; ++color) {
     for (int piece = PAWN; piece <= KING; ++piece) {
-      pieces[color][piece].SetBoard(EMPTY_BOARD);
+      Bitboard start;
+      start.SetBoard(startingBoards[color][piece]);
+      byType[piece] |= start;
+      byColor[color] |= start;
     }
   }
 
-  pieces[WHITE][PAWN].SetBoard(WHITE_PAWN_STARTING_BOARD);
-  pieces[WHITE][KNIGHT].SetBoard(WHITE_KNIGHT_STARTING_BOARD);
-  pieces[WHITE][BISHOP].SetBoard(WHITE_BISHOP_STARTING_BOARD);
-  pieces[WHITE][ROOK].SetBoard(WHITE_ROOK_STARTING_BOARD);
-  pieces[WHITE][QUEEN].SetBoard(WHITE_QUEEN_STARTING_BOARD);
-  pieces[WHITE][KING].SetBoard(WHITE_KING_STARTING_BOARD);
-
-  pieces[BLACK][PAWN].SetBoard(BLACK_PAWN_STARTING_BOARD);
-  pieces[BLACK][KNIGHT].SetBoard(BLACK_KNIGHT_STARTING_BOARD);
-  pieces[BLACK][BISHOP].SetBoard(BLACK_BISHOP_STARTING_BOARD);
-  pieces[BLACK][ROOK].SetBoard(BLACK_ROOK_STARTING_BOARD);
-  pieces[BLACK][QUEEN].SetBoard(BLACK_QUEEN_STARTING_BOARD);
-  pieces[BLACK][KING].SetBoard(BLACK_KING_STARTING_BOARD);
-
-  occupied = pieces[WHITE][PAWN] | pieces[WHITE][KNIGHT] | pieces[WHITE][BISHOP] | pieces[WHITE][ROOK] | pieces[WHITE][QUEEN] | pieces[WHITE][KING] | pieces[BLACK][PAWN] | pieces[BLACK][KNIGHT] | pieces[BLACK][BISHOP] | pieces[BLACK][ROOK] | pieces[BLACK][QUEEN] | pieces[BLACK][KING];
+  SetState(WHITE, WHITE_KINGSIDE_CASTLE | WHITE_QUEENSIDE_CASTLE | BLACK_KINGSIDE_CASTLE | BLACK_QUEENSIDE_CASTLE, EMPTY, 0);
+}
 
+void Board::Clear() {
   for (int piece = PAWN; piece <= KING; ++piece) {
-    occupiedColor[WHITE] |= pieces[WHITE][piece];
-    occupiedColor[BLACK] |= pieces[BLACK][piece];
+    byType[piece].Clear();
   }
+  byColor[WHITE].Clear();
+  byColor[BLACK].Clear();
 }
 
-void Board::Log() {
-  occupied.Log();
+void Board::SetPiece(int square, int color, int pieceType) {
+  byType[pieceType].SetBit(square);
+  byColor[color].SetBit(square);
 }
 
-void Board::MakeMove(Move move, int color) {
-  canEnPassant = false;
+void Board::SetState(int color, int rights, int enPassant, int halfmoves) {
+  castlingRights = static_cast<uint8_t>(rights);
+  enPassantSquare = static_cast<int8_t>(enPassant);
+  state.halfmoveClock = static_cast<uint16_t>(std::min(halfmoves, 0xFFFF));
+  state.pliesFromNull = 0;
+  key = ComputeKey(color);
+}
 
-  for (int piece = PAWN; piece <= KING; ++piece) {
-    bool actualType = false;
-    // Remove the piece from its starting square
-    if (pieces[color][piece].IsSet(move.fromSquare)) {
-      pieces[color][piece].ClearBit(move.fromSquare);
-      actualType = true;
-    }
-    // If there's an opposing piece at the destination square, remove it
-    pieces[!color][piece].ClearBit(move.toSquare);
-    if (actualType) {
-      // Place the piece at its destination square
-      pieces[color][piece].SetBit(move.toSquare);
-      // en passant
-      if (piece == PAWN && abs(move.fromSquare - move.toSquare) == 16) {
-        canEnPassant = true;
+// FEN letters, white pieces then black, in pieceType order
+const char *fenPieces = "PNBRQKpnbrqk";
+
+static int SquareFromName(const std::string &name) {
+  if (name.size() != 2 || name[0] < 'a' || name[0] > 'h' || name[1] < '1' || name[1] > '8') {
+    return EMPTY;
+  }
+  return (name[1] - '1') * 8 + (name[0] - 'a');
+}
+
+bool Board::FromFEN(const std::string &fen, int &color) {
+  std::istringstream input(fen);
+  std::string placement, side, castling = "-", enPassant = "-";
+  if (!(input >> placement >> side)) {
+    return false;
+  }
+  input >> castling >> enPassant;
+  int halfmoves = 0;
+  if (!(input >> halfmoves) || halfmoves < 0) {
+    halfmoves = 0;
+  }
+
+  Board parsed;
+  parsed.Clear();
+
+  int rank = 7;
+  int file = 0;
+  for (char c : placement) {
+    if (c == '/') {
+      if (file != 8 || rank == 0) {
+        return false;
       }
-      // promotion
-      if (move.promotionPiece != -1) {
-        pieces[color][PAWN].ClearBit(move.toSquare);
-        pieces[color][move.promotionPiece].SetBit(move.toSquare);
+      rank--;
+      file = 0;
+    } else if (c >= '1' && c <= '8') {
+      file += c - '0';
+      if (file > 8) {
+        return false;
       }
-      // tracking if king & rook moved for castling
-      if (piece == KING) {
-        kingMoved[color] = true;
-
-        // castling
-        switch (move.toSquare) {
-          case WHITE_QUEENSIDE_CASTLE_TO_SQAURE:
-            // move the rook
-            pieces[color][ROOK].ClearBit(WHITE_QUEENSIDE_ROOK_FROM_SQUARE);
-            pieces[color][ROOK].SetBit(WHITE_QUEENSIDE_ROOK_TO_SQUARE);
-            break;
-          case WHITE_KINGSIDE_CASTLE_TO_SQAURE:
-            // move the rook
-            pieces[color][ROOK].ClearBit(WHITE_KINGSIDE_ROOK_FROM_SQUARE);
-            pieces[color][ROOK].SetBit(WHITE_KINGSIDE_ROOK_TO_SQUARE);
-            break;
-          case BLACK_QUEENSIDE_CASTLE_TO_SQAURE:
-            // move the rook
-            pieces[color][ROOK].ClearBit(BLACK_QUEENSIDE_ROOK_FROM_SQUARE);
-            pieces[color][ROOK].SetBit(BLACK_QUEENSIDE_ROOK_TO_SQUARE);
-            break;
-          case BLACK_KINGSIDE_CASTLE_TO_SQAURE:
-            // move the rook
-            pieces[color][ROOK].ClearBit(BLACK_KINGSIDE_ROOK_FROM_SQUARE);
-            pieces[color][ROOK].SetBit(BLACK_KINGSIDE_ROOK_TO_SQUARE);
-            break;
-        }
+    } else {
+      const char *piece = std::strchr(fenPieces, c);
+      if (!piece || !c || file > 7) {
+        return false;
       }
-      if (piece == ROOK) {
-        if (move.fromSquare == 0 || move.fromSquare == 56) {
-          rookMoved[color][0] = true;
-        }
-        if (move.fromSquare == 7 || move.fromSquare == 63) {
-          rookMoved[color][1] = true;
-        }
+      int index = static_cast<int>(piece - fenPieces);
+      int pieceType = index % 6;
+      // Pawns never stand on the first or last rank
+      if (pieceType == PAWN && (rank == 0 || rank == 7)) {
+        return false;
+      }
+      parsed.SetPiece(rank * 8 + file, index / 6, pieceType);
+      file++;
+    }
+  }
+  if (rank != 0 || file != 8) {
+    return false;
+  }
+  if (parsed.GetPieces(WHITE, KING).Count() != 1 || parsed.GetPieces(BLACK, KING).Count() != 1) {
+    return false;
+  }
+
+  if (side != "w" && side != "b") {
+    return false;
+  }
+  int sideToMove = side == "w" ? WHITE : BLACK;
+
+  // Rights that don't match the pieces are dropped rather than refused
+  int castlingRights = 0;
+  if (castling != "-") {
+    for (char c : castling) {
+      switch (c) {
+        case 'K': castlingRights |= WHITE_KINGSIDE_CASTLE; break;
+        case 'Q': castlingRights |= WHITE_QUEENSIDE_CASTLE; break;
+        case 'k': castlingRights |= BLACK_KINGSIDE_CASTLE; break;
+        case 'q': castlingRights |= BLACK_QUEENSIDE_CASTLE; break;
+        default: return false;
       }
     }
   }
+  const int rightSquares[4][2] = {
+    {4, WHITE_KINGSIDE_ROOK_FROM_SQUARE}, {4, WHITE_QUEENSIDE_ROOK_FROM_SQUARE},
+    {60, BLACK_KINGSIDE_ROOK_FROM_SQUARE}, {60, BLACK_QUEENSIDE_ROOK_FROM_SQUARE},
+  };
+  for (int right = 0; right < 4; ++right) {
+    int rightColor = right < 2 ? WHITE : BLACK;
+    if (!parsed.GetPieces(rightColor, KING).IsSet(rightSquares[right][0])
+        || !parsed.GetPieces(rightColor, ROOK).IsSet(rightSquares[right][1])) {
+      castlingRights &= ~(1 << right);
+    }
+  }
 
-  // Update the occupied squares
-  occupied.SetBoard(EMPTY_BOARD);
-  for (int c = WHITE; c <= BLACK; ++c) {
-    for (int piece = PAWN; piece <= KING; ++piece) {
-      occupied |= pieces[c][piece];
+  // Same for an en passant square without the pawn that just passed it
+  int enPassantSquare = EMPTY;
+  if (enPassant != "-") {
+    enPassantSquare = SquareFromName(enPassant);
+    if (enPassantSquare == EMPTY) {
+      return false;
+    }
+    int pushedTo = sideToMove == WHITE ? enPassantSquare - 8 : enPassantSquare + 8;
+    bool rankMatches = enPassantSquare / 8 == (sideToMove == WHITE ? 5 : 2);
+    if (!rankMatches || !parsed.GetPieces(!sideToMove, PAWN).IsSet(pushedTo) || parsed.GetOccupied().IsSet(enPassantSquare)) {
+      enPassantSquare = EMPTY;
     }
   }
 
-  for (int piece = PAWN; piece <= KING; ++piece) {
-    occupiedColor[WHITE] |= pieces[WHITE][piece];
-    occupiedColor[BLACK] |= pieces[BLACK][piece];
+  parsed.SetState(sideToMove, castlingRights, enPassantSquare, halfmoves);
+
+  // The side that just moved can't have left its king in check
+  if (parsed.IsInCheck(!sideToMove)) {
+    return false;
   }
 
-  lastMove = move;
+  *this = parsed;
+  color = sideToMove;
+  return true;
 }
 
+std::string Board::ToFEN(int color, int fullmoveNumber) const {
+  std::string fen;
+
+  for (int rank = 7; rank >= 0; --rank) {
+    int emptySquares = 0;
+    for (int file = 0; file < 8; ++file) {
+      ColoredPiece piece = GetPieceAt(rank * 8 + file);
+      if (piece.pieceType == EMPTY) {
+        emptySquares++;
+        continue;
+      }
+      if (emptySquares) {
+        fen += char('0' + emptySquares);
+        emptySquares = 0;
+      }
+      fen += fenPieces[piece.pieceColor * 6 + piece.pieceType];
+    }
+    if (emptySquares) {
+      fen += char('0' + emptySquares);
+    }
+    if (rank) {
+      fen += '/';
+    }
+  }
+
+  fen += color == WHITE ? " w " : " b ";
+
+  int castlingRights = GetCastlingRights();
+  if (castlingRights & WHITE_KINGSIDE_CASTLE) fen += 'K';
+  if (castlingRights & WHITE_QUEENSIDE_CASTLE) fen += 'Q';
+  if (castlingRights & BLACK_KINGSIDE_CASTLE) fen += 'k';
+  if (castlingRights & BLACK_QUEENSIDE_CASTLE) fen += 'q';
+  if (!castlingRights) fen += '-';
+
+  int enPassantSquare = GetEnPassantSquare();
+  if (enPassantSquare == EMPTY) {
+    fen += " -";
+  } else {
+    fen += ' ';
+    fen += char('a' + enPassantSquare % 8);
+    fen += char('1' + enPassantSquare / 8);
+  }
+
+  fen += ' ' + std::to_string(state.halfmoveClock) + ' ' + std::to_string(fullmoveNumber);
+  return fen;
+}
+
+void Board::Log() {
+  GetOccupied().Log();
+}
+
+void Board::MakeMove(Move move, int color) {
+  int from = move.fromSquare;
+  int to = move.toSquare;
+  int pieceType = GetPieceTypeAt(from);
+  int capturedType = byColor[!color].IsSet(to) ? GetPieceTypeAt(to) : EMPTY;
+
+  // Pawn moves and captures can't be undone, the 50-move count starts over
+  if (capturedType != EMPTY || pieceType == PAWN) {
+    state.halfmoveClock = 0;
+  } else {
+    ++state.halfmoveClock;
+  }
+  ++state.pliesFromNull;
+
+  // The old castling rights and en passant square leave the key, the new ones go in at the end
+  key ^= zobrist.castling[castlingRights];
+  if (IsEnPassantHashed()) {
+    key ^= zobrist.enPassant[enPassantSquare & 7];
+  }
+
+  // An en passant capture lands on an empty square, the passed pawn is behind it
+  if (pieceType == PAWN && to == enPassantSquare) {
+    RemovePiece(color == WHITE ? to - 8 : to + 8, !color, PAWN);
+  }
+  if (capturedType != EMPTY) {
+    RemovePiece(to, !color, capturedType);
+  }
+  RemovePiece(from, color, pieceType);
+  PutPiece(to, color, move.promotionPiece != EMPTY ? move.promotionPiece : pieceType);
+
+  // Castling, the only way a king moves two squares: the rook goes over it
+  if (pieceType == KING && std::abs(to - from) == 2) {
+    int rookFrom = to > from ? from + 3 : from - 4;
+    RemovePiece(rookFrom, color, ROOK);
+    PutPiece((from + to) / 2, color, ROOK);
+  }
+
+  // Moving the king or a rook, or taking a rook, loses the rights that needed them
+  castlingRights &= castlingMasks.kept[from] & castlingMasks.kept[to];
+
+  enPassantSquare = pieceType == PAWN && std::abs(to - from) == 16 ? static_cast<int8_t>((from + to) / 2) : EMPTY;
+
+  key ^= zobrist.castling[castlingRights];
+  if (IsEnPassantHashed()) {
+    key ^= zobrist.enPassant[enPassantSquare & 7];
+  }
+  key ^= zobrist.side;
+}
+
+void Board::MakeNullMove() {
+  if (IsEnPassantHashed()) {
+    key ^= zobrist.enPassant[enPassantSquare & 7];
+  }
+  enPassantSquare = EMPTY;
+  key ^= zobrist.side;
+
+  ++state.halfmoveClock;
+  state.pliesFromNull = 0;
+}
+
+inline void Board::PutPiece(int square, int color, int pieceType) {
+  byType[pieceType].SetBit(square);
+  byColor[color].SetBit(square);
+  key ^= zobrist.pieces[color][pieceType][square];
+}
+
+inline void Board::RemovePiece(int square, int color, int pieceType) {
+  byType[pieceType].ClearBit(square);
+  byColor[color].ClearBit(square);
+  key ^= zobrist.pieces[color][pieceType][square];
+}
 
 std::vector<Move> Board::GenerateLegalMoves(int color) {
-  std::vector<Move> legalMoves;
+  MoveList moveList;
+  GenerateLegalMoves(color, moveList);
+  return std::vector<Move>(moveList.begin(), moveList.end());
+}
+
+void Board::GenerateLegalMoves(int color, MoveList &legalMoves) {
+  AttackInfo attackInfo;
+  ComputeAttackInfo(color, attackInfo);
+  GenerateLegalMoves(color, legalMoves, attackInfo);
+}
+
+void Board::GenerateLegalMoves(int color, MoveList &legalMoves, const AttackInfo &attackInfo) {
+  Bitboard occupied = GetOccupied();
+  legalMoves.Clear();
+
+  int kingSquare = GetPieces(color, KING).GetLeastSignificantBit();
+  int checks = attackInfo.checkers.Count();
+  const Bitboard &enemyAttacks = attackInfo.attacks[!color];
+
+  // In check, the other pieces have to take the checker or step in between
+  Bitboard evasions = ~Bitboard();
+  if (checks == 1) {
+    evasions = attackInfo.checkers | squaresBetween[kingSquare][attackInfo.checkers.GetLeastSignificantBit()];
+  }
 
   for (int pieceType = PAWN; pieceType <= KING; ++pieceType) {
-    Bitboard currentPieces = pieces[color][pieceType];
+    // Against two checkers only the king can move
+    if (checks >= 2 && pieceType != KING) {
+      continue;
+    }
+    Bitboard currentPieces = GetPieces(color, pieceType);
     
     while (!currentPieces.IsEmpty()) {
       int square = currentPieces.PopLeastSignificantBit();
@@ -235,7 +433,11 @@ std::vector<Move> Board::GenerateLegalMoves(int color) {
       Bitboard potentialMoves;
       switch (pieceType) {
         case PAWN:
-          potentialMoves = pawnMoves[color][square];
+          // Pushes never capture, and a blocked single push also blocks the double push
+          potentialMoves = pawnMoves[color][square] & ~occupied;
+          if (occupied.IsSet(color == WHITE ? square + 8 : square - 8)) {
+            potentialMoves.Clear();
+          }
           break;
         case KNIGHT:
           potentialMoves = knightMoves[square];
@@ -252,24 +454,19 @@ std::vector<Move> Board::GenerateLegalMoves(int color) {
         case KING:
           potentialMoves = kingMoves[square];
           // castling
-          if (!kingMoved[color]) {
-            // queenside 
+          if (!checks) {
             if (color == WHITE) {
-              // Queenside
-              if (!rookMoved[color][0] && (occupied & WHITE_QUEENSIDE_EMPTY_SQUARES_MASK).IsEmpty() && !IsSquareAttacked(WHITE_QUEENSIDE_PASSING_KING_SQUARE, !color)) {
+              if ((castlingRights & WHITE_QUEENSIDE_CASTLE) && (occupied & WHITE_QUEENSIDE_EMPTY_SQUARES_MASK).IsEmpty() && (enemyAttacks & WHITE_QUEENSIDE_PASSING_KING_SQUARE).IsEmpty()) {
                 potentialMoves.SetBit(WHITE_QUEENSIDE_CASTLE_TO_SQAURE);
               }
-              // Kingside
-              if (!rookMoved[color][1] && (occupied & WHITE_KINGSIDE_EMPTY_SQUARES_MASK).IsEmpty() && !IsSquareAttacked(WHITE_KINGSIDE_PASSING_KING_SQUARE, !color)) {
+              if ((castlingRights & WHITE_KINGSIDE_CASTLE) && (occupied & WHITE_KINGSIDE_EMPTY_SQUARES_MASK).IsEmpty() && (enemyAttacks & WHITE_KINGSIDE_PASSING_KING_SQUARE).IsEmpty()) {
                 potentialMoves.SetBit(WHITE_KINGSIDE_CASTLE_TO_SQAURE);
               }
             } else {
-              // Queenside
-              if (!rookMoved[color][0] && (occupied & BLACK_QUEENSIDE_EMPTY_SQUARES_MASK).IsEmpty() && !IsSquareAttacked(BLACK_QUEENSIDE_PASSING_KING_SQUARE, !color)) {
+              if ((castlingRights & BLACK_QUEENSIDE_CASTLE) && (occupied & BLACK_QUEENSIDE_EMPTY_SQUARES_MASK).IsEmpty() && (enemyAttacks & BLACK_QUEENSIDE_PASSING_KING_SQUARE).IsEmpty()) {
                 potentialMoves.SetBit(BLACK_QUEENSIDE_CASTLE_TO_SQAURE);
               }
-              // Kingside
-              if (!rookMoved[color][1] && (occupied & BLACK_KINGSIDE_EMPTY_SQUARES_MASK).IsEmpty() && !IsSquareAttacked(BLACK_KINGSIDE_PASSING_KING_SQUARE, !color)) {
+              if ((castlingRights & BLACK_KINGSIDE_CASTLE) && (occupied & BLACK_KINGSIDE_EMPTY_SQUARES_MASK).IsEmpty() && (enemyAttacks & BLACK_KINGSIDE_PASSING_KING_SQUARE).IsEmpty()) {
                 potentialMoves.SetBit(BLACK_KINGSIDE_CASTLE_TO_SQAURE);
               }
             }
@@ -277,37 +474,40 @@ std::vector<Move> Board::GenerateLegalMoves(int color) {
           break;
       }
 
+      // The king can't go where it's attacked, the others have to answer a check
+      // and a pinned piece can only move along the pin
+      Bitboard allowed = evasions;
+      if (pieceType == KING) {
+        allowed = ~enemyAttacks;
+      } else if (attackInfo.pinned.IsSet(square)) {
+        allowed &= lineThrough[kingSquare][square];
+      }
+
       // Mask off illegal moves based on board state
-      Bitboard legalMoveBoard = MaskOffIllegalMoves(potentialMoves, color, pieceType, square);
+      Bitboard legalMoveBoard = MaskOffIllegalMoves(potentialMoves, color, pieceType, square) & allowed;
 
       // Convert this legal move board to a list of moves and append to legalMoves
-      AddMovesToList(legalMoves, legalMoveBoard, square, color, pieceType);
+      AddMovesToList(legalMoves, legalMoveBoard, square, pieceType);
 
-      // Inside GenerateLegalMoves function
       if (pieceType == PAWN) {
-        Bitboard captureMoves = pawnCaptureMoves[color][square];
-
-        Bitboard attackableSquares = occupiedColor[!color];
-
-        if (canEnPassant) {
-          if (color == WHITE) {
-            attackableSquares.SetBit(lastMove.toSquare + 8);
-          } else {
-            attackableSquares.SetBit(lastMove.toSquare - 8);
+        Bitboard captureMoves = pawnCaptureMoves[color][square] & byColor[!color] & allowed;
+        AddMovesToList(legalMoves, captureMoves, square, pieceType);
+
+        // En passant takes a pawn off a square it doesn't land on, so it is the
+        // one move that is still checked by playing it
+        int enPassantSquare = GetEnPassantSquare();
+        if (enPassantSquare != EMPTY && pawnCaptureMoves[color][square].IsSet(enPassantSquare)) {
+          Move move(square, enPassantSquare);
+          if (!IsMovePuttingKingInCheck(move, color)) {
+            legalMoves.Add(move);
           }
         }
-
-        captureMoves &= attackableSquares; // Keep only squares occupied by the enemy
-        // Convert this legal move board to a list of moves and append to legalMoves
-        AddMovesToList(legalMoves, captureMoves, square, color, pieceType);
       }
     }
   }
-
-  return legalMoves;
 }
 
-void Board::InitMoves() {
+static void FillMoveTables() {
   Bitboard bb;
   for (int square = 0; square < 64; ++square) {
     pawnMoves[WHITE][square] = bb.WhitePawnMoves(square);
@@ -320,36 +520,287 @@ void Board::InitMoves() {
     kingMoves[square] = bb.KingMoves(square);
     queenMoves[square] = bishopMoves[square] | rookMoves[square];
   }
+
+  // Walk every direction from every square
+  const int dx[] = {1, 1, 0, -1, -1, -1, 0, 1};
+  const int dy[] = {0, 1, 1, 1, 0, -1, -1, -1};
+  for (int from = 0; from < 64; ++from) {
+    for (int direction = 0; direction < 8; ++direction) {
+      Bitboard ray, between;
+      // The ray the other way, for the full line
+      for (int x = from % 8 - dx[direction], y = from / 8 - dy[direction]; x >= 0 && x < 8 && y >= 0 && y < 8;
+           x -= dx[direction], y -= dy[direction]) {
+        ray.SetBit(y * 8 + x);
+      }
+      ray.SetBit(from);
+      for (int x = from % 8 + dx[direction], y = from / 8 + dy[direction]; x >= 0 && x < 8 && y >= 0 && y < 8;
+           x += dx[direction], y += dy[direction]) {
+        ray.SetBit(y * 8 + x);
+      }
+      for (int x = from % 8 + dx[direction], y = from / 8 + dy[direction]; x >= 0 && x < 8 && y >= 0 && y < 8;
+           x += dx[direction], y += dy[direction]) {
+        squaresBetween[from][y * 8 + x] = between;
+        lineThrough[from][y * 8 + x] = ray;
+        between.SetBit(y * 8 + x);
+      }
+    }
+  }
 }
 
-int Board::EvaluateMaterial() {
-  int white_material = 0;
-  int black_material = 0;
+void Board::InitMoves() {
+  // The tables are shared by every board, so they are filled once: refilling
+  // them would race with the threads already searching
+  static std::once_flag filled;
+  std::call_once(filled, FillMoveTables);
+}
 
-  for (int square = 0; square < 64; ++square) {
-    ColoredPiece piece = GetPieceAt(square);  // Assuming you have this function
-    if (piece.pieceType == EMPTY || piece.pieceColor == EMPTY) continue;
+void Board::ComputeAttackInfo(int color, AttackInfo &attackInfo) const {
+  Bitboard occupied = GetOccupied();
+  int kingSquare = GetPieces(color, KING).GetLeastSignificantBit();
 
-    int value = 0;
-    switch (piece.pieceType) {
-      case PAWN: value = 1; break;
-      case KNIGHT: value = 3; break;
-      case BISHOP: value = 3; break;
-      case ROOK: value = 5; break;
-      case QUEEN: value = 9; break;
-      case KING: value = 100; break;
+  for (int side = WHITE; side <= BLACK; ++side) {
+    Bitboard blockers = occupied;
+    if (side != color) {
+      blockers.ClearBit(kingSquare);
     }
 
-    if (piece.pieceColor == WHITE) {
-      white_material += value;
-    } else {
-      black_material -= value;  // Assuming black pieces are negative
+    attackInfo.attacks[side].Clear();
+    for (int pieceType = PAWN; pieceType <= KING; ++pieceType) {
+      Bitboard attacked;
+      Bitboard currentPieces = GetPieces(side, pieceType);
+      while (currentPieces.IsNotEmpty()) {
+        int square = currentPieces.PopLeastSignificantBit();
+        switch (pieceType) {
+          case PAWN:
+            attacked |= pawnCaptureMoves[side][square];
+            break;
+          case KNIGHT:
+            attacked |= knightMoves[square];
+            break;
+          case BISHOP:
+            attacked |= GenerateBishopMovesFromSquare(square, blockers);
+            break;
+          case ROOK:
+            attacked |= GenerateRookMovesFromSquare(square, blockers);
+            break;
+          case QUEEN:
+            attacked |= GenerateBishopMovesFromSquare(square, blockers) | GenerateRookMovesFromSquare(square, blockers);
+            break;
+          case KING:
+            attacked |= kingMoves[square];
+            break;
+        }
+      }
+      attackInfo.attackedBy[side][pieceType] = attacked;
+      attackInfo.attacks[side] |= attacked;
+    }
+  }
+
+  // Looking out from the king
+  Bitboard diagonal = GetPieces(!color, BISHOP) | GetPieces(!color, QUEEN);
+  Bitboard straight = GetPieces(!color, ROOK) | GetPieces(!color, QUEEN);
+  attackInfo.checkers = (pawnCaptureMoves[color][kingSquare] & GetPieces(!color, PAWN))
+                        | (knightMoves[kingSquare] & GetPieces(!color, KNIGHT))
+                        | (GenerateBishopMovesFromSquare(kingSquare) & diagonal)
+                        | (GenerateRookMovesFromSquare(kingSquare) & straight);
+
+  // A single piece of ours between the king and a slider lined up with it is pinned
+  attackInfo.pinned.Clear();
+  Bitboard snipers = (bishopMoves[kingSquare] & diagonal) | (rookMoves[kingSquare] & straight);
+  while (snipers.IsNotEmpty()) {
+    Bitboard between = squaresBetween[kingSquare][snipers.PopLeastSignificantBit()] & occupied;
+    if (between.Count() == 1) {
+      attackInfo.pinned |= between & byColor[color];
+    }
+  }
+
+  // The same, the other way round: checks we can give
+  int enemyKingSquare = GetPieces(!color, KING).GetLeastSignificantBit();
+  Bitboard enemyBishopLines = GenerateBishopMovesFromSquare(enemyKingSquare);
+  Bitboard enemyRookLines = GenerateRookMovesFromSquare(enemyKingSquare);
+  attackInfo.checkSquares[PAWN] = pawnCaptureMoves[!color][enemyKingSquare];
+  attackInfo.checkSquares[KNIGHT] = knightMoves[enemyKingSquare];
+  attackInfo.checkSquares[BISHOP] = enemyBishopLines;
+  attackInfo.checkSquares[ROOK] = enemyRookLines;
+  attackInfo.checkSquares[QUEEN] = enemyBishopLines | enemyRookLines;
+  attackInfo.checkSquares[KING].Clear();
+
+  attackInfo.discoveredCheckers.Clear();
+  Bitboard ourDiagonal = GetPieces(color, BISHOP) | GetPieces(color, QUEEN);
+  Bitboard ourStraight = GetPieces(color, ROOK) | GetPieces(color, QUEEN);
+  snipers = (bishopMoves[enemyKingSquare] & ourDiagonal) | (rookMoves[enemyKingSquare] & ourStraight);
+  while (snipers.IsNotEmpty()) {
+    Bitboard between = squaresBetween[enemyKingSquare][snipers.PopLeastSignificantBit()] & occupied;
+    if (between.Count() == 1) {
+      attackInfo.discoveredCheckers |= between & byColor[color];
+    }
+  }
+}
+
+bool Board::IsPseudoLegal(Move move, int color) const {
+  Bitboard occupied = GetOccupied();
+  int from = move.fromSquare;
+  int to = move.toSquare;
+  if (from < 0 || from > 63 || to < 0 || to > 63 || from == to
+      || !byColor[color].IsSet(from) || byColor[color].IsSet(to)) {
+    return false;
+  }
+
+  int pieceType = GetPieceAt(from).pieceType;
+
+  // Pawns reaching the last rank promote, nothing else does
+  bool lastRank = color == WHITE ? to >= 56 : to <= 7;
+  if (pieceType == PAWN && lastRank) {
+    if (move.promotionPiece < KNIGHT || move.promotionPiece > QUEEN) {
+      return false;
+    }
+  } else if (move.promotionPiece != EMPTY) {
+    return false;
+  }
+
+  switch (pieceType) {
+    case PAWN: {
+      int forward = color == WHITE ? 8 : -8;
+      if (pawnCaptureMoves[color][from].IsSet(to)) {
+        return byColor[!color].IsSet(to) || to == GetEnPassantSquare();
+      }
+      if (to == from + forward) {
+        return !occupied.IsSet(to);
+      }
+      bool startRank = color == WHITE ? from / 8 == 1 : from / 8 == 6;
+      return startRank && to == from + 2 * forward && !occupied.IsSet(from + forward) && !occupied.IsSet(to);
+    }
+    case KNIGHT:
+      return knightMoves[from].IsSet(to);
+    case BISHOP:
+      return bishopMoves[from].IsSet(to) && (squaresBetween[from][to] & occupied).IsEmpty();
+    case ROOK:
+      return rookMoves[from].IsSet(to) && (squaresBetween[from][to] & occupied).IsEmpty();
+    case QUEEN:
+      return queenMoves[from].IsSet(to) && (squaresBetween[from][to] & occupied).IsEmpty();
+    case KING:
+      if (kingMoves[from].IsSet(to)) {
+        return true;
+      }
+      // Castling, with the right still there and the squares in between empty
+      if (from == (color == WHITE ? 4 : 60) && std::abs(to - from) == 2) {
+        bool kingside = to > from;
+        int right = color == WHITE ? (kingside ? WHITE_KINGSIDE_CASTLE : WHITE_QUEENSIDE_CASTLE)
+                                   : (kingside ? BLACK_KINGSIDE_CASTLE : BLACK_QUEENSIDE_CASTLE);
+        Bitboard empty = color == WHITE ? (kingside ? WHITE_KINGSIDE_EMPTY_SQUARES_MASK : WHITE_QUEENSIDE_EMPTY_SQUARES_MASK)
+                                        : (kingside ? BLACK_KINGSIDE_EMPTY_SQUARES_MASK : BLACK_QUEENSIDE_EMPTY_SQUARES_MASK);
+        return (GetCastlingRights() & right) && (occupied & empty).IsEmpty();
+      }
+      return false;
+  }
+  return false;
+}
+
+bool Board::IsLegal(Move move, int color, const AttackInfo &attackInfo) const {
+  int from = move.fromSquare;
+  int to = move.toSquare;
+  int kingSquare = GetPieces(color, KING).GetLeastSignificantBit();
+  const Bitboard &enemyAttacks = attackInfo.attacks[!color];
+
+  if (from == kingSquare) {
+    if (std::abs(to - from) == 2) {
+      // Not out of, through or into check
+      Bitboard passing = to > from ? (color == WHITE ? WHITE_KINGSIDE_PASSING_KING_SQUARE : BLACK_KINGSIDE_PASSING_KING_SQUARE)
+                                   : (color == WHITE ? WHITE_QUEENSIDE_PASSING_KING_SQUARE : BLACK_QUEENSIDE_PASSING_KING_SQUARE);
+      return attackInfo.checkers.IsEmpty() && (enemyAttacks & passing).IsEmpty();
+    }
+    return !enemyAttacks.IsSet(to);
+  }
+
+  if (to == GetEnPassantSquare() && GetPieces(color, PAWN).IsSet(from)) {
+    Board afterMove = *this;
+    afterMove.MakeMove(move, color);
+    return !afterMove.IsInCheck(color);
+  }
+
+  int checks = attackInfo.checkers.Count();
+  if (checks >= 2) {
+    return false;
+  }
+  if (checks == 1) {
+    int checker = attackInfo.checkers.GetLeastSignificantBit();
+    if (to != checker && !squaresBetween[kingSquare][checker].IsSet(to)) {
+      return false;
+    }
+  }
+  return !attackInfo.pinned.IsSet(from) || lineThrough[kingSquare][from].IsSet(to);
+}
+
+bool Board::GivesCheck(Move move, int color, const AttackInfo &attackInfo) const {
+  Bitboard occupied = GetOccupied();
+  int from = move.fromSquare;
+  int to = move.toSquare;
+  int enemyKingSquare = GetPieces(!color, KING).GetLeastSignificantBit();
+  int pieceType = GetPieceAt(from).pieceType;
+
+  // Moving off the line between one of our sliders and the king
+  if (attackInfo.discoveredCheckers.IsSet(from) && !lineThrough[enemyKingSquare][from].IsSet(to)) {
+    return true;
+  }
+
+  if (move.promotionPiece != EMPTY) {
+    // The pawn may have stood in the new piece's way
+    Bitboard blockers = occupied;
+    blockers.ClearBit(from);
+    Bitboard attacks;
+    switch (move.promotionPiece) {
+      case KNIGHT:
+        attacks = knightMoves[to];
+        break;
+      case BISHOP:
+        attacks = GenerateBishopMovesFromSquare(to, blockers);
+        break;
+      case ROOK:
+        attacks = GenerateRookMovesFromSquare(to, blockers);
+        break;
+      case QUEEN:
+        attacks = GenerateBishopMovesFromSquare(to, blockers) | GenerateRookMovesFromSquare(to, blockers);
+        break;
     }
+    return attacks.IsSet(enemyKingSquare);
+  }
+
+  if (attackInfo.checkSquares[pieceType].IsSet(to)) {
+    return true;
   }
-  return white_material + black_material;  // Will be positive if white is winning, negative if black is
+
+  // Taking en passant clears two squares, which can open a line in ways the sets above miss
+  if (pieceType == PAWN && to == GetEnPassantSquare()) {
+    Board afterMove = *this;
+    afterMove.MakeMove(move, color);
+    return afterMove.IsInCheck(!color);
+  }
+
+  // Castling: the rook may check from its new square
+  if (pieceType == KING && std::abs(to - from) == 2) {
+    int rookFrom = to > from ? from + 3 : from - 4;
+    int rookTo = to > from ? from + 1 : from - 1;
+    Bitboard blockers = occupied;
+    blockers.ClearBit(from);
+    blockers.ClearBit(rookFrom);
+    blockers.SetBit(to);
+    blockers.SetBit(rookTo);
+    return GenerateRookMovesFromSquare(rookTo, blockers).IsSet(enemyKingSquare);
+  }
+
+  return false;
 }
 
-int Board::EvaluateBoard() {
+int Board::EvaluateMaterial() const {
+  int material = 0;
+
+  for (int pieceType = PAWN; pieceType <= KING; ++pieceType) {
+    material += materialValues[pieceType] * (GetPieces(WHITE, pieceType).Count() - GetPieces(BLACK, pieceType).Count());
+  }
+  return material;  // Will be positive if white is winning, negative if black is
+}
+
+int Board::EvaluateBoard() const {
   int score = 0;
 
   for (int square = 0; square < 64; ++square) {
@@ -387,76 +838,73 @@ int Board::EvaluateBoard() {
     score += subScore;
   }
 
-  return score + (EvaluateMaterial() * 10);
+  return score + EvaluateMaterial();
 }
 
 
-bool Board::IsMovePuttingKingInCheck(Move move, int color, int pieceType) {
-  // Temporarily make the move on the board
-  Bitboard originalPiece = pieces[color][pieceType];
-  pieces[color][pieceType].ClearBit(move.fromSquare);
-  pieces[color][pieceType].SetBit(move.toSquare);
+bool Board::IsMovePuttingKingInCheck(Move move, int color) {
+  // Play the move on a copy, so captures (en passant included) are accounted for
+  Board afterMove = *this;
+  afterMove.MakeMove(move, color);
 
-  // Update the occupied squares
-  Bitboard originalOccupied = occupied;
-  occupied.ClearBit(move.fromSquare);
-  occupied.SetBit(move.toSquare);
+  return afterMove.IsInCheck(color);
+}
 
-  // Generate all squares attacked by the opponent
-  Bitboard attackedSquares = GenerateAllAttackedSquares(!color);
+bool Board::IsEnPassantHashed() const {
+  if (enPassantSquare == EMPTY) {
+    return false;
+  }
+  // the side that double pushed is the one that can't take
+  int pusher = enPassantSquare / 8 == 2 ? WHITE : BLACK;
+  return (pawnCaptureMoves[pusher][enPassantSquare] & GetPieces(!pusher, PAWN)).IsNotEmpty();
+}
 
-  // Check if the king is in an attacked square
-  bool isCheck = attackedSquares.IsSet(pieces[color][KING].GetLeastSignificantBit());
+uint64_t Board::ComputeKey(int color) const {
+  uint64_t computed = 0;
+  for (int c = WHITE; c <= BLACK; ++c) {
+    for (int piece = PAWN; piece <= KING; ++piece) {
+      Bitboard bb = GetPieces(c, piece);
+      while (bb.IsNotEmpty()) {
+        computed ^= zobrist.pieces[c][piece][bb.PopLeastSignificantBit()];
+      }
+    }
+  }
 
-  // Unmake the move
-  pieces[color][pieceType] = originalPiece;
-  occupied = originalOccupied;
+  computed ^= zobrist.castling[GetCastlingRights()];
+  if (IsEnPassantHashed()) {
+    computed ^= zobrist.enPassant[GetEnPassantSquare() & 7];
+  }
+  if (color == BLACK) {
+    computed ^= zobrist.side;
+  }
+  return computed;
+}
 
-  return isCheck;
+bool Board::IsCapture(Move move) const {
+  if (GetOccupied().IsSet(move.toSquare)) {
+    return true;
+  }
+  return move.toSquare == GetEnPassantSquare() && byType[PAWN].IsSet(move.fromSquare);
 }
 
-// Function to generate all attacked squares by a given color
-Bitboard Board::GenerateAllAttackedSquares(int color) {
-    Bitboard attackedSquares;
-  
-    for (int pieceType = PAWN; pieceType <= KING; ++pieceType) {
-        Bitboard currentPieces = pieces[color][pieceType];
-        
-        while (!currentPieces.IsEmpty()) {
-            int square = currentPieces.PopLeastSignificantBit();
-            
-            Bitboard potentialAttacks;
-            switch (pieceType) {
-                case PAWN:
-                    potentialAttacks = pawnCaptureMoves[color][square];
-                    break;
-                case KNIGHT:
-                    potentialAttacks = knightMoves[square];
-                    break;
-                case BISHOP:
-                    potentialAttacks = GenerateBishopMovesFromSquare(square);
-                    break;
-                case ROOK:
-                    potentialAttacks = GenerateRookMovesFromSquare(square);
-                    break;
-                case QUEEN:
-                    potentialAttacks = GenerateBishopMovesFromSquare(square) | GenerateRookMovesFromSquare(square);
-                    break;
-                case KING:
-                    potentialAttacks = kingMoves[square];
-                    break;
-            }
+bool Board::IsInCheck(int color) const {
+  return IsSquareAttacked(GetPieces(color, KING).GetLeastSignificantBit(), !color);
+}
 
-            // Add these potential attack squares to the overall attacked squares
-            attackedSquares |= potentialAttacks;
-        }
-    }
-  
-    return attackedSquares;
+bool Board::HasNonPawnMaterial(int color) const {
+  return (GetPieces(color, KNIGHT) | GetPieces(color, BISHOP) | GetPieces(color, ROOK) | GetPieces(color, QUEEN)).IsNotEmpty();
 }
 
+bool Board::IsInsufficientMaterial() const {
+  int count = GetOccupied().Count();
+  if (count == 2) {
+    return true;
+  }
+  Bitboard minors = GetPieces(WHITE, KNIGHT) | GetPieces(WHITE, BISHOP) | GetPieces(BLACK, KNIGHT) | GetPieces(BLACK, BISHOP);
+  return count == 3 && minors.IsNotEmpty();
+}
 
-Bitboard Board::GenerateRookMovesFromSquare(int square) {
+Bitboard Board::GenerateRookMovesFromSquare(int square, Bitboard blockers) const {
   Bitboard attacks;
 
   Bitboard fileMask;
@@ -464,35 +912,35 @@ Bitboard Board::GenerateRookMovesFromSquare(int square) {
   fileMask.SetBoard(0x0101010101010101 << (square & 7));
   rankMask.SetBoard(0xFF << (8 * (square >> 3)));
 
+  // North (up the file), the first blocker is attacked as well
   for (int to = square + 8; to <= 63; to += 8) {
-        if (occupied.IsSet(to)) break;
         attacks.SetBit(to);
+        if (blockers.IsSet(to)) break;
     }
 
     // South (down the file)
     for (int to = square - 8; to >= 0; to -= 8) {
-        if (occupied.IsSet(to)) break;
         attacks.SetBit(to);
+        if (blockers.IsSet(to)) break;
     }
 
     // East (along the rank to the right)
     for (int to = square + 1; to % 8 != 0; ++to) {
-        if (occupied.IsSet(to)) break;
         attacks.SetBit(to);
+        if (blockers.IsSet(to)) break;
     }
 
     // West (along the rank to the left)
     for (int to = square - 1; to % 8 != 7 && to >= 0; --to) {
-        if (occupied.IsSet(to)) break;
         attacks.SetBit(to);
+        if (blockers.IsSet(to)) break;
     }
 
     return attacks;
 }
 
-Bitboard Board::GenerateBishopMovesFromSquare(int square) {
+Bitboard Board::GenerateBishopMovesFromSquare(int square, Bitboard blockers) const {
     Bitboard moves;
-    Bitboard blockers;
     int toSquare;
 
     // Directions: NW, NE, SW, SE
@@ -519,8 +967,7 @@ Bitboard Board::GenerateBishopMovesFromSquare(int square) {
             moves |= bb;
 
             // If this square is occupied, we can't jump over it, break out
-            blockers = occupied & bb;
-            if (!blockers.IsEmpty()) {
+            if ((blockers & bb).IsNotEmpty()) {
                 break;
             }
         }
@@ -532,9 +979,7 @@ Bitboard Board::GenerateBishopMovesFromSquare(int square) {
 
 Bitboard Board::MaskOffIllegalMoves(Bitboard potentialMoves, int color, int pieceType, int square) {
   // Mask off squares that contain pieces of the same color
-  for (int piece = PAWN; piece <= KING; ++piece) {
-    potentialMoves &= ~pieces[color][piece];
-  }
+  potentialMoves &= ~byColor[color];
 
   if (pieceType == ROOK || pieceType == BISHOP || pieceType == QUEEN) {
     Bitboard slidingMoves;
@@ -557,7 +1002,7 @@ Bitboard Board::MaskOffIllegalMoves(Bitboard potentialMoves, int color, int piec
   return potentialMoves;
 }
 
-void Board::AddMovesToList(std::vector<Move> &moveList, Bitboard legalMoves, int fromSquare, int color, int pieceType) {
+void Board::AddMovesToList(MoveList &moveList, Bitboard legalMoves, int fromSquare, int pieceType) {
 
   while (!legalMoves.IsEmpty()) {
     int toSquare = legalMoves.PopLeastSignificantBit();
@@ -566,61 +1011,56 @@ void Board::AddMovesToList(std::vector<Move> &moveList, Bitboard legalMoves, int
       for (int piece = KNIGHT; piece < KING; ++piece) {
         Move promotionMove(fromSquare, toSquare);
         promotionMove.promotionPiece = piece;
-        if (IsMovePuttingKingInCheck(promotionMove, color, pieceType)) {
-          continue;
-        }
-        moveList.push_back(promotionMove);
+        moveList.Add(promotionMove);
       } 
-    }
-    if (IsMovePuttingKingInCheck(move, color, pieceType)) {
       continue;
     }
-    moveList.push_back(move);
+    moveList.Add(move);
   }
 }
 
-bool Board::IsSquareAttacked(int square, int attackerColor) {
+bool Board::IsSquareAttacked(int square, int attackerColor) const {
     // For each type of attacking piece, generate the moves that would attack the square.
     // Then intersect it with the positions of those pieces on the board. If non-empty, the square is attacked.
   
     // Check for pawn attacks
-    Bitboard potentialPawnAttacks = (attackerColor == WHITE) ? pawnMoves[BLACK][square] : pawnMoves[WHITE][square];
-    if ((potentialPawnAttacks & pieces[attackerColor][PAWN]).IsNotEmpty()) {
+    Bitboard potentialPawnAttacks = pawnCaptureMoves[!attackerColor][square];
+    if ((potentialPawnAttacks & GetPieces(attackerColor, PAWN)).IsNotEmpty()) {
         return true;
     }
 
     // Check for knight attacks
-    if ((knightMoves[square] & pieces[attackerColor][KNIGHT]).IsNotEmpty()) {
+    if ((knightMoves[square] & GetPieces(attackerColor, KNIGHT)).IsNotEmpty()) {
         return true;
     }
 
     // Check for bishop attacks
-    Bitboard bishopAttackers = GenerateBishopMovesFromSquare(square) & pieces[attackerColor][BISHOP];
+    Bitboard bishopAttackers = GenerateBishopMovesFromSquare(square) & GetPieces(attackerColor, BISHOP);
     if (bishopAttackers.IsNotEmpty()) {
         return true;
     }
 
     // Check for rook attacks
-    Bitboard rookAttackers = GenerateRookMovesFromSquare(square) & pieces[attackerColor][ROOK];
+    Bitboard rookAttackers = GenerateRookMovesFromSquare(square) & GetPieces(attackerColor, ROOK);
     if (rookAttackers.IsNotEmpty()) {
         return true;
     }
 
     // Check for queen attacks
-    Bitboard queenAttackers = (GenerateBishopMovesFromSquare(square) | GenerateRookMovesFromSquare(square)) & pieces[attackerColor][QUEEN];
+    Bitboard queenAttackers = (GenerateBishopMovesFromSquare(square) | GenerateRookMovesFromSquare(square)) & GetPieces(attackerColor, QUEEN);
     if (queenAttackers.IsNotEmpty()) {
         return true;
     }
 
     // Check for king attacks
-    if ((kingMoves[square] & pieces[attackerColor][KING]).IsNotEmpty()) {
+    if ((kingMoves[square] & GetPieces(attackerColor, KING)).IsNotEmpty()) {
         return true;
     }
   
     return false;
 }
 
-bool Board::IsSquareAttacked(Bitboard targetSquares, int attackerColor) {
+bool Board::IsSquareAttacked(Bitboard targetSquares, int attackerColor) const {
     while (!targetSquares.IsEmpty()) {
         int square = targetSquares.PopLeastSignificantBit();
         if (IsSquareAttacked(square, attackerColor)) {
@@ -630,39 +1070,24 @@ bool Board::IsSquareAttacked(Bitboard targetSquares, int attackerColor) {
     return false;
 }
 
-ColoredPiece Board::GetPieceAt(int square) {
+ColoredPiece Board::GetPieceAt(int square) const {
   ColoredPiece piece;
   piece.pieceColor = EMPTY;
   piece.pieceType = EMPTY;
   for (int color = WHITE; color <= BLACK; ++color) {
-    for (int pieceType = PAWN; pieceType <= KING; ++pieceType) {
-      if (pieces[color][pieceType].IsSet(square)) {
-        piece.pieceType = pieceType;
-        piece.pieceColor = color;
-        return piece;
-      }
+    if (byColor[color].IsSet(square)) {
+      piece.pieceColor = color;
+      piece.pieceType = GetPieceTypeAt(square);
     }
   }
-
   return piece;
 }
 
-int MiniMax(Board board, int depth, bool isMaximizing) {
-  if (depth == 0) {
-    return board.EvaluateBoard();
-  }
-
-  int bestValue = isMaximizing ? -9999 : 9999;
-
-  for (Move move : board.GenerateLegalMoves(isMaximizing ? WHITE : BLACK)) {
-    Board tempBoard = board;
-    tempBoard.MakeMove(move, isMaximizing ? WHITE : BLACK); // set color to !isMaximizing
-    int boardValue = MiniMax(tempBoard, depth - 1, !isMaximizing);
-
-    bestValue = isMaximizing ? 
-      std::max(bestValue, boardValue) : 
-      std::min(bestValue, boardValue);
+int Board::GetPieceTypeAt(int square) const {
+  for (int pieceType = PAWN; pieceType < KING; ++pieceType) {
+    if (byType[pieceType].IsSet(square)) {
+      return pieceType;
+    }
   }
-
-  return bestValue;
+  return KING;
 }
@@ -1,6 +1,8 @@
 #ifndef NP_BOARD_HPP
 #define NP_BOARD_HPP
 
+#include <cstdint>
+#include <string>
 #include <vector>
 
 #include "Bitboard.hpp"
@@ -21,6 +23,28 @@ struct ColoredPiece {
   int pieceColor;
 };
 
+// What the pieces of a position attack, worked out once per position and then
+// shared by move generation, check detection and evaluation. Checkers and
+// pinned are from the view of the side it was computed for. The opponent's
+// attacks look through that side's king, so the king can't step back along
+// the line of a slider checking it.
+struct AttackInfo {
+  Bitboard attackedBy[2][6];
+  Bitboard attacks[2];
+  Bitboard checkers;
+  Bitboard pinned;
+  // Squares a piece of each type would give check from
+  Bitboard checkSquares[6];
+  // Our pieces that uncover a check on the other king by moving off the line
+  Bitboard discoveredCheckers;
+};
+
+// The counters only the repetition and fifty-move rules look at
+struct StateInfo {
+  uint16_t halfmoveClock = 0;
+  uint16_t pliesFromNull = 0;
+};
+
 class Board {
 public:
   Board();
@@ -28,44 +52,139 @@ public:
   void Reset();
   void Log();
 
+  // Setting up an arbitrary position: Clear, SetPiece for every piece, then
+  // SetState once, which also computes the key
+  void Clear();
+  void SetPiece(int square, int color, int pieceType);
+  void SetState(int color, int castlingRights, int enPassantSquare, int halfmoveClock);
+
+  // FEN import, the halfmove and fullmove fields may be left out (as in EPD).
+  // Returns false and leaves the board as it was if the position isn't valid.
+  bool FromFEN(const std::string &fen, int &color);
+  std::string ToFEN(int color, int fullmoveNumber = 1) const;
+
   void MakeMove(Move move, int color);
+  // Passes the turn, only used by the search
+  void MakeNullMove();
   
   std::vector<Move> GenerateLegalMoves(int color);
+  void GenerateLegalMoves(int color, MoveList &moveList);
+  // With the attacks of this position for color, when the caller already has them
+  void GenerateLegalMoves(int color, MoveList &moveList, const AttackInfo &attackInfo);
 
+  void ComputeAttackInfo(int color, AttackInfo &attackInfo) const;
+
+  // Whether a legal move of color checks the other king, without making it
+  bool GivesCheck(Move move, int color, const AttackInfo &attackInfo) const;
+
+  // Checks a move from elsewhere (the hash table, a killer, user input) without
+  // generating any: IsPseudoLegal that the piece can make it as the board
+  // stands, then IsLegal that it doesn't leave the king in check.
+  bool IsPseudoLegal(Move move, int color) const;
+  bool IsLegal(Move move, int color, const AttackInfo &attackInfo) const;
+
+  // Fills the move tables every board shares, the first call only
   void InitMoves();
 
-  int EvaluateMaterial();
-  int EvaluateBoard();
+  int EvaluateMaterial() const;
+  int EvaluateBoard() const;
+
+  inline Bitboard GetPieces(int color, int pieceType) const {
+    return byType[pieceType] & byColor[color];
+  }
+
+  inline Bitboard GetPieces(int color) const {
+    return byColor[color];
+  }
+
+  inline Bitboard GetOccupied() const {
+    return byColor[WHITE] | byColor[BLACK];
+  }
+
+  inline int CountPieces() const {
+    return GetOccupied().Count();
+  }
+
+  // Zobrist key of the position, kept up to date by MakeMove
+  inline uint64_t GetKey() const {
+    return key;
+  }
+
+  // Plies since the last capture or pawn move
+  inline int GetHalfmoveClock() const {
+    return state.halfmoveClock;
+  }
+
+  // Plies since the last null move, repetitions can't reach past it
+  inline int GetPliesFromNull() const {
+    return state.pliesFromNull;
+  }
+
+  // Computes the key from scratch, for the given side to move
+  uint64_t ComputeKey(int color) const;
+
+  // Square a pawn can capture en passant on, or EMPTY
+  inline int GetEnPassantSquare() const {
+    return enPassantSquare;
+  }
+  // Mask of the WHITE_KINGSIDE_CASTLE .. BLACK_QUEENSIDE_CASTLE rights
+  inline int GetCastlingRights() const {
+    return castlingRights;
+  }
+  inline bool HasCastlingRights() const {
+    return castlingRights != 0;
+  }
+  bool IsCapture(Move move) const;
+  bool IsInCheck(int color) const;
+  bool HasNonPawnMaterial(int color) const;
+  // Only kings left, or kings and a single knight or bishop
+  bool IsInsufficientMaterial() const;
+
+  ColoredPiece GetPieceAt(int square) const;
 
 private:
+  // Type of the piece on an occupied square
+  int GetPieceTypeAt(int square) const;
 
-  bool IsMovePuttingKingInCheck(Move move, int color, int pieceType);
-  Bitboard GenerateAllAttackedSquares(int color);
+  // Both keep the key up to date
+  void PutPiece(int square, int color, int pieceType);
+  void RemovePiece(int square, int color, int pieceType);
 
-  Bitboard GenerateRookMovesFromSquare(int square);
-  Bitboard GenerateBishopMovesFromSquare(int square);
+  bool IsMovePuttingKingInCheck(Move move, int color);
+
+  inline Bitboard GenerateRookMovesFromSquare(int square) const {
+    return GenerateRookMovesFromSquare(square, GetOccupied());
+  }
+  inline Bitboard GenerateBishopMovesFromSquare(int square) const {
+    return GenerateBishopMovesFromSquare(square, GetOccupied());
+  }
+  // Sliding attacks stopped by the given pieces instead of the board's
+  Bitboard GenerateRookMovesFromSquare(int square, Bitboard blockers) const;
+  Bitboard GenerateBishopMovesFromSquare(int square, Bitboard blockers) const;
 
   Bitboard MaskOffIllegalMoves(Bitboard potentialMoves, int color, int pieceType, int square);
-  void AddMovesToList(std::vector<Move> &moveList, Bitboard legalMoves, int fromSquare, int color, int pieceType);
+  void AddMovesToList(MoveList &moveList, Bitboard legalMoves, int fromSquare, int pieceType);
 
-  bool IsSquareAttacked(int square, int attackerColor);
-  bool IsSquareAttacked(Bitboard targetSquares, int attackerColor);
+  bool IsSquareAttacked(int square, int attackerColor) const;
+  bool IsSquareAttacked(Bitboard targetSquares, int attackerColor) const;
 
-  ColoredPiece GetPieceAt(int square);
+  // Whether the en passant square goes into the key: only when a pawn can take
+  bool IsEnPassantHashed() const;
 
 private:
-  Bitboard pieces[2][6];
-  Bitboard occupied;
-  Bitboard occupiedColor[2];
-
-  bool canEnPassant;
-  Move lastMove = {0, 0};
-
-  bool kingMoved[2] = {false, false};
-  bool rookMoved[2][2] = {{false, false}, {false, false}};
+  // A piece is in one type and one color set, the pieces of a side are the
+  // intersection. The eight sets fill one cache line.
+  Bitboard byType[6];
+  Bitboard byColor[2];
+
+  uint64_t key = 0;
+  uint8_t castlingRights = 0;
+  int8_t enPassantSquare = EMPTY;
+  StateInfo state;
 };
 
-int MiniMax(Board board, int depth, bool isMaximizing);
+// The search copies a board for every move it makes
+static_assert(sizeof(Board) == 80, "Board is the bitboards, the key and 8 bytes of state");
 
 #define WHITE_QUEENSIDE_CASTLE_TO_SQAURE 2
 #define WHITE_KINGSIDE_CASTLE_TO_SQAURE 6
@@ -81,6 +200,11 @@ int MiniMax(Board board, int depth, bool isMaximizing);
 #define WHITE_KINGSIDE_ROOK_FROM_SQUARE 7
 #define BLACK_QUEENSIDE_ROOK_FROM_SQUARE 56
 #define BLACK_KINGSIDE_ROOK_FROM_SQUARE 63
+// castling rights
+#define WHITE_KINGSIDE_CASTLE 1
+#define WHITE_QUEENSIDE_CASTLE 2
+#define BLACK_KINGSIDE_CASTLE 4
+#define BLACK_QUEENSIDE_CASTLE 8
 
 
 #endif // NP_BOARD_HPP
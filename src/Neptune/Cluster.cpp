@@ -0,0 +1,547 @@
+#include "Cluster.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <sstream>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Where sends have no such flag, SIGPIPE is left to the application
+#if !defined(_WIN32) && !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+// Messages are a header and then bytes of payload, in native byte order, as
+// every host of a cluster runs the same build
+enum ClusterMessage : uint32_t {
+  MESSAGE_SEARCH,   // to a worker: the search, as text
+  MESSAGE_RESULT,   // from a worker: what it found, as text
+  MESSAGE_ENTRIES,  // either way: ExportedEntry records
+  MESSAGE_QUIT      // to a worker: stop serving
+};
+
+struct MessageHeader {
+  uint32_t type;
+  uint32_t bytes;
+};
+
+// Larger messages mean the stream is out of step
+#define MAX_MESSAGE_BYTES (64 * 1024 * 1024)
+
+struct ClusterCoordinator::Worker {
+  int connection;
+  std::mutex writeMutex;
+  std::thread reader;
+  // Under the coordinator's mutex
+  bool connected = true;
+  bool searching = false;
+  std::string result;
+};
+
+#ifndef _WIN32
+
+static bool SendAll(int connection, const void *data, size_t bytes) {
+  const char *bytesLeft = static_cast<const char *>(data);
+  while (bytes) {
+    // A peer gone mid-message is a failed send, not a SIGPIPE for the whole process
+    ssize_t sent = send(connection, bytesLeft, bytes, MSG_NOSIGNAL);
+    if (sent <= 0) {
+      return false;
+    }
+    bytesLeft += sent;
+    bytes -= sent;
+  }
+  return true;
+}
+
+static bool ReceiveAll(int connection, void *data, size_t bytes) {
+  char *bytesLeft = static_cast<char *>(data);
+  while (bytes) {
+    ssize_t received = recv(connection, bytesLeft, bytes, 0);
+    if (received <= 0) {
+      return false;
+    }
+    bytesLeft += received;
+    bytes -= received;
+  }
+  return true;
+}
+
+// The caller holds the connection's write lock
+static bool SendMessage(int connection, uint32_t type, const void *data, size_t bytes) {
+  MessageHeader header{type, static_cast<uint32_t>(bytes)};
+  return SendAll(connection, &header, sizeof(header)) && SendAll(connection, data, bytes);
+}
+
+static bool ReceiveMessage(int connection, uint32_t &type, std::string &payload) {
+  MessageHeader header;
+  if (!ReceiveAll(connection, &header, sizeof(header)) || header.bytes > MAX_MESSAGE_BYTES) {
+    return false;
+  }
+  type = header.type;
+  payload.resize(header.bytes);
+  return ReceiveAll(connection, payload.data(), header.bytes);
+}
+
+// [host:]port, the loopback interface without a host
+static bool ParseAddress(const std::string &address, sockaddr_in &result) {
+  std::string host = "127.0.0.1";
+  std::string port = address;
+  size_t colon = address.rfind(':');
+  if (colon != std::string::npos) {
+    host = address.substr(0, colon);
+    port = address.substr(colon + 1);
+  }
+  if (host == "localhost") {
+    host = "127.0.0.1";
+  }
+
+  char *end;
+  long number = std::strtol(port.c_str(), &end, 10);
+  if (port.empty() || *end || number < 0 || number > 65535) {
+    return false;
+  }
+  result = {};
+  result.sin_family = AF_INET;
+  result.sin_port = htons(static_cast<uint16_t>(number));
+  return inet_pton(AF_INET, host.c_str(), &result.sin_addr) == 1;
+}
+
+// Small batches go out as soon as they are written
+static void SetNoDelay(int connection) {
+  int noDelay = 1;
+  setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+}
+
+ClusterWorker::ClusterWorker(size_t hashMegabytes, const SearchOptions &options) {
+  Board board;
+  board.InitMoves();
+
+  searcher.verbose = false;
+  searcher.options = options;
+  searcher.table.Resize(hashMegabytes);
+  searcher.table.SetExportDepth(CLUSTER_SHARE_DEPTH);
+}
+
+ClusterWorker::~ClusterWorker() {
+  if (listener != -1) {
+    ::close(listener);
+  }
+}
+
+bool ClusterWorker::Listen(const std::string &address) {
+  sockaddr_in local;
+  if (!ParseAddress(address, local)) {
+    return false;
+  }
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+  return listener != -1 && setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == 0
+         && bind(listener, reinterpret_cast<sockaddr *>(&local), sizeof(local)) == 0
+         && ::listen(listener, SOMAXCONN) == 0;
+}
+
+int ClusterWorker::Port() const {
+  sockaddr_in local{};
+  socklen_t length = sizeof(local);
+  if (getsockname(listener, reinterpret_cast<sockaddr *>(&local), &length) == -1) {
+    return 0;
+  }
+  return ntohs(local.sin_port);
+}
+
+void ClusterWorker::Run() {
+  while (true) {
+    int connection = accept(listener, nullptr, nullptr);
+    if (connection == -1) {
+      continue;
+    }
+    SetNoDelay(connection);
+    bool serving = Serve(connection);
+    ::close(connection);
+    if (!serving) {
+      break;
+    }
+  }
+}
+
+bool ClusterWorker::Serve(int connection) {
+  std::mutex writeMutex;
+  std::mutex queueMutex;
+  std::condition_variable queued;
+  std::deque<std::string> searches;
+  bool closed = false;
+  bool quit = false;
+
+  // Entries are stored as they come, also while searching; searches wait their turn
+  std::thread reader([&]() {
+    uint32_t type;
+    std::string payload;
+    while (ReceiveMessage(connection, type, payload)) {
+      if (type == MESSAGE_ENTRIES) {
+        for (size_t offset = 0; offset + sizeof(ExportedEntry) <= payload.size(); offset += sizeof(ExportedEntry)) {
+          ExportedEntry entry;
+          std::memcpy(&entry, payload.data() + offset, sizeof(entry));
+          searcher.table.Import(entry);
+        }
+      } else if (type == MESSAGE_SEARCH) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        searches.push_back(payload);
+        queued.notify_one();
+      } else if (type == MESSAGE_QUIT) {
+        quit = true;
+        break;
+      }
+    }
+    std::lock_guard<std::mutex> lock(queueMutex);
+    closed = true;
+    queued.notify_one();
+  });
+
+  std::vector<ExportedEntry> entries;
+  auto sendEntries = [&]() {
+    searcher.table.TakeExported(entries);
+    if (!entries.empty()) {
+      std::lock_guard<std::mutex> lock(writeMutex);
+      SendMessage(connection, MESSAGE_ENTRIES, entries.data(), entries.size() * sizeof(ExportedEntry));
+    }
+  };
+
+  while (true) {
+    std::string request;
+    {
+      std::unique_lock<std::mutex> lock(queueMutex);
+      queued.wait(lock, [&]() { return !searches.empty() || closed; });
+      if (searches.empty()) {
+        break;
+      }
+      request = searches.front();
+      searches.pop_front();
+    }
+
+    // clear <0|1> depth <d> nodes <n> movetime <ms> multipv <k> fen <fen> history <key ...> searchmoves <move ...>
+    std::istringstream input(request);
+    SearchLimits limits;
+    PositionHistory history;
+    std::string token, fen;
+    bool clear = false;
+    bool searchMoves = false;
+    while (input >> token) {
+      if (token == "clear") {
+        input >> clear;
+      } else if (token == "depth") {
+        input >> limits.depth;
+      } else if (token == "nodes") {
+        input >> limits.nodes;
+      } else if (token == "movetime") {
+        input >> limits.moveTime;
+      } else if (token == "multipv") {
+        input >> limits.multiPV;
+      } else if (token == "fen") {
+        for (int i = 0; i < 6 && input >> token; ++i) {
+          fen += token + " ";
+        }
+      } else if (token == "history") {
+        while (input >> token && token != "searchmoves") {
+          history.Push(std::strtoull(token.c_str(), nullptr, 16));
+        }
+        searchMoves = token == "searchmoves";
+      } else if (token == "searchmoves") {
+        searchMoves = true;
+      } else if (searchMoves && limits.searchMoves.Size() < MAX_MOVES) {
+        limits.searchMoves.Add(Move::FromAlgebraicNotation(token));
+      }
+    }
+
+    Board board;
+    int color;
+    std::ostringstream reply;
+    if (!board.FromFEN(fen, color)) {
+      reply << "error invalid position";
+    } else {
+      if (clear) {
+        searcher.table.Clear();
+        entries.clear();
+        searcher.table.TakeExported(entries);
+      }
+
+      // Passes on what the search stores while it runs
+      std::mutex exchangeMutex;
+      std::condition_variable searchDone;
+      bool done = false;
+      std::thread exchange([&]() {
+        std::unique_lock<std::mutex> lock(exchangeMutex);
+        while (!searchDone.wait_for(lock, std::chrono::milliseconds(CLUSTER_EXCHANGE_MILLISECONDS), [&]() { return done; })) {
+          sendEntries();
+        }
+      });
+      SearchResult result = searcher.Search(board, color, limits, history);
+      {
+        std::lock_guard<std::mutex> lock(exchangeMutex);
+        done = true;
+      }
+      searchDone.notify_one();
+      exchange.join();
+      sendEntries();
+
+      reply << "depth " << result.depth << " score " << result.score << " nodes " << result.nodes << " lines";
+      for (int line = 0; line < result.lineCount; ++line) {
+        reply << " " << result.lines[line].move.ToAlgebraicNotation() << " " << result.lines[line].score;
+      }
+    }
+
+    std::string text = reply.str();
+    std::lock_guard<std::mutex> lock(writeMutex);
+    SendMessage(connection, MESSAGE_RESULT, text.data(), text.size());
+  }
+
+  shutdown(connection, SHUT_RDWR);
+  reader.join();
+  return !quit;
+}
+
+ClusterCoordinator::ClusterCoordinator() {
+}
+
+ClusterCoordinator::~ClusterCoordinator() {
+  Disconnect();
+}
+
+bool ClusterCoordinator::Connect(const std::string &address) {
+  sockaddr_in remote;
+  if (!ParseAddress(address, remote)) {
+    return false;
+  }
+  int connection = socket(AF_INET, SOCK_STREAM, 0);
+  if (connection == -1) {
+    return false;
+  }
+  if (::connect(connection, reinterpret_cast<sockaddr *>(&remote), sizeof(remote)) == -1) {
+    ::close(connection);
+    return false;
+  }
+  SetNoDelay(connection);
+
+  // The readers of the workers already connected go over the list
+  std::lock_guard<std::mutex> lock(mutex);
+  workers.emplace_back(new Worker());
+  Worker &worker = *workers.back();
+  worker.connection = connection;
+  worker.reader = std::thread(&ClusterCoordinator::Receive, this, std::ref(worker));
+  return true;
+}
+
+void ClusterCoordinator::Receive(Worker &worker) {
+  uint32_t type;
+  std::string payload;
+  while (ReceiveMessage(worker.connection, type, payload)) {
+    if (type == MESSAGE_ENTRIES) {
+      // Straight on to every other worker, as the same batch. Sending may
+      // block, so over a copy of the list rather than under the lock.
+      std::vector<Worker *> others;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &other : workers) {
+          if (other.get() != &worker) {
+            others.push_back(other.get());
+          }
+        }
+      }
+      for (Worker *other : others) {
+        std::lock_guard<std::mutex> lock(other->writeMutex);
+        SendMessage(other->connection, MESSAGE_ENTRIES, payload.data(), payload.size());
+      }
+      entriesExchanged += payload.size() / sizeof(ExportedEntry);
+    } else if (type == MESSAGE_RESULT) {
+      std::lock_guard<std::mutex> lock(mutex);
+      worker.result = payload;
+      worker.searching = false;
+      resultReady.notify_all();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  worker.connected = false;
+  worker.searching = false;
+  resultReady.notify_all();
+}
+
+SearchResult ClusterCoordinator::Search(Board board, int color, const SearchLimits &limits,
+                                        const PositionHistory &history, bool clearTables) {
+  SearchResult result;
+  MoveList rootMoves;
+  board.GenerateLegalMoves(color, rootMoves);
+
+  // go searchmoves: only the listed moves, as long as one of them is legal
+  if (!limits.searchMoves.IsEmpty()) {
+    int kept = 0;
+    for (Move move : rootMoves) {
+      for (Move listed : limits.searchMoves) {
+        if (move == listed) {
+          rootMoves[kept++] = move;
+          break;
+        }
+      }
+    }
+    if (kept) {
+      rootMoves.Resize(kept);
+    }
+  }
+  if (rootMoves.IsEmpty()) {
+    result.score = board.IsInCheck(color) ? -MATE_SCORE : 0;
+    return result;
+  }
+  result.bestMove = rootMoves[0];
+
+  std::vector<Worker *> available;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &worker : workers) {
+      if (worker->connected) {
+        available.push_back(worker.get());
+      }
+    }
+  }
+  int shares = std::min<int>(available.size(), rootMoves.Size());
+  if (!shares) {
+    return result;
+  }
+
+  // Only positions since the last irreversible move can come back
+  std::ostringstream common;
+  common << "clear " << clearTables << " depth " << limits.depth << " nodes " << limits.nodes << " movetime "
+         << limits.moveTime << " multipv " << limits.multiPV << " fen " << board.ToFEN(color) << " history";
+  int kept = std::min(history.Size(), board.GetHalfmoveClock());
+  for (int distance = std::min(kept, MAX_GAME_PLY); distance >= 1; --distance) {
+    common << " " << std::hex << history.Back(distance) << std::dec;
+  }
+
+  // Moves are dealt out in turn, so the moves of one piece, which come together
+  // in generation order, are spread over the workers
+  for (int share = 0; share < shares; ++share) {
+    std::string request = common.str() + " searchmoves";
+    for (int i = share; i < rootMoves.Size(); i += shares) {
+      request += " " + rootMoves[i].ToAlgebraicNotation();
+    }
+    Worker &worker = *available[share];
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      worker.searching = true;
+      worker.result.clear();
+    }
+    std::lock_guard<std::mutex> lock(worker.writeMutex);
+    SendMessage(worker.connection, MESSAGE_SEARCH, request.data(), request.size());
+  }
+
+  std::vector<SearchLine> lines;
+  int depth = MAX_PLY;
+  std::unique_lock<std::mutex> lock(mutex);
+  for (int share = 0; share < shares; ++share) {
+    Worker &worker = *available[share];
+    resultReady.wait(lock, [&]() { return !worker.searching; });
+
+    // depth <d> score <s> nodes <n> lines <move> <score> ...
+    std::istringstream input(worker.result);
+    std::string token, move;
+    int workerDepth = 0;
+    uint64_t nodes = 0;
+    input >> token >> workerDepth >> token >> token >> token >> nodes >> token;
+    if (token != "lines") {
+      continue;
+    }
+    int score;
+    while (input >> move >> score) {
+      lines.push_back({Move::FromAlgebraicNotation(move), score});
+    }
+    depth = std::min(depth, workerDepth);
+    result.nodes += nodes;
+  }
+  if (lines.empty()) {
+    return result;
+  }
+
+  std::stable_sort(lines.begin(), lines.end(), [](const SearchLine &a, const SearchLine &b) { return a.score > b.score; });
+  result.lineCount = std::min<int>({static_cast<int>(lines.size()), std::max(limits.multiPV, 1), MAX_MULTIPV});
+  std::copy(lines.begin(), lines.begin() + result.lineCount, result.lines);
+  result.bestMove = lines[0].move;
+  result.score = lines[0].score;
+  result.depth = depth;
+  return result;
+}
+
+void ClusterCoordinator::Shutdown() {
+  for (auto &worker : workers) {
+    std::lock_guard<std::mutex> lock(worker->writeMutex);
+    SendMessage(worker->connection, MESSAGE_QUIT, nullptr, 0);
+  }
+  Disconnect();
+}
+
+void ClusterCoordinator::Disconnect() {
+  for (auto &worker : workers) {
+    shutdown(worker->connection, SHUT_RDWR);
+  }
+  for (auto &worker : workers) {
+    worker->reader.join();
+    ::close(worker->connection);
+  }
+  workers.clear();
+}
+
+#else
+
+ClusterWorker::ClusterWorker(size_t hashMegabytes, const SearchOptions &options) {
+}
+
+ClusterWorker::~ClusterWorker() {
+}
+
+bool ClusterWorker::Listen(const std::string &address) {
+  return false;
+}
+
+int ClusterWorker::Port() const {
+  return 0;
+}
+
+void ClusterWorker::Run() {
+}
+
+bool ClusterWorker::Serve(int connection) {
+  return false;
+}
+
+ClusterCoordinator::ClusterCoordinator() {
+}
+
+ClusterCoordinator::~ClusterCoordinator() {
+}
+
+bool ClusterCoordinator::Connect(const std::string &address) {
+  return false;
+}
+
+void ClusterCoordinator::Receive(Worker &worker) {
+}
+
+SearchResult ClusterCoordinator::Search(Board board, int color, const SearchLimits &limits,
+                                        const PositionHistory &history, bool clearTables) {
+  return SearchResult();
+}
+
+void ClusterCoordinator::Shutdown() {
+}
+
+void ClusterCoordinator::Disconnect() {
+}
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef NP_CLUSTER_HPP
+#define NP_CLUSTER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Search.hpp"
+
+// Table entries at least this deep are passed between the workers
+#define CLUSTER_SHARE_DEPTH 4
+// How often a searching worker sends out the entries it stored
+#define CLUSTER_EXCHANGE_MILLISECONDS 20
+
+// Searches for a ClusterCoordinator, in a process of its own, on this host or
+// another. Serves one coordinator at a time and keeps its table between
+// searches, unless a search asks for a clear one.
+class ClusterWorker {
+public:
+  ClusterWorker(size_t hashMegabytes, const SearchOptions &options);
+  ~ClusterWorker();
+
+  ClusterWorker(const ClusterWorker &) = delete;
+  ClusterWorker &operator=(const ClusterWorker &) = delete;
+
+  // [host:]port, host an IPv4 address, the loopback interface when left out.
+  // Port 0 takes any free port. False if it can't be bound.
+  bool Listen(const std::string &address);
+  int Port() const;
+  // Takes coordinators one after the other until one sends quit
+  void Run();
+
+private:
+  // False once the coordinator sent quit
+  bool Serve(int connection);
+
+private:
+  Searcher searcher;
+  int listener = -1;
+};
+
+// Searches one position on several workers. The root moves are dealt out
+// among them, each searches its share with the full window, and the results
+// are merged: the best line of any worker is the best move. While they search
+// the workers' deep table entries are passed on to the others, in batches, so
+// the positions their subtrees have in common aren't worked out twice.
+class ClusterCoordinator {
+public:
+  ClusterCoordinator();
+  ~ClusterCoordinator();
+
+  ClusterCoordinator(const ClusterCoordinator &) = delete;
+  ClusterCoordinator &operator=(const ClusterCoordinator &) = delete;
+
+  // Adds the worker at [host:]port, the loopback interface when there is no host
+  bool Connect(const std::string &address);
+  int WorkerCount() const {
+    return static_cast<int>(workers.size());
+  }
+
+  // Depth is the least any worker completed, nodes those of all workers.
+  // clearTables starts every worker from an empty table.
+  SearchResult Search(Board board, int color, const SearchLimits &limits,
+                      const PositionHistory &history = PositionHistory(), bool clearTables = false);
+
+  // Ends the workers' Run, and drops them
+  void Shutdown();
+
+  uint64_t EntriesExchanged() const {
+    return entriesExchanged;
+  }
+
+private:
+  struct Worker;
+
+  void Receive(Worker &worker);
+  void Disconnect();
+
+private:
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::mutex mutex;
+  std::condition_variable resultReady;
+  std::atomic<uint64_t> entriesExchanged{0};
+};
+
+#endif // NP_CLUSTER_HPP
@@ -0,0 +1,71 @@
+#ifndef NP_HISTORY_HPP
+#define NP_HISTORY_HPP
+
+#include <cstdint>
+
+// Keys the history keeps, the newest ones, a power of two. Only positions since
+// the last irreversible move can come back, so older ones aren't needed.
+#define MAX_GAME_PLY 1024
+
+// Stack of the Zobrist keys of the positions played so far, the current one
+// excluded. Seeded with the game moves, then pushed and popped by the search.
+// A ring underneath: past MAX_GAME_PLY pushes the oldest keys are overwritten.
+class PositionHistory {
+public:
+  inline void Clear() {
+    size = 0;
+  }
+
+  inline void Push(uint64_t key) {
+    keys[size & (MAX_GAME_PLY - 1)] = key;
+    ++size;
+  }
+
+  inline void Pop() {
+    --size;
+  }
+
+  inline int Size() const {
+    return size;
+  }
+
+  // The key pushed distance pushes ago, 1 for the last one, or 0 when it
+  // isn't kept: only the last MAX_GAME_PLY are.
+  inline uint64_t Back(int distance) const {
+    if (distance < 1 || distance > size || distance > MAX_GAME_PLY) {
+      return 0;
+    }
+    return keys[(size - distance) & (MAX_GAME_PLY - 1)];
+  }
+
+  // True if the position with this key occurred before, looking back no further
+  // than the last irreversible move (reversiblePlies) and only at positions with
+  // the same side to move.
+  inline bool IsRepetition(uint64_t key, int reversiblePlies) const {
+    for (int distance = 2; distance <= reversiblePlies && distance <= size && distance <= MAX_GAME_PLY;
+         distance += 2) {
+      if (Back(distance) == key) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // How many times the position occurred before, in the same window as IsRepetition
+  inline int Repetitions(uint64_t key, int reversiblePlies) const {
+    int count = 0;
+    for (int distance = 2; distance <= reversiblePlies && distance <= size && distance <= MAX_GAME_PLY;
+         distance += 2) {
+      if (Back(distance) == key) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+private:
+  uint64_t keys[MAX_GAME_PLY];
+  int size = 0;
+};
+
+#endif // NP_HISTORY_HPP
@@ -0,0 +1,161 @@
+#include "Match.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+
+#include "History.hpp"
+
+Game PlayGame(Searcher &white, Searcher &black, const std::string &opening, const TimeControl &timeControl,
+              const MoveCallback &onMove) {
+  Board board;
+  board.Reset();
+  PositionHistory history;
+  int color = WHITE;
+
+  std::istringstream openingMoves(opening);
+  std::string token;
+  while (openingMoves >> token) {
+    history.Push(board.GetKey());
+    board.MakeMove(Move::FromAlgebraicNotation(token), color);
+    color = !color;
+  }
+
+  Searcher *searchers[2] = {&white, &black};
+  int64_t clock[2] = {timeControl.base, timeControl.base};
+  Game game;
+
+  for (;; ++game.plies) {
+    MoveList moves;
+    board.GenerateLegalMoves(color, moves);
+
+    if (moves.IsEmpty()) {
+      bool mated = board.IsInCheck(color);
+      game.result = !mated ? DRAWN : color == WHITE ? BLACK_WINS : WHITE_WINS;
+      game.end = mated ? CHECKMATE : STALEMATE;
+      return game;
+    }
+
+    game.result = DRAWN;
+    if (board.GetHalfmoveClock() >= 100) {
+      game.end = FIFTY_MOVES;
+      return game;
+    }
+    if (history.Repetitions(board.GetKey(), board.GetHalfmoveClock()) >= 2) {
+      game.end = REPETITION;
+      return game;
+    }
+    if (board.IsInsufficientMaterial()) {
+      game.end = INSUFFICIENT_MATERIAL;
+      return game;
+    }
+    if (game.plies >= MAX_GAME_LENGTH) {
+      game.end = MAX_LENGTH;
+      return game;
+    }
+
+    SearchLimits limits;
+    limits.nodes = timeControl.nodes;
+    limits.moveTime = timeControl.moveTime;
+    if (timeControl.base) {
+      limits.moveTime = TimeForMove(clock[color], timeControl.increment, 30);
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    SearchResult result = searchers[color]->Search(board, color, limits, history);
+
+    if (timeControl.base) {
+      clock[color] -= std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+      if (clock[color] < 0) {
+        game.result = color == WHITE ? BLACK_WINS : WHITE_WINS;
+        game.end = TIME_FORFEIT;
+        return game;
+      }
+      clock[color] += timeControl.increment;
+    }
+
+    if (onMove) {
+      onMove(board, color, result);
+    }
+
+    history.Push(board.GetKey());
+    board.MakeMove(result.bestMove, color);
+    color = !color;
+  }
+}
+
+const char *GameEndName(GameEnd end) {
+  switch (end) {
+    case CHECKMATE: return "checkmate";
+    case STALEMATE: return "stalemate";
+    case REPETITION: return "repetition";
+    case FIFTY_MOVES: return "fifty moves";
+    case INSUFFICIENT_MATERIAL: return "insufficient material";
+    case MAX_LENGTH: return "max length";
+    case TIME_FORFEIT: return "time forfeit";
+  }
+  return "";
+}
+
+static double EloFromScore(double score) {
+  // Keep away from 0 and 1, where the difference is infinite
+  score = std::clamp(score, 1e-6, 1.0 - 1e-6);
+  return 400.0 * std::log10(score / (1.0 - score));
+}
+
+static double ScoreFromElo(double elo) {
+  return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+// Variance of the points scored in a single game
+static double ScoreVariance(const MatchScore &score) {
+  int games = score.Games();
+  double mean = score.Score();
+  double winDeviation = 1.0 - mean;
+  double drawDeviation = 0.5 - mean;
+  double lossDeviation = 0.0 - mean;
+  return (score.wins * winDeviation * winDeviation + score.draws * drawDeviation * drawDeviation
+          + score.losses * lossDeviation * lossDeviation) / games;
+}
+
+int MatchScore::Games() const {
+  return wins + losses + draws;
+}
+
+double MatchScore::Score() const {
+  return Games() ? (wins + draws * 0.5) / Games() : 0.5;
+}
+
+double MatchScore::Elo() const {
+  return EloFromScore(Score());
+}
+
+double MatchScore::EloMargin() const {
+  if (!Games()) {
+    return 0.0;
+  }
+  double deviation = std::sqrt(ScoreVariance(*this) / Games());
+  return (EloFromScore(Score() + 1.96 * deviation) - EloFromScore(Score() - 1.96 * deviation)) / 2.0;
+}
+
+double SPRT::LLR(const MatchScore &score) const {
+  if (!score.Games()) {
+    return 0.0;
+  }
+  double variance = ScoreVariance(score) / score.Games();
+  if (variance <= 0.0) {
+    return 0.0;
+  }
+  double score0 = ScoreFromElo(elo0);
+  double score1 = ScoreFromElo(elo1);
+  return (score1 - score0) * (2.0 * score.Score() - score0 - score1) / (2.0 * variance);
+}
+
+double SPRT::LowerBound() const {
+  return std::log(beta / (1.0 - alpha));
+}
+
+double SPRT::UpperBound() const {
+  return std::log((1.0 - beta) / alpha);
+}
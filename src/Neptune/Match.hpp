@@ -0,0 +1,81 @@
+#ifndef NP_MATCH_HPP
+#define NP_MATCH_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "Search.hpp"
+
+// Games still going after this many plies are adjudicated a draw
+#define MAX_GAME_LENGTH 400
+
+// Either a fixed budget per move (nodes and/or movetime) or a clock per game
+struct TimeControl {
+  uint64_t nodes = 0;     // per move, 0 means no limit
+  int64_t moveTime = 0;   // milliseconds per move, 0 means no limit
+  int64_t base = 0;       // milliseconds per game, 0 means no clock
+  int64_t increment = 0;  // milliseconds added after every move
+};
+
+enum GameResult {
+  WHITE_WINS,
+  BLACK_WINS,
+  DRAWN,
+};
+
+enum GameEnd {
+  CHECKMATE,
+  STALEMATE,
+  REPETITION,
+  FIFTY_MOVES,
+  INSUFFICIENT_MATERIAL,
+  MAX_LENGTH,
+  TIME_FORFEIT,
+};
+
+struct Game {
+  GameResult result;
+  GameEnd end;
+  int plies = 0;
+};
+
+// Called with every position the searchers move in, and the search result
+using MoveCallback = std::function<void(const Board &board, int color, const SearchResult &result)>;
+
+// Plays one game between two searchers, starting after the opening moves
+// (long algebraic, from the starting position)
+Game PlayGame(Searcher &white, Searcher &black, const std::string &opening, const TimeControl &timeControl,
+              const MoveCallback &onMove = nullptr);
+
+const char *GameEndName(GameEnd end);
+
+// Results of a match, from the first engine's point of view
+struct MatchScore {
+  int wins = 0;
+  int losses = 0;
+  int draws = 0;
+
+  int Games() const;
+  // Points per game, between 0 and 1
+  double Score() const;
+  double Elo() const;
+  // Half width of the 95% confidence interval of Elo()
+  double EloMargin() const;
+};
+
+// Sequential probability ratio test of H0: elo = elo0 against H1: elo = elo1,
+// stopping once the log likelihood ratio leaves [LowerBound(), UpperBound()]
+struct SPRT {
+  double elo0 = 0.0;
+  double elo1 = 5.0;
+  double alpha = 0.05;  // false positive rate
+  double beta = 0.05;   // false negative rate
+
+  // Normal approximation of the trinomial (win/draw/loss) log likelihood ratio
+  double LLR(const MatchScore &score) const;
+  double LowerBound() const;
+  double UpperBound() const;
+};
+
+#endif // NP_MATCH_HPP
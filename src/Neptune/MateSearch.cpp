@@ -0,0 +1,318 @@
+#include "MateSearch.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+// Entries a bucket has, a position goes in any of them
+#define MATE_BUCKET_ENTRIES 4
+
+// Table key of a position with this many plies left, never 0
+static uint64_t NodeKey(uint64_t key, int depth) {
+  uint64_t mixed = key ^ (static_cast<uint64_t>(depth) + 1) * 0x9E3779B97F4A7C15ull;
+  return mixed ? mixed : 1;
+}
+
+static uint32_t AddProof(uint32_t a, uint32_t b) {
+  return std::min<uint32_t>(a + b, PROOF_INFINITE);
+}
+
+MateSearcher::MateSearcher(size_t hashMegabytes) : stack(new Frame[MAX_PLY]) {
+  size_t entries = MATE_BUCKET_ENTRIES;
+  while (entries * 2 * sizeof(Entry) <= std::max<size_t>(hashMegabytes, 1) << 20) {
+    entries *= 2;
+  }
+  table.resize(entries);
+  mask = entries - 1;
+  Clear();
+}
+
+void MateSearcher::Clear() {
+  std::fill(table.begin(), table.end(), Entry{0, 0, 0, 0});
+}
+
+MateSearcher::Entry *MateSearcher::Find(uint64_t key) {
+  Entry *bucket = &table[key & mask & ~uint64_t(MATE_BUCKET_ENTRIES - 1)];
+  for (int i = 0; i < MATE_BUCKET_ENTRIES; ++i) {
+    if (bucket[i].key == key) {
+      return &bucket[i];
+    }
+  }
+  return nullptr;
+}
+
+void MateSearcher::Store(uint64_t key, uint32_t phi, uint32_t delta, uint64_t work) {
+  Entry *bucket = &table[key & mask & ~uint64_t(MATE_BUCKET_ENTRIES - 1)];
+  Entry *replaced = &bucket[0];
+  for (int i = 0; i < MATE_BUCKET_ENTRIES; ++i) {
+    if (bucket[i].key == key || bucket[i].key == 0) {
+      replaced = &bucket[i];
+      break;
+    }
+    if (bucket[i].work < replaced->work) {
+      replaced = &bucket[i];
+    }
+  }
+  *replaced = {key, phi, delta, work};
+}
+
+// Numbers of a position from the moves it has: exact when the game or the
+// plies are over, else the side to move needs one move to win and the other
+// side every one of them. Returns whether they are exact.
+static bool Estimate(int moveCount, bool inCheck, bool attacker, int depth, uint32_t &phi, uint32_t &delta) {
+  if (moveCount == 0) {
+    // Mated loses, stalemated is no mate, a loss for the side mating, as is
+    // having no checks left on the last move
+    bool wins = !inCheck && !attacker;
+    phi = wins ? 0 : PROOF_INFINITE;
+    delta = wins ? PROOF_INFINITE : 0;
+    return true;
+  }
+  if (depth == 0) {
+    // Out of plies with the defender not mated
+    phi = 0;
+    delta = PROOF_INFINITE;
+    return true;
+  }
+  phi = 1;
+  delta = moveCount;
+  return false;
+}
+
+// The moves tried: on the last move of the side mating only the checks, and
+// at the root only the search moves, as long as one of them is legal
+void MateSearcher::GenerateMoves(Board &board, int color, int depth, int ply, MoveList &moves) {
+  AttackInfo attacks;
+  board.ComputeAttackInfo(color, attacks);
+  board.GenerateLegalMoves(color, moves, attacks);
+  if (ply == 0 && !limits.searchMoves.IsEmpty()) {
+    int kept = 0;
+    for (Move move : moves) {
+      for (Move listed : limits.searchMoves) {
+        if (move == listed) {
+          moves[kept++] = move;
+          break;
+        }
+      }
+    }
+    if (kept) {
+      moves.Resize(kept);
+    }
+  }
+  if (depth == 1) {
+    int kept = 0;
+    for (Move move : moves) {
+      if (board.GivesCheck(move, color, attacks)) {
+        moves[kept++] = move;
+      }
+    }
+    moves.Resize(kept);
+  }
+}
+
+void MateSearcher::Lookup(const Board &position, int color, int depth, uint32_t &phi, uint32_t &delta) {
+  uint64_t key = NodeKey(position.GetKey(), depth);
+  Entry *entry = Find(key);
+  if (entry) {
+    phi = entry->phi;
+    delta = entry->delta;
+    return;
+  }
+
+  nodes++;
+  Board board = position;
+  MoveList moves;
+  GenerateMoves(board, color, depth, -1, moves);
+  bool inCheck = moves.IsEmpty() && board.IsInCheck(color);
+  Estimate(moves.Size(), inCheck, depth & 1, depth, phi, delta);
+  Store(key, phi, delta, 0);
+}
+
+void MateSearcher::Expand(Board &board, int color, int depth, int ply, uint32_t &phi, uint32_t &delta,
+                          uint32_t phiThreshold, uint32_t deltaThreshold) {
+  uint64_t key = NodeKey(board.GetKey(), depth);
+  uint64_t startNodes = nodes++;
+  Frame &frame = stack[ply];
+  GenerateMoves(board, color, depth, ply, frame.moves);
+  // With the root moves restricted the root's numbers are not the position's
+  bool keep = ply > 0 || limits.searchMoves.IsEmpty();
+
+  bool inCheck = frame.moves.IsEmpty() && board.IsInCheck(color);
+  if (Estimate(frame.moves.Size(), inCheck, depth & 1, depth, phi, delta)) {
+    if (keep) {
+      Store(key, phi, delta, 0);
+    }
+    return;
+  }
+
+  for (int i = 0; i < frame.moves.Size(); ++i) {
+    Board child = board;
+    child.MakeMove(frame.moves[i], color);
+    frame.keys[i] = NodeKey(child.GetKey(), depth - 1);
+  }
+
+  while (!ShouldStop()) {
+    // phi is the least delta of the children, the move to look at, delta the sum of their phis
+    int best = 0;
+    uint32_t bestPhi = 0, secondDelta = PROOF_INFINITE;
+    bool unprovable = false;
+    phi = PROOF_INFINITE;
+    delta = 0;
+    for (int i = 0; i < frame.moves.Size(); ++i) {
+      uint32_t childPhi, childDelta;
+      Entry *entry = Find(frame.keys[i]);
+      if (entry) {
+        childPhi = entry->phi;
+        childDelta = entry->delta;
+      } else {
+        Board child = board;
+        child.MakeMove(frame.moves[i], color);
+        Lookup(child, !color, depth - 1, childPhi, childDelta);
+      }
+
+      delta = AddProof(delta, childPhi);
+      unprovable |= childPhi >= PROOF_INFINITE;
+      if (childDelta < phi) {
+        secondDelta = phi;
+        phi = childDelta;
+        bestPhi = childPhi;
+        best = i;
+      } else if (childDelta < secondDelta) {
+        secondDelta = childDelta;
+      }
+    }
+    // Only a child that can't be won makes the sum infinite
+    if (!unprovable) {
+      delta = std::min(delta, PROOF_INFINITE - 1);
+    }
+
+    if (phi >= phiThreshold || delta >= deltaThreshold) {
+      break;
+    }
+
+    // The 1 + epsilon trick: stay with the child a little past the point where
+    // the second best gets ahead, rather than switching back and forth
+    uint32_t childPhiThreshold = std::min<uint64_t>(uint64_t(deltaThreshold) - delta + bestPhi, PROOF_INFINITE);
+    uint32_t childDeltaThreshold = std::min(phiThreshold, AddProof(secondDelta, secondDelta / 4 + 1));
+
+    Board child = board;
+    child.MakeMove(frame.moves[best], color);
+    uint32_t childPhi, childDelta;
+    Expand(child, !color, depth - 1, ply + 1, childPhi, childDelta, childPhiThreshold, childDeltaThreshold);
+  }
+
+  if (keep) {
+    Store(key, phi, delta, nodes - startNodes);
+  }
+}
+
+void MateSearcher::ExtractPV(Board board, int color, int depth, std::vector<Move> &pv) {
+  MoveList moves;
+  for (int ply = 0; depth > 0; --depth, ++ply) {
+    GenerateMoves(board, color, depth, ply, moves);
+    bool attacker = depth & 1;
+
+    // The move mating, or the defence whose proof took the most work
+    int chosen = -1;
+    uint64_t mostWork = 0;
+    for (int i = 0; i < moves.Size(); ++i) {
+      Board child = board;
+      child.MakeMove(moves[i], color);
+      uint64_t key = NodeKey(child.GetKey(), depth - 1);
+      Entry *entry = Find(key);
+      uint32_t phi, delta;
+      if (entry) {
+        phi = entry->phi;
+        delta = entry->delta;
+      } else {
+        Lookup(child, !color, depth - 1, phi, delta);
+        entry = Find(key);
+      }
+
+      if (attacker && delta == 0) {
+        chosen = i;
+        break;
+      }
+      uint64_t work = entry ? entry->work : 0;
+      if (!attacker && phi == 0 && (chosen == -1 || work > mostWork)) {
+        chosen = i;
+        mostWork = work;
+      }
+    }
+    if (chosen == -1) {
+      return;
+    }
+
+    pv.push_back(moves[chosen]);
+    board.MakeMove(moves[chosen], color);
+    color = !color;
+  }
+}
+
+MateResult MateSearcher::Search(Board board, int color, int maxMoves, const SearchLimits &searchLimits) {
+  limits = searchLimits;
+  startTime = std::chrono::steady_clock::now();
+  nodes = 0;
+  stopped = false;
+
+  MateResult result;
+  for (int moves = 1; moves <= std::min(maxMoves, MAX_MATE_MOVES); ++moves) {
+    int depth = 2 * moves - 1;
+    uint32_t phi, delta;
+    Expand(board, color, depth, 0, phi, delta, PROOF_INFINITE, PROOF_INFINITE);
+
+    if (phi == 0) {
+      result.status = MATE_PROVEN;
+      result.moves = moves;
+      ExtractPV(board, color, depth, result.pv);
+      if (!result.pv.empty()) {
+        result.bestMove = result.pv[0];
+      }
+    } else if (delta == 0) {
+      result.status = MATE_DISPROVEN;
+    } else {
+      result.status = MATE_UNKNOWN;
+    }
+
+    if (verbose) {
+      int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+      std::cout << "info depth " << depth;
+      if (result.status == MATE_PROVEN) {
+        std::cout << " score mate " << moves;
+      }
+      std::cout << " nodes " << nodes << " nps " << (nodes * 1000 / (elapsed + 1)) << " time " << elapsed;
+      if (result.status == MATE_PROVEN) {
+        std::cout << " pv";
+        for (Move move : result.pv) {
+          std::cout << " " << move.ToAlgebraicNotation();
+        }
+      }
+      std::cout << std::endl;
+    }
+
+    if (result.status != MATE_DISPROVEN) {
+      break;
+    }
+  }
+
+  result.nodes = nodes;
+  return result;
+}
+
+bool MateSearcher::ShouldStop() {
+  if (stopped) {
+    return true;
+  }
+
+  if (limits.nodes && nodes >= limits.nodes) {
+    stopped = true;
+  } else if (limits.stop.stop_requested()) {
+    stopped = true;
+  } else if (limits.moveTime) {
+    // Called once per child expanded, each of which looks at all its moves,
+    // so the clock is cheap enough to read every time
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+    stopped = elapsed >= limits.moveTime;
+  }
+
+  return stopped;
+}
@@ -0,0 +1,94 @@
+#ifndef NP_MATE_SEARCH_HPP
+#define NP_MATE_SEARCH_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Board.hpp"
+#include "Search.hpp"
+
+#define DEFAULT_MATE_HASH_MB 16
+// Longest mate looked for, in moves of the side mating
+#define MAX_MATE_MOVES (MAX_PLY / 2)
+// Proof and disproof numbers at least this large are infinite
+#define PROOF_INFINITE 0x3FFFFFFFu
+
+enum MateStatus {
+  MATE_UNKNOWN,    // stopped by the limits first
+  MATE_PROVEN,
+  MATE_DISPROVEN   // there is no mate within the moves asked for
+};
+
+struct MateResult {
+  MateStatus status = MATE_UNKNOWN;
+  int moves = 0;  // of the shortest mate, when proven
+  Move bestMove;
+  // The mate, with the defences that took the most work to answer, which are
+  // not always the ones holding out longest
+  std::vector<Move> pv;
+  uint64_t nodes = 0;
+};
+
+// Proves or disproves a mate for the side to move with depth-first proof-number
+// search (df-pn), which goes where the fewest moves are left to answer rather
+// than where the evaluation points. Only the plies left and whether a position
+// is mate matter to it, so it has a table of its own: the proof and disproof
+// numbers of positions at a given number of plies left. On the last move of the
+// mating side only checks are tried.
+class MateSearcher {
+public:
+  explicit MateSearcher(size_t hashMegabytes = DEFAULT_MATE_HASH_MB);
+
+  MateSearcher(const MateSearcher &) = delete;
+  MateSearcher &operator=(const MateSearcher &) = delete;
+
+  // Looks for mates of 1 up to maxMoves moves in turn, so a proven mate is
+  // the shortest. Takes the nodes, moveTime, searchMoves and stop of limits, and prints an
+  // "info" line for every length tried when verbose.
+  MateResult Search(Board board, int color, int maxMoves, const SearchLimits &limits = SearchLimits());
+
+  // Drops everything stored, keeping the size
+  void Clear();
+
+  bool verbose = true;
+
+private:
+  struct Entry {
+    uint64_t key;   // position key mixed with the plies left, 0 for an empty entry
+    uint32_t phi;   // proof number for the side to move: 0 when it wins
+    uint32_t delta; // 0 when it loses
+    uint64_t work;  // nodes spent under the entry, the least worked entry of a bucket is replaced
+  };
+
+  // Expands the node until its phi or delta reaches its threshold
+  void Expand(Board &board, int color, int depth, int ply, uint32_t &phi, uint32_t &delta,
+              uint32_t phiThreshold, uint32_t deltaThreshold);
+  // Ply -1 for a position that is not on the path searched
+  void GenerateMoves(Board &board, int color, int depth, int ply, MoveList &moves);
+  // Stored numbers, or the first estimate, of a position not expanded yet
+  void Lookup(const Board &board, int color, int depth, uint32_t &phi, uint32_t &delta);
+  void Store(uint64_t key, uint32_t phi, uint32_t delta, uint64_t work);
+  Entry *Find(uint64_t key);
+
+  void ExtractPV(Board board, int color, int depth, std::vector<Move> &pv);
+  bool ShouldStop();
+
+private:
+  std::vector<Entry> table;
+  uint64_t mask = 0;
+
+  SearchLimits limits;
+  std::chrono::steady_clock::time_point startTime;
+  uint64_t nodes = 0;
+  bool stopped = false;
+
+  struct Frame {
+    MoveList moves;
+    uint64_t keys[MAX_MOVES];  // of the positions after each move, with their plies left
+  };
+  std::unique_ptr<Frame[]> stack;
+};
+
+#endif // NP_MATE_SEARCH_HPP
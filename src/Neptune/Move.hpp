@@ -2,7 +2,7 @@
 #define NP_MOVE_HPP
 
 #include <string>
-#include <sstream>
+#include <string_view>
 
 class Move {
 public:
@@ -12,38 +12,100 @@ public:
   int promotionPiece = -1;
 
 public:
-  Move(int from, int to) : fromSquare(from), toSquare(to) {}
+  Move() : fromSquare(0), toSquare(0), isCastle(false) {}
+  Move(int from, int to) : fromSquare(from), toSquare(to), isCastle(false) {}
 
   std::string ToAlgebraicNotation() const {
-    return SquareToAlgebraic(fromSquare) + SquareToAlgebraic(toSquare);
+    char buffer[6];
+    return std::string(buffer, WriteAlgebraicNotation(buffer) - buffer);
   }
 
-  static Move FromAlgebraicNotation(const std::string& moveStr) {
-    int fromSquare = AlgebraicToSquare(moveStr.substr(0, 2));
-    int toSquare = AlgebraicToSquare(moveStr.substr(2, 2));
-    return Move(fromSquare, toSquare);
+  // Writes the move into buffer (room for 5 chars), returns the end of what was written
+  char *WriteAlgebraicNotation(char *buffer) const {
+    buffer = WriteSquare(buffer, fromSquare);
+    buffer = WriteSquare(buffer, toSquare);
+    // piece types 1..4 are knight, bishop, rook and queen
+    if (promotionPiece != -1) {
+      *buffer++ = "nbrq"[promotionPiece - 1];
+    }
+    return buffer;
+  }
+
+  static Move FromAlgebraicNotation(std::string_view moveStr) {
+    if (moveStr.size() < 4) {
+      return Move();
+    }
+    Move move(AlgebraicToSquare(moveStr.substr(0, 2)), AlgebraicToSquare(moveStr.substr(2, 2)));
+    if (moveStr.size() > 4) {
+      size_t index = std::string_view("nbrq").find(moveStr[4]);
+      if (index != std::string_view::npos) {
+        move.promotionPiece = static_cast<int>(index) + 1;
+      }
+    }
+    return move;
   }
 
   bool operator==(const Move& other) const {
-    return fromSquare == other.fromSquare && toSquare == other.toSquare;
+    return fromSquare == other.fromSquare && toSquare == other.toSquare && promotionPiece == other.promotionPiece;
   }
 
 private:
-  static std::string SquareToAlgebraic(int square) {
-    int x = square % 8;
-    int y = square / 8;  // Flip the rank because 0,0 is the bottom-left in most chess libraries
-
-    std::stringstream ss;
-    ss << char('a' + x) << (y + 1);
-    return ss.str();
+  static char *WriteSquare(char *buffer, int square) {
+    *buffer++ = char('a' + square % 8);
+    *buffer++ = char('1' + square / 8);
+    return buffer;
   }
 
-  static int AlgebraicToSquare(const std::string& str) {
+  static int AlgebraicToSquare(std::string_view str) {
     int x = str[0] - 'a';
     int y = str[1] - '1';
     return y * 8 + x;
   }
 };
 
+// No legal chess position has more than 218 moves
+#define MAX_MOVES 256
+
+// Fixed capacity move list, so move generation can run without touching the heap.
+class MoveList {
+public:
+  inline void Add(Move move) {
+    moves[count++] = move;
+  }
+
+  inline void Clear() {
+    count = 0;
+  }
+
+  // Keeps the first size moves
+  inline void Resize(int size) {
+    count = size;
+  }
+
+  inline int Size() const {
+    return count;
+  }
+
+  inline bool IsEmpty() const {
+    return count == 0;
+  }
+
+  inline Move &operator[](int index) {
+    return moves[index];
+  }
+
+  inline const Move &operator[](int index) const {
+    return moves[index];
+  }
+
+  inline Move *begin() { return moves; }
+  inline Move *end() { return moves + count; }
+  inline const Move *begin() const { return moves; }
+  inline const Move *end() const { return moves + count; }
+
+private:
+  Move moves[MAX_MOVES];
+  int count = 0;
+};
 
 #endif // NP_MOVE_HPP
@@ -0,0 +1,33 @@
+#include "PackedPosition.hpp"
+
+PackedPosition PackedPosition::FromBoard(const Board &board, int color) {
+  PackedPosition packed = {};
+  packed.occupancy = board.GetOccupied().GetBoard();
+
+  Bitboard occupied = board.GetOccupied();
+  for (int index = 0; occupied.IsNotEmpty(); ++index) {
+    ColoredPiece piece = board.GetPieceAt(occupied.PopLeastSignificantBit());
+    packed.pieces[index / 2] |= (piece.pieceColor * 6 + piece.pieceType) << (index % 2 * 4);
+  }
+
+  packed.flags = color | board.GetCastlingRights() << 1;
+  int enPassantSquare = board.GetEnPassantSquare();
+  packed.enPassant = enPassantSquare == EMPTY ? NO_EN_PASSANT : enPassantSquare;
+  packed.halfmoveClock = board.GetHalfmoveClock() < 255 ? board.GetHalfmoveClock() : 255;
+  return packed;
+}
+
+int PackedPosition::ToBoard(Board &board) const {
+  board.Clear();
+
+  Bitboard occupied;
+  occupied.SetBoard(occupancy);
+  for (int index = 0; occupied.IsNotEmpty(); ++index) {
+    int code = pieces[index / 2] >> (index % 2 * 4) & 0xF;
+    board.SetPiece(occupied.PopLeastSignificantBit(), code / 6, code % 6);
+  }
+
+  int color = flags & 1;
+  board.SetState(color, flags >> 1 & 0xF, enPassant == NO_EN_PASSANT ? EMPTY : enPassant, halfmoveClock);
+  return color;
+}
@@ -0,0 +1,30 @@
+#ifndef NP_PACKED_POSITION_HPP
+#define NP_PACKED_POSITION_HPP
+
+#include <cstdint>
+
+#include "Board.hpp"
+
+#define NO_EN_PASSANT 64
+
+// A position with its search score and game result in 32 bytes, for training
+// and tuning data. Pieces are listed in square order, one per occupied square,
+// as color * 6 + pieceType in 4 bits (low nibble first).
+struct PackedPosition {
+  uint64_t occupancy;
+  uint8_t pieces[16];
+  uint8_t flags;          // bit 0: side to move, bits 1-4: castling rights
+  uint8_t enPassant;      // square, or NO_EN_PASSANT
+  uint8_t halfmoveClock;
+  int8_t result;          // from white's view: 1 win, 0 draw, -1 loss
+  int16_t score;          // search score from white's view
+  uint16_t ply;           // plies played in the game so far
+
+  static PackedPosition FromBoard(const Board &board, int color);
+  // Sets up the board and returns the side to move
+  int ToBoard(Board &board) const;
+};
+
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition records are 32 bytes on disk");
+
+#endif // NP_PACKED_POSITION_HPP
@@ -0,0 +1,421 @@
+#include "Pgn.hpp"
+
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <sstream>
+#endif
+
+// SAN letters of the pieces, indexed by pieceType
+const std::string_view sanPieces = "PNBRQK";
+
+static bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool EndsToken(char c) {
+  return IsSpace(c) || c == '{' || c == '}' || c == '(' || c == ')' || c == ';' || c == '[' || c == ']' || c == '$';
+}
+
+static bool IsResult(std::string_view token) {
+  return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+static bool IsCastle(Board &board, Move move) {
+  return board.GetPieceAt(move.fromSquare).pieceType == KING && std::abs(move.toSquare - move.fromSquare) == 2;
+}
+
+bool ParseSAN(Board &board, int color, std::string_view san, Move &move) {
+  // Check, mate and annotation marks say nothing about the move itself
+  while (!san.empty() && std::string_view("+#!?").find(san.back()) != std::string_view::npos) {
+    san.remove_suffix(1);
+  }
+
+  MoveList moves;
+  board.GenerateLegalMoves(color, moves);
+
+  if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+    int kingSquare = color == WHITE ? 4 : 60;
+    int toSquare = san.size() == 3 ? kingSquare + 2 : kingSquare - 2;
+    for (Move legal : moves) {
+      if (legal.fromSquare == kingSquare && legal.toSquare == toSquare && IsCastle(board, legal)) {
+        move = legal;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  int promotionPiece = EMPTY;
+  if (!san.empty() && std::string_view("NBRQ").find(san.back()) != std::string_view::npos) {
+    promotionPiece = static_cast<int>(sanPieces.find(san.back()));
+    san.remove_suffix(1);
+    if (!san.empty() && san.back() == '=') {
+      san.remove_suffix(1);
+    }
+  }
+
+  int pieceType = PAWN;
+  if (!san.empty() && std::string_view("NBRQK").find(san.front()) != std::string_view::npos) {
+    pieceType = static_cast<int>(sanPieces.find(san.front()));
+    san.remove_prefix(1);
+  }
+
+  if (san.size() < 2) {
+    return false;
+  }
+  int file = san[san.size() - 2] - 'a';
+  int rank = san[san.size() - 1] - '1';
+  if (file < 0 || file > 7 || rank < 0 || rank > 7) {
+    return false;
+  }
+  int toSquare = rank * 8 + file;
+  san.remove_suffix(2);
+
+  // Whatever is left tells pieces apart: a file, a rank or both
+  int fromFile = EMPTY;
+  int fromRank = EMPTY;
+  for (char c : san) {
+    if (c >= 'a' && c <= 'h') {
+      fromFile = c - 'a';
+    } else if (c >= '1' && c <= '8') {
+      fromRank = c - '1';
+    } else if (c != 'x' && c != '-' && c != ':') {
+      return false;
+    }
+  }
+
+  int found = 0;
+  for (Move legal : moves) {
+    if (legal.toSquare != toSquare || legal.promotionPiece != promotionPiece
+        || board.GetPieceAt(legal.fromSquare).pieceType != pieceType
+        || (fromFile != EMPTY && legal.fromSquare % 8 != fromFile)
+        || (fromRank != EMPTY && legal.fromSquare / 8 != fromRank)) {
+      continue;
+    }
+    move = legal;
+    found++;
+  }
+  return found == 1;
+}
+
+char *WriteSAN(Board &board, int color, Move move, char *buffer) {
+  int pieceType = board.GetPieceAt(move.fromSquare).pieceType;
+  bool capture = board.IsCapture(move);
+
+  if (IsCastle(board, move)) {
+    const char *castle = move.toSquare > move.fromSquare ? "O-O" : "O-O-O";
+    size_t length = std::strlen(castle);
+    std::memcpy(buffer, castle, length);
+    buffer += length;
+  } else {
+    if (pieceType == PAWN) {
+      if (capture) {
+        *buffer++ = char('a' + move.fromSquare % 8);
+      }
+    } else {
+      *buffer++ = sanPieces[pieceType];
+
+      // Name the file, else the rank, else both, of the piece when another of its kind could go there too
+      MoveList moves;
+      board.GenerateLegalMoves(color, moves);
+      bool ambiguous = false, sameFile = false, sameRank = false;
+      for (Move other : moves) {
+        if (other.toSquare != move.toSquare || other.fromSquare == move.fromSquare
+            || board.GetPieceAt(other.fromSquare).pieceType != pieceType) {
+          continue;
+        }
+        ambiguous = true;
+        sameFile |= other.fromSquare % 8 == move.fromSquare % 8;
+        sameRank |= other.fromSquare / 8 == move.fromSquare / 8;
+      }
+      if (ambiguous && (!sameFile || sameRank)) {
+        *buffer++ = char('a' + move.fromSquare % 8);
+      }
+      if (ambiguous && sameFile) {
+        *buffer++ = char('1' + move.fromSquare / 8);
+      }
+    }
+
+    if (capture) {
+      *buffer++ = 'x';
+    }
+    *buffer++ = char('a' + move.toSquare % 8);
+    *buffer++ = char('1' + move.toSquare / 8);
+
+    if (move.promotionPiece != EMPTY) {
+      *buffer++ = '=';
+      *buffer++ = sanPieces[move.promotionPiece];
+    }
+  }
+
+  Board after = board;
+  after.MakeMove(move, color);
+  if (after.IsInCheck(!color)) {
+    MoveList replies;
+    after.GenerateLegalMoves(!color, replies);
+    *buffer++ = replies.IsEmpty() ? '#' : '+';
+  }
+  return buffer;
+}
+
+std::string_view PgnGame::Tag(std::string_view name) const {
+  for (const PgnTag &tag : tags) {
+    if (tag.name == name) {
+      return tag.value;
+    }
+  }
+  return {};
+}
+
+bool SetupGame(const PgnGame &game, Board &board, int &color) {
+  std::string_view fen = game.Tag("FEN");
+  if (fen.empty()) {
+    board.Reset();
+    color = WHITE;
+    return true;
+  }
+  return board.FromFEN(std::string(fen), color);
+}
+
+PgnReader::~PgnReader() {
+  Close();
+}
+
+bool PgnReader::Open(const std::string &path) {
+  Close();
+
+#ifndef _WIN32
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+  struct stat info;
+  fstat(fd, &info);
+  if (info.st_size == 0) {
+    // Nothing to map, and no games to read
+    ::close(fd);
+    return true;
+  }
+  void *mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  mappingSize = info.st_size;
+  // Games are read front to back, once
+  madvise(mapped, mappingSize, MADV_SEQUENTIAL);
+  mapping = mapped;
+  text = std::string_view(static_cast<const char *>(mapping), mappingSize);
+#else
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  storage = contents.str();
+  text = storage;
+#endif
+  return true;
+}
+
+void PgnReader::Close() {
+#ifndef _WIN32
+  if (mapping) {
+    munmap(mapping, mappingSize);
+  }
+#else
+  storage.clear();
+#endif
+  mapping = nullptr;
+  mappingSize = 0;
+  text = {};
+  position = 0;
+}
+
+void PgnReader::SkipWhitespace() {
+  while (position < text.size() && IsSpace(text[position])) {
+    position++;
+  }
+}
+
+void PgnReader::SkipPast(char end) {
+  size_t found = text.find(end, position);
+  position = found == std::string_view::npos ? text.size() : found + 1;
+}
+
+// Variations nest, and may hold comments with brackets of their own
+void PgnReader::SkipVariation() {
+  int depth = 0;
+  while (position < text.size()) {
+    char c = text[position++];
+    if (c == '(') {
+      depth++;
+    } else if (c == ')') {
+      if (--depth == 0) {
+        return;
+      }
+    } else if (c == '{') {
+      SkipPast('}');
+    } else if (c == ';') {
+      SkipPast('\n');
+    }
+  }
+}
+
+std::string_view PgnReader::ReadToken() {
+  size_t start = position;
+  while (position < text.size() && !EndsToken(text[position])) {
+    position++;
+  }
+  return text.substr(start, position - start);
+}
+
+bool PgnReader::NextGame(PgnGame &game) {
+  game.tags.clear();
+  game.moves.clear();
+  game.result = {};
+
+  // Tag pairs: [Name "Value"]
+  SkipWhitespace();
+  while (position < text.size() && text[position] == '[') {
+    size_t end = text.find(']', position);
+    std::string_view tag = text.substr(position + 1, (end == std::string_view::npos ? text.size() : end) - position - 1);
+    position = end == std::string_view::npos ? text.size() : end + 1;
+
+    size_t nameEnd = tag.find_first_of(" \t");
+    size_t valueStart = tag.find('"');
+    size_t valueEnd = tag.rfind('"');
+    if (nameEnd != std::string_view::npos && valueStart != std::string_view::npos && valueEnd > valueStart) {
+      game.tags.push_back({tag.substr(0, nameEnd), tag.substr(valueStart + 1, valueEnd - valueStart - 1)});
+    }
+    SkipWhitespace();
+  }
+
+  // Movetext, up to the result or the next game's tags
+  while (position < text.size()) {
+    char c = text[position];
+    if (IsSpace(c)) {
+      position++;
+    } else if (c == '{') {
+      SkipPast('}');
+    } else if (c == ';') {
+      SkipPast('\n');
+    } else if (c == '%' && (position == 0 || text[position - 1] == '\n')) {
+      SkipPast('\n');
+    } else if (c == '(') {
+      SkipVariation();
+    } else if (c == '$') {
+      position++;
+      ReadToken();
+    } else if (c == '[') {
+      break;
+    } else if (c == ')' || c == '}' || c == ']') {
+      position++;
+    } else {
+      std::string_view token = ReadToken();
+      if (IsResult(token)) {
+        game.result = token;
+        break;
+      }
+
+      // Move numbers: "12." or "12..." before the move, sometimes without a
+      // space. Only the dots mark them, as "0-0" castles.
+      size_t lastDot = token.find_last_of('.');
+      if (lastDot != std::string_view::npos) {
+        token.remove_prefix(lastDot + 1);
+      } else if (token.find_first_not_of("0123456789") == std::string_view::npos) {
+        continue;
+      }
+      while (!token.empty() && (token.back() == '!' || token.back() == '?')) {
+        token.remove_suffix(1);
+      }
+      if (!token.empty()) {
+        game.moves.push_back(token);
+      }
+    }
+  }
+
+  return !game.tags.empty() || !game.moves.empty() || !game.result.empty();
+}
+
+void PgnWriter::BeginGame() {
+  moveNumber = 1;
+  firstMove = true;
+  lineStart = buffer.size();
+}
+
+void PgnWriter::AddTag(std::string_view name, std::string_view value) {
+  buffer += '[';
+  buffer += name;
+  buffer += " \"";
+  buffer += value;
+  buffer += "\"]\n";
+}
+
+void PgnWriter::AddWord(std::string_view word) {
+  // Lines stay under 80 characters
+  if (buffer.size() > lineStart && buffer.size() - lineStart + 1 + word.size() >= 80) {
+    buffer += '\n';
+    lineStart = buffer.size();
+  } else if (buffer.size() > lineStart) {
+    buffer += ' ';
+  }
+  buffer += word;
+}
+
+void PgnWriter::AddMove(Board &board, int color, Move move) {
+  char text[16 + MAX_SAN_LENGTH];
+  char *end = text;
+
+  if (firstMove) {
+    // The movetext is set off from the tags by an empty line
+    buffer += '\n';
+    lineStart = buffer.size();
+  }
+
+  if (color == WHITE || firstMove) {
+    end = std::to_chars(end, text + 16, moveNumber).ptr;
+    *end++ = '.';
+    if (color == BLACK) {
+      *end++ = '.';
+      *end++ = '.';
+    }
+    AddWord(std::string_view(text, end - text));
+    end = text;
+  }
+  firstMove = false;
+
+  end = WriteSAN(board, color, move, end);
+  AddWord(std::string_view(text, end - text));
+
+  if (color == BLACK) {
+    moveNumber++;
+  }
+}
+
+void PgnWriter::EndGame(std::string_view result) {
+  if (firstMove) {
+    buffer += '\n';
+    lineStart = buffer.size();
+  }
+  AddWord(result);
+  buffer += "\n\n";
+  lineStart = buffer.size();
+}
+
+bool PgnWriter::Flush(FILE *file) {
+  bool written = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+  buffer.clear();
+  lineStart = 0;
+  return written;
+}
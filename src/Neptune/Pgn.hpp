@@ -0,0 +1,101 @@
+#ifndef NP_PGN_HPP
+#define NP_PGN_HPP
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Board.hpp"
+
+// Longest SAN there is, e.g. Qa1xb2+ or exd8=Q#, plus room to spare
+#define MAX_SAN_LENGTH 10
+
+// Finds the legal move the SAN stands for. Check and annotation marks are
+// ignored, castling may use zeros. False if no move or more than one fits.
+bool ParseSAN(Board &board, int color, std::string_view san, Move &move);
+
+// Writes the SAN of a legal move into buffer (room for MAX_SAN_LENGTH chars),
+// returns the end of what was written
+char *WriteSAN(Board &board, int color, Move move, char *buffer);
+
+struct PgnTag {
+  std::string_view name;
+  std::string_view value;  // without the quotes, escapes left in
+};
+
+// A game as read from PGN. Everything points into the reader's text, so it
+// is only valid until the reader moves on or closes.
+struct PgnGame {
+  std::vector<PgnTag> tags;
+  std::vector<std::string_view> moves;  // SAN, comments, variations and NAGs left out
+  std::string_view result;
+
+  std::string_view Tag(std::string_view name) const;
+};
+
+// Sets up the position a game starts from: its FEN tag, or the standard one
+bool SetupGame(const PgnGame &game, Board &board, int &color);
+
+// Reads games one after the other from a memory mapped file, or from text kept
+// alive by the caller. Nothing is copied and the game's vectors are reused, so
+// after the first few games reading doesn't allocate.
+class PgnReader {
+public:
+  PgnReader() = default;
+  explicit PgnReader(std::string_view text) : text(text) {}
+  ~PgnReader();
+
+  PgnReader(const PgnReader &) = delete;
+  PgnReader &operator=(const PgnReader &) = delete;
+
+  bool Open(const std::string &path);
+  void Close();
+
+  // False once there are no games left
+  bool NextGame(PgnGame &game);
+
+private:
+  void SkipWhitespace();
+  void SkipPast(char end);
+  void SkipVariation();
+  std::string_view ReadToken();
+
+private:
+  std::string_view text;
+  size_t position = 0;
+
+  void *mapping = nullptr;
+  size_t mappingSize = 0;
+#ifdef _WIN32
+  std::string storage;
+#endif
+};
+
+// Formats games into one buffer that is kept between games, so writing a
+// move costs no allocation once the buffer has grown. Flush hands the text
+// to a file in large blocks.
+class PgnWriter {
+public:
+  void BeginGame();
+  void AddTag(std::string_view name, std::string_view value);
+  // Before the move is made on the board
+  void AddMove(Board &board, int color, Move move);
+  void EndGame(std::string_view result);
+
+  const std::string &Buffer() const {
+    return buffer;
+  }
+  bool Flush(FILE *file);
+
+private:
+  void AddWord(std::string_view word);
+
+private:
+  std::string buffer;
+  size_t lineStart = 0;
+  int moveNumber = 1;
+  bool firstMove = true;
+};
+
+#endif // NP_PGN_HPP
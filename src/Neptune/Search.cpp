@@ -0,0 +1,613 @@
+#include "Search.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include "Syzygy.hpp"
+
+// Margins are in EvaluateBoard units, where a pawn is worth 10 plus its square bonus
+#define REVERSE_FUTILITY_MARGIN 30
+#define REVERSE_FUTILITY_DEPTH 6
+#define FUTILITY_MARGIN 40
+#define FUTILITY_DEPTH 3
+#define LATE_MOVE_PRUNING_DEPTH 3
+#define NULL_MOVE_DEPTH 3
+#define LMR_DEPTH 3
+#define LMR_MOVES 3
+
+// Late move reductions by depth and move number, log(depth) * log(moveNumber) shaped
+int reductions[MAX_PLY][MAX_MOVES];
+
+// Victim values for MVV-LVA ordering
+const int orderValues[6] = {1, 3, 3, 5, 9, 100};
+
+static void InitReductions() {
+  for (int depth = 1; depth < MAX_PLY; ++depth) {
+    for (int moveNumber = 1; moveNumber < MAX_MOVES; ++moveNumber) {
+      reductions[depth][moveNumber] = static_cast<int>(0.75 + std::log(depth) * std::log(moveNumber) / 2.25);
+    }
+  }
+}
+
+// Mate and tablebase scores count from the root, the table keeps them from the position
+static int ScoreToTable(int score, int ply) {
+  return score >= TB_WIN_SCORE - MAX_PLY ? score + ply : score <= -TB_WIN_SCORE + MAX_PLY ? score - ply : score;
+}
+
+static int ScoreFromTable(int score, int ply) {
+  return score >= TB_WIN_SCORE - MAX_PLY ? score - ply : score <= -TB_WIN_SCORE + MAX_PLY ? score + ply : score;
+}
+
+static int Evaluate(Board &board, int color) {
+  int score = board.EvaluateBoard();
+  return color == WHITE ? score : -score;
+}
+
+inline int Searcher::TraceExit(TraceKind kind, int ply, int score) {
+  if (NP_TRACE && trace) {
+    trace->Record(kind, ply, 0, Move(), 0, 0, score);
+  }
+  return score;
+}
+
+bool SearchOptions::Set(const std::string &name, bool enabled) {
+  if (name == "NullMove") {
+    nullMove = enabled;
+  } else if (name == "LMR") {
+    lateMoveReductions = enabled;
+  } else if (name == "ReverseFutility") {
+    reverseFutility = enabled;
+  } else if (name == "Futility") {
+    futility = enabled;
+  } else if (name == "LateMovePruning") {
+    lateMovePruning = enabled;
+  } else if (name == "CheckExtensions") {
+    checkExtensions = enabled;
+  } else if (name == "QuiescenceChecks") {
+    quiescenceChecks = enabled;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void WriteScore(std::ostream &output, int score) {
+  if (std::abs(score) >= MATE_BOUND) {
+    int movesToMate = (MATE_SCORE - std::abs(score) + 1) / 2;
+    output << "mate " << (score > 0 ? movesToMate : -movesToMate);
+  } else {
+    output << "cp " << score;
+  }
+}
+
+int64_t TimeForMove(int64_t timeLeft, int64_t increment, int movesToGo) {
+  // Keep a little back for the overhead of getting the move out
+  return std::max<int64_t>(1, timeLeft / std::max(movesToGo, 1) + increment / 2 - 10);
+}
+
+Searcher::Searcher() : stack(new SearchFrame[MAX_PLY]) {
+  // Function-local statics are initialized once, even with several threads
+  static const bool reductionsReady = (InitReductions(), true);
+  (void)reductionsReady;
+}
+
+SearchResult Searcher::Search(Board board, int color, const SearchLimits &searchLimits, const PositionHistory &gameHistory) {
+  limits = searchLimits;
+  history = gameHistory;
+  startTime = std::chrono::steady_clock::now();
+  nodes = 0;
+  stopped = false;
+  table.NewSearch();
+
+  for (int ply = 0; ply < MAX_PLY; ++ply) {
+    stack[ply].killers[0] = stack[ply].killers[1] = Move();
+  }
+
+  SearchResult result;
+
+  MoveList &rootMoves = stack[0].moves;
+  board.GenerateLegalMoves(color, rootMoves);
+
+  // go searchmoves: only the listed moves, as long as one of them is legal
+  if (!limits.searchMoves.IsEmpty()) {
+    int kept = 0;
+    for (Move move : rootMoves) {
+      for (Move listed : limits.searchMoves) {
+        if (move == listed) {
+          rootMoves[kept++] = move;
+          break;
+        }
+      }
+    }
+    if (kept) {
+      rootMoves.Resize(kept);
+    } else {
+      board.GenerateLegalMoves(color, rootMoves);
+    }
+  }
+
+  if (rootMoves.IsEmpty()) {
+    result.score = board.IsInCheck(color) ? -MATE_SCORE : 0;
+    return result;
+  }
+
+  // In a tablebase position only the moves keeping the best result are searched
+  Syzygy::RootProbe(board, color, rootMoves);
+  OrderMoves(board, rootMoves, Move(), 0);
+  result.bestMove = rootMoves[0];
+  int lineCount = std::clamp(limits.multiPV, 1, std::min(rootMoves.Size(), MAX_MULTIPV));
+
+  for (int depth = 1; depth <= limits.depth && depth < MAX_PLY; ++depth) {
+    SearchLine lines[MAX_MULTIPV];
+    int linesDone = 0;
+
+    // Each line is the best of the moves the lines before it didn't take. Those
+    // are kept at the front of the list, so line n searches from index n on.
+    history.Push(board.GetKey());
+    for (int line = 0; line < lineCount; ++line) {
+      int alpha = -INFINITE_SCORE;
+      int beta = INFINITE_SCORE;
+      int bestScore = -INFINITE_SCORE;
+      int bestIndex = line;
+      if (NP_TRACE && trace) {
+        trace->Record(TRACE_ITERATION, 0, depth, Move(), alpha, beta, 0);
+      }
+
+      for (int i = line; i < rootMoves.Size(); ++i) {
+        stack[0].currentMove = rootMoves[i];
+        Board child = board;
+        child.MakeMove(rootMoves[i], color);
+        table.Prefetch(child.GetKey());
+
+        int score;
+        if (i == line) {
+          score = -AlphaBeta(child, !color, depth - 1, 1, -beta, -alpha, true);
+        } else {
+          score = -AlphaBeta(child, !color, depth - 1, 1, -alpha - 1, -alpha, true);
+          if (score > alpha && !stopped) {
+            score = -AlphaBeta(child, !color, depth - 1, 1, -beta, -alpha, true);
+          }
+        }
+
+        if (stopped) {
+          break;
+        }
+
+        if (score > bestScore) {
+          bestScore = score;
+          bestIndex = i;
+          alpha = std::max(alpha, score);
+
+          stack[0].pv[0] = rootMoves[i];
+          for (int next = 1; next < stack[1].pvLength; ++next) {
+            stack[0].pv[next] = stack[1].pv[next];
+          }
+          stack[0].pvLength = std::max(stack[1].pvLength, 1);
+        }
+      }
+
+      TraceExit(stopped ? TRACE_STOPPED : TRACE_EXACT, 0, bestScore);
+
+      // An unfinished line is only trusted for its completed first move
+      if (stopped && bestScore == -INFINITE_SCORE) {
+        break;
+      }
+
+      // Search the best moves first in the next iteration
+      std::swap(rootMoves[line], rootMoves[bestIndex]);
+      lines[linesDone++] = {rootMoves[line], bestScore};
+
+      if (verbose) {
+        PrintLine(depth, line + 1, bestScore);
+      }
+      if (progress) {
+        ReportLine(depth, line + 1, bestScore);
+      }
+      if (stopped) {
+        break;
+      }
+    }
+    history.Pop();
+
+    if (!linesDone) {
+      break;
+    }
+
+    // After a stop the lines not reached this iteration come from the one before
+    for (int i = 0; i < result.lineCount && linesDone < lineCount; ++i) {
+      bool found = false;
+      for (int j = 0; j < linesDone; ++j) {
+        found |= lines[j].move == result.lines[i].move;
+      }
+      if (!found) {
+        lines[linesDone++] = result.lines[i];
+      }
+    }
+
+    std::copy(lines, lines + linesDone, result.lines);
+    result.lineCount = linesDone;
+    result.bestMove = lines[0].move;
+    result.score = lines[0].score;
+    result.depth = depth;
+
+    if (stopped) {
+      break;
+    }
+  }
+
+  result.nodes = nodes;
+  return result;
+}
+
+void Searcher::PrintLine(int depth, int lineNumber, int score) {
+  int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+  std::cout << "info depth " << depth << " multipv " << lineNumber << " score ";
+  WriteScore(std::cout, score);
+  std::cout << " nodes " << nodes << " nps " << (nodes * 1000 / (elapsed + 1)) << " hashfull " << table.Hashfull()
+            << " time " << elapsed << " pv";
+  for (int i = 0; i < stack[0].pvLength; ++i) {
+    std::cout << " " << stack[0].pv[i].ToAlgebraicNotation();
+  }
+  std::cout << std::endl;
+}
+
+void Searcher::ReportLine(int depth, int lineNumber, int score) {
+  SearchProgress report;
+  report.depth = depth;
+  report.lineNumber = lineNumber;
+  report.score = score;
+  report.nodes = nodes;
+  report.time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+  report.hashfull = table.Hashfull();
+  std::copy(stack[0].pv, stack[0].pv + stack[0].pvLength, report.pv);
+  report.pvLength = stack[0].pvLength;
+  progress(report);
+}
+
+int Searcher::AlphaBeta(Board &board, int color, int depth, int ply, int alpha, int beta, bool allowNull) {
+  stack[ply].pvLength = ply;
+
+  if (depth <= 0) {
+    return Quiescence(board, color, ply, alpha, beta, true);
+  }
+
+  if (ShouldStop()) {
+    return 0;
+  }
+  nodes++;
+  if (NP_TRACE && trace) {
+    trace->Record(TRACE_NODE, ply, depth, stack[ply - 1].currentMove, alpha, beta, 0);
+  }
+
+  // Draw by the 50-move rule or by repeating a position
+  if (board.GetHalfmoveClock() >= 100
+      || history.IsRepetition(board.GetKey(), std::min(board.GetHalfmoveClock(), board.GetPliesFromNull()))) {
+    return TraceExit(TRACE_DRAW, ply, 0);
+  }
+
+  if (ply >= MAX_PLY - 1) {
+    return TraceExit(TRACE_MAX_PLY, ply, Evaluate(board, color));
+  }
+
+  bool pvNode = beta - alpha > 1;
+
+  // A deep enough result from earlier settles the position, outside the principal variation
+  TableEntry entry;
+  Move tableMove;
+  if (table.Probe(board.GetKey(), entry)) {
+    tableMove = entry.move;
+    int tableScore = ScoreFromTable(entry.score, ply);
+    if (!pvNode && entry.depth >= depth
+        && (entry.bound == BOUND_EXACT || (entry.bound == BOUND_LOWER && tableScore >= beta)
+            || (entry.bound == BOUND_UPPER && tableScore <= alpha))) {
+      return TraceExit(TRACE_TABLE_CUTOFF, ply, tableScore);
+    }
+  }
+
+  SearchFrame &frame = stack[ply];
+  bool inCheck = board.IsInCheck(color);
+
+  // Within the tablebases the exact result is known
+  if (board.CountPieces() <= Syzygy::MaxCardinality() && !board.HasCastlingRights()) {
+    Syzygy::ProbeState result;
+    Syzygy::WDLScore wdl = Syzygy::ProbeWDL(board, color, &result);
+    if (result != Syzygy::PROBE_FAIL) {
+      int score = Syzygy::ScoreFromWDL(wdl);
+      // Prefer the quickest win and the slowest loss
+      score = score == TB_WIN_SCORE ? score - ply : score == -TB_WIN_SCORE ? score + ply : score;
+      return TraceExit(TRACE_TABLEBASE, ply, score);
+    }
+  }
+
+  int staticEval = inCheck ? -INFINITE_SCORE : Evaluate(board, color);
+  frame.staticEval = staticEval;
+
+  // Reverse futility pruning: far enough above beta, a shallow search will not fall below it
+  if (NP_REVERSE_FUTILITY && options.reverseFutility && !pvNode && !inCheck
+      && depth <= REVERSE_FUTILITY_DEPTH && std::abs(beta) < MATE_BOUND
+      && staticEval - REVERSE_FUTILITY_MARGIN * depth >= beta) {
+    return TraceExit(TRACE_REVERSE_FUTILITY, ply, staticEval);
+  }
+
+  // Null move pruning: if passing still fails high, a real move will too. Skipped
+  // with only pawns left, where zugzwang makes passing the best "move".
+  if (NP_NULL_MOVE && options.nullMove && allowNull && !pvNode && !inCheck
+      && depth >= NULL_MOVE_DEPTH && staticEval >= beta && board.HasNonPawnMaterial(color)) {
+    int reduction = 3 + depth / 6;
+
+    frame.currentMove = Move();
+    Board child = board;
+    child.MakeNullMove();
+    table.Prefetch(child.GetKey());
+    history.Push(board.GetKey());
+    int score = -AlphaBeta(child, !color, depth - 1 - reduction, ply + 1, -beta, -beta + 1, false);
+    history.Pop();
+
+    if (stopped) {
+      return TraceExit(TRACE_STOPPED, ply, 0);
+    }
+    if (score >= beta) {
+      // Don't trust mate scores found by passing
+      return TraceExit(TRACE_NULL_MOVE_CUTOFF, ply, score >= MATE_BOUND ? beta : score);
+    }
+  }
+
+  // The attacks are only worked out once the node gets as far as searching moves
+  board.ComputeAttackInfo(color, frame.attacks);
+
+  // The table move may come from another position with the same slot, so it
+  // is checked first. It is then searched before any moves are generated.
+  MoveList &moves = frame.moves;
+  moves.Clear();
+  if (board.IsPseudoLegal(tableMove, color) && board.IsLegal(tableMove, color, frame.attacks)) {
+    moves.Add(tableMove);
+  }
+  bool generated = false;
+
+  // Futility pruning: quiet moves can't bring a hopeless position back above alpha
+  bool futile = NP_FUTILITY && options.futility && !pvNode && !inCheck
+      && depth <= FUTILITY_DEPTH && std::abs(alpha) < MATE_BOUND
+      && staticEval + FUTILITY_MARGIN * depth <= alpha;
+
+  int bestScore = -INFINITE_SCORE;
+  Move bestMove;
+  int originalAlpha = alpha;
+  int moveCount = 0;
+
+  history.Push(board.GetKey());
+  for (int index = 0;; ++index) {
+    if (index == moves.Size()) {
+      // No cutoff from the table move: generate the rest. Ordering puts the
+      // table move back in front, where it has been searched already.
+      if (generated) {
+        break;
+      }
+      generated = true;
+      board.GenerateLegalMoves(color, moves, frame.attacks);
+      if (moves.IsEmpty()) {
+        history.Pop();
+        return TraceExit(TRACE_NO_MOVES, ply, inCheck ? -MATE_SCORE + ply : 0);
+      }
+      OrderMoves(board, moves, tableMove, ply);
+      if (index == moves.Size()) {
+        break;
+      }
+    }
+    Move move = moves[index];
+
+    bool quiet = !board.IsCapture(move) && move.promotionPiece == EMPTY;
+    bool givesCheck = board.GivesCheck(move, color, frame.attacks);
+    moveCount++;
+
+    // The first move is always searched, so there is a score to fall back on
+    if (quiet && !givesCheck && bestScore > -MATE_BOUND) {
+      if (futile) {
+        continue;
+      }
+
+      // Late move pruning: with good ordering, late quiet moves at low depth rarely matter
+      if (NP_LATE_MOVE_PRUNING && options.lateMovePruning && !pvNode && !inCheck
+          && depth <= LATE_MOVE_PRUNING_DEPTH && moveCount > 3 + depth * depth) {
+        continue;
+      }
+    }
+
+    frame.currentMove = move;
+    Board child = board;
+    child.MakeMove(move, color);
+    table.Prefetch(child.GetKey());
+
+    int extension = (NP_CHECK_EXTENSIONS && options.checkExtensions && givesCheck) ? 1 : 0;
+    int newDepth = depth - 1 + extension;
+
+    int score;
+    if (moveCount == 1) {
+      score = -AlphaBeta(child, !color, newDepth, ply + 1, -beta, -alpha, true);
+    } else {
+      // Late move reductions: search late quiet moves shallower, re-search if they surprise
+      int reduction = 0;
+      if (NP_LMR && options.lateMoveReductions && depth >= LMR_DEPTH && moveCount > LMR_MOVES
+          && quiet && !inCheck && !givesCheck) {
+        reduction = reductions[std::min(depth, MAX_PLY - 1)][std::min(moveCount, MAX_MOVES - 1)];
+        if (pvNode) {
+          reduction--;
+        }
+        reduction = std::clamp(reduction, 0, std::max(newDepth - 1, 0));
+      }
+
+      score = -AlphaBeta(child, !color, newDepth - reduction, ply + 1, -alpha - 1, -alpha, true);
+      if (score > alpha && reduction > 0 && !stopped) {
+        score = -AlphaBeta(child, !color, newDepth, ply + 1, -alpha - 1, -alpha, true);
+      }
+      if (score > alpha && score < beta && !stopped) {
+        score = -AlphaBeta(child, !color, newDepth, ply + 1, -beta, -alpha, true);
+      }
+    }
+
+    if (stopped) {
+      history.Pop();
+      return TraceExit(TRACE_STOPPED, ply, 0);
+    }
+
+    if (score > bestScore) {
+      bestScore = score;
+
+      if (score > alpha) {
+        alpha = score;
+        bestMove = move;
+
+        stack[ply].pv[ply] = move;
+        for (int next = ply + 1; next < stack[ply + 1].pvLength; ++next) {
+          stack[ply].pv[next] = stack[ply + 1].pv[next];
+        }
+        stack[ply].pvLength = std::max(stack[ply + 1].pvLength, ply + 1);
+
+        if (alpha >= beta) {
+          // Killer moves: quiet moves that refute a position tend to refute its siblings too
+          if (quiet && !(move == frame.killers[0])) {
+            frame.killers[1] = frame.killers[0];
+            frame.killers[0] = move;
+          }
+          break;
+        }
+      }
+    }
+  }
+  history.Pop();
+
+  Bound bound = bestScore >= beta ? BOUND_LOWER : bestScore > originalAlpha ? BOUND_EXACT : BOUND_UPPER;
+  table.Store(board.GetKey(), bestMove, ScoreToTable(bestScore, ply), depth, bound);
+
+  return TraceExit(bound == BOUND_LOWER ? TRACE_FAIL_HIGH : bound == BOUND_EXACT ? TRACE_EXACT : TRACE_FAIL_LOW, ply, bestScore);
+}
+
+int Searcher::Quiescence(Board &board, int color, int ply, int alpha, int beta, bool checks) {
+  stack[ply].pvLength = ply;
+
+  if (ShouldStop()) {
+    return 0;
+  }
+  nodes++;
+  if (NP_TRACE && trace) {
+    trace->Record(TRACE_QUIESCENCE, ply, 0, stack[ply - 1].currentMove, alpha, beta, 0);
+  }
+  int originalAlpha = alpha;
+
+  SearchFrame &frame = stack[ply];
+  bool quietChecks = NP_QUIESCENCE_CHECKS && options.quiescenceChecks;
+  checks = checks && quietChecks;
+
+  // Once quiet checks are tried, a position in check can't stand pat: every evasion is searched
+  bool evading = false;
+  if (quietChecks) {
+    board.ComputeAttackInfo(color, frame.attacks);
+    evading = frame.attacks.checkers.IsNotEmpty();
+  }
+
+  if (!evading) {
+    int standPat = Evaluate(board, color);
+    if (ply >= MAX_PLY - 1 || standPat >= beta) {
+      return TraceExit(standPat >= beta ? TRACE_STAND_PAT : TRACE_MAX_PLY, ply, standPat);
+    }
+    alpha = std::max(alpha, standPat);
+    if (!quietChecks) {
+      board.ComputeAttackInfo(color, frame.attacks);
+    }
+  } else if (ply >= MAX_PLY - 1) {
+    return TraceExit(TRACE_MAX_PLY, ply, Evaluate(board, color));
+  }
+
+  MoveList &moves = frame.moves;
+  board.GenerateLegalMoves(color, moves, frame.attacks);
+  if (evading && moves.IsEmpty()) {
+    return TraceExit(TRACE_NO_MOVES, ply, -MATE_SCORE + ply);
+  }
+  OrderMoves(board, moves, Move(), ply);
+
+  for (Move move : moves) {
+    if (!evading && !board.IsCapture(move) && move.promotionPiece == EMPTY
+        && !(checks && board.GivesCheck(move, color, frame.attacks))) {
+      continue;
+    }
+
+    frame.currentMove = move;
+    Board child = board;
+    child.MakeMove(move, color);
+    int score = -Quiescence(child, !color, ply + 1, -beta, -alpha, false);
+
+    if (stopped) {
+      return TraceExit(TRACE_STOPPED, ply, 0);
+    }
+
+    if (score > alpha) {
+      alpha = score;
+      if (alpha >= beta) {
+        break;
+      }
+    }
+  }
+
+  return TraceExit(alpha >= beta ? TRACE_FAIL_HIGH : alpha > originalAlpha ? TRACE_EXACT : TRACE_FAIL_LOW, ply, alpha);
+}
+
+// Orders first, then promotions and captures (most valuable victim, least valuable attacker), then killers,
+// then the other quiet moves
+void Searcher::OrderMoves(Board &board, MoveList &moves, Move first, int ply) {
+  const Move *killers = stack[ply].killers;
+  int scores[MAX_MOVES];
+
+  for (int i = 0; i < moves.Size(); ++i) {
+    Move move = moves[i];
+    int score = 0;
+    if (move == first) {
+      score = 100000;
+    } else if (board.IsCapture(move)) {
+      ColoredPiece victim = board.GetPieceAt(move.toSquare);
+      int victimValue = orderValues[victim.pieceType == EMPTY ? PAWN : victim.pieceType];
+      score = 1000 + victimValue * 10 - orderValues[board.GetPieceAt(move.fromSquare).pieceType];
+    } else if (move == killers[0]) {
+      score = 900;
+    } else if (move == killers[1]) {
+      score = 800;
+    }
+    if (move.promotionPiece != EMPTY) {
+      score += 500 + orderValues[move.promotionPiece];
+    }
+    scores[i] = score;
+  }
+
+  // Insertion sort, move lists are short
+  for (int i = 1; i < moves.Size(); ++i) {
+    Move move = moves[i];
+    int score = scores[i];
+    int j = i - 1;
+    while (j >= 0 && scores[j] < score) {
+      moves[j + 1] = moves[j];
+      scores[j + 1] = scores[j];
+      --j;
+    }
+    moves[j + 1] = move;
+    scores[j + 1] = score;
+  }
+}
+
+bool Searcher::ShouldStop() {
+  if (stopped) {
+    return true;
+  }
+
+  if (limits.nodes && nodes >= limits.nodes) {
+    stopped = true;
+  } else if ((nodes & 1023) == 0) {
+    if (limits.stop.stop_requested()) {
+      stopped = true;
+    } else if (limits.moveTime) {
+      int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+      stopped = elapsed >= limits.moveTime;
+    }
+  }
+
+  return stopped;
+}
@@ -0,0 +1,163 @@
+#ifndef NP_SEARCH_HPP
+#define NP_SEARCH_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <stop_token>
+#include <string>
+
+#include "Board.hpp"
+#include "History.hpp"
+#include "Trace.hpp"
+#include "TranspositionTable.hpp"
+
+#define MAX_PLY 64
+#define INFINITE_SCORE 10000
+#define MATE_SCORE 9000
+// Scores beyond this are mates, reported in moves
+#define MATE_BOUND (MATE_SCORE - MAX_PLY)
+// Most lines a single search reports
+#define MAX_MULTIPV 16
+
+// Compile-time switches for the selective search. Building with one set to 0
+// removes the technique entirely, otherwise it can still be turned off with
+// the matching UCI option.
+#ifndef NP_NULL_MOVE
+#define NP_NULL_MOVE 1
+#endif
+#ifndef NP_LMR
+#define NP_LMR 1
+#endif
+#ifndef NP_REVERSE_FUTILITY
+#define NP_REVERSE_FUTILITY 1
+#endif
+#ifndef NP_FUTILITY
+#define NP_FUTILITY 1
+#endif
+#ifndef NP_LATE_MOVE_PRUNING
+#define NP_LATE_MOVE_PRUNING 1
+#endif
+#ifndef NP_CHECK_EXTENSIONS
+#define NP_CHECK_EXTENSIONS 1
+#endif
+#ifndef NP_QUIESCENCE_CHECKS
+#define NP_QUIESCENCE_CHECKS 1
+#endif
+
+struct SearchOptions {
+  bool nullMove = NP_NULL_MOVE;
+  bool lateMoveReductions = NP_LMR;
+  bool reverseFutility = NP_REVERSE_FUTILITY;
+  bool futility = NP_FUTILITY;
+  bool lateMovePruning = NP_LATE_MOVE_PRUNING;
+  bool checkExtensions = NP_CHECK_EXTENSIONS;
+  // Off by default, it lost Elo in fixed-node self-play
+  bool quiescenceChecks = false;
+
+  // Sets the technique with this UCI option name, false if there is none
+  bool Set(const std::string &name, bool enabled);
+};
+
+struct SearchLimits {
+  int depth = MAX_PLY - 1;
+  uint64_t nodes = 0;  // 0 means no limit
+  int64_t moveTime = 0; // milliseconds, 0 means no limit
+  int multiPV = 1;      // best lines to find, each excluding the moves of the ones before
+  MoveList searchMoves; // root moves to consider, all when empty
+  std::stop_token stop; // ends the search like running out of time once stop is requested
+};
+
+struct SearchLine {
+  Move move;
+  int score;
+};
+
+struct SearchResult {
+  Move bestMove;
+  int score = 0;
+  int depth = 0;
+  uint64_t nodes = 0;
+  // Best first; the first line is bestMove and score
+  SearchLine lines[MAX_MULTIPV];
+  int lineCount = 0;
+};
+
+// A line finished by a running search, what UCI prints as an info line
+struct SearchProgress {
+  int depth;
+  int lineNumber;  // from 1, as multipv
+  int score;
+  uint64_t nodes;
+  int64_t time;  // milliseconds since the search started
+  int hashfull;
+  Move pv[MAX_PLY];
+  int pvLength;
+};
+
+// UCI score: cp <centipawns> or mate <moves>
+void WriteScore(std::ostream &output, int score);
+
+// Milliseconds to spend on a move, from the clock and the moves left until the next time control
+int64_t TimeForMove(int64_t timeLeft, int64_t increment, int movesToGo);
+
+// Everything the search keeps for one ply. Frames are allocated once with the
+// Searcher, so searching itself never touches the heap, and are cache line
+// aligned so neighbouring plies don't share lines.
+struct alignas(64) SearchFrame {
+  MoveList moves;
+  AttackInfo attacks;  // of the position at this ply, for the side to move
+  Move killers[2];  // quiet moves that caused a beta cutoff at this ply
+  Move currentMove;
+  int staticEval;
+  // Principal variation from this ply, in pv[ply] up to pv[pvLength - 1]
+  Move pv[MAX_PLY];
+  int pvLength;
+};
+
+// Iterative deepening alpha-beta search (negamax, scores from the side to move).
+// A Searcher keeps all its state to itself, so several can run at once.
+class Searcher {
+public:
+  Searcher();
+
+  // gameHistory holds the positions before this one, for repetition detection
+  SearchResult Search(Board board, int color, const SearchLimits &limits, const PositionHistory &gameHistory = PositionHistory());
+
+  // Prints "info" lines after every iteration
+  bool verbose = true;
+  // Called with every line finished, on the searching thread, so it should return quickly
+  std::function<void(const SearchProgress &progress)> progress;
+  SearchOptions options;
+  TranspositionTable table;
+  // Where the nodes are recorded, nullptr for no tracing. Needs NP_TRACE.
+  TraceBuffer *trace = nullptr;
+
+private:
+  int AlphaBeta(Board &board, int color, int depth, int ply, int alpha, int beta, bool allowNull);
+  // checks: also try quiet checking moves, done on the first ply only
+  int Quiescence(Board &board, int color, int ply, int alpha, int beta, bool checks);
+
+  // Records how the node at ply ended when tracing, returns score
+  int TraceExit(TraceKind kind, int ply, int score);
+
+  void OrderMoves(Board &board, MoveList &moves, Move first, int ply);
+  void PrintLine(int depth, int lineNumber, int score);
+  void ReportLine(int depth, int lineNumber, int score);
+  bool ShouldStop();
+
+private:
+  SearchLimits limits;
+  std::chrono::steady_clock::time_point startTime;
+  uint64_t nodes;
+  bool stopped;
+
+  PositionHistory history;
+
+  // One frame per ply, indexed by ply
+  std::unique_ptr<SearchFrame[]> stack;
+};
+
+#endif // NP_SEARCH_HPP
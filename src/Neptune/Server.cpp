@@ -0,0 +1,454 @@
+#include "Server.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <sstream>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Where sends have no such flag, SIGPIPE is left to the application
+#if !defined(_WIN32) && !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+struct AnalysisPool::Session {
+  int id;
+  SessionLimits limits;
+  ReplyFunction reply;
+  std::deque<AnalysisRequest> queue;
+  // Searched so far, plus what the running requests may still search
+  uint64_t nodesUsed = 0;
+  int running = 0;
+};
+
+// The tighter of two limits where 0 means none
+template <typename T>
+static T Tighter(T a, T b) {
+  return !a ? b : !b ? a : std::min(a, b);
+}
+
+static std::string FormatResult(const std::string &id, const SearchResult &result, int multiPV) {
+  std::ostringstream output;
+  output << "result " << id << " bestmove "
+         << (result.bestMove.fromSquare == result.bestMove.toSquare ? "0000" : result.bestMove.ToAlgebraicNotation());
+  output << " score ";
+  WriteScore(output, result.score);
+  output << " depth " << result.depth << " nodes " << result.nodes;
+  if (multiPV > 1) {
+    for (int line = 0; line < result.lineCount; ++line) {
+      output << " multipv " << line + 1 << " " << result.lines[line].move.ToAlgebraicNotation() << " ";
+      WriteScore(output, result.lines[line].score);
+    }
+  }
+  return output.str();
+}
+
+AnalysisPool::AnalysisPool(int threadCount, size_t hashMegabytes, const SearchOptions &options)
+    : options(options) {
+  threadCount = std::max(threadCount, 1);
+  tableMegabytes = std::max<size_t>(hashMegabytes / threadCount, 1);
+
+  Board board;
+  board.InitMoves();
+
+  for (int i = 0; i < threadCount; ++i) {
+    threads.emplace_back(&AnalysisPool::Worker, this);
+  }
+}
+
+AnalysisPool::~AnalysisPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  workReady.notify_all();
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+int AnalysisPool::OpenSession(const SessionLimits &limits, ReplyFunction reply) {
+  auto session = std::make_shared<Session>();
+  session->limits = limits;
+  session->reply = std::move(reply);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  session->id = nextSessionId++;
+  sessions.push_back(session);
+  return session->id;
+}
+
+void AnalysisPool::CloseSession(int id) {
+  std::unique_lock<std::mutex> lock(mutex);
+  auto found = std::find_if(sessions.begin(), sessions.end(), [id](const auto &session) { return session->id == id; });
+  if (found == sessions.end()) {
+    return;
+  }
+  std::shared_ptr<Session> session = *found;
+  queued -= static_cast<int>(session->queue.size());
+  session->queue.clear();
+
+  size_t index = found - sessions.begin();
+  sessions.erase(found);
+  if (lastServed >= index && lastServed > 0) {
+    lastServed--;
+  }
+
+  workDone.wait(lock, [&]() { return session->running == 0; });
+  workDone.notify_all();
+}
+
+std::shared_ptr<AnalysisPool::Session> AnalysisPool::FindSession(int id) {
+  for (const std::shared_ptr<Session> &session : sessions) {
+    if (session->id == id) {
+      return session;
+    }
+  }
+  return nullptr;
+}
+
+bool AnalysisPool::Submit(int id, const AnalysisRequest &request) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<Session> session = FindSession(id);
+    if (!session) {
+      return false;
+    }
+    session->queue.push_back(request);
+    queued++;
+  }
+  workReady.notify_one();
+  return true;
+}
+
+void AnalysisPool::Cancel(int id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<Session> session = FindSession(id);
+  if (session) {
+    queued -= static_cast<int>(session->queue.size());
+    session->queue.clear();
+  }
+  workDone.notify_all();
+}
+
+void AnalysisPool::SetLimits(int id, const SessionLimits &limits) {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<Session> session = FindSession(id);
+  if (session) {
+    session->limits = limits;
+  }
+}
+
+void AnalysisPool::Wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  workDone.wait(lock, [this]() { return queued == 0 && running == 0; });
+}
+
+std::shared_ptr<AnalysisPool::Session> AnalysisPool::NextSession() {
+  for (size_t i = 1; i <= sessions.size(); ++i) {
+    size_t index = (lastServed + i) % sessions.size();
+    if (!sessions[index]->queue.empty()) {
+      lastServed = index;
+      return sessions[index];
+    }
+  }
+  return nullptr;
+}
+
+void AnalysisPool::Worker() {
+  Searcher searcher;
+  searcher.verbose = false;
+  searcher.options = options;
+  searcher.table.Resize(tableMegabytes, true);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    workReady.wait(lock, [this]() { return stopping || queued > 0; });
+    if (stopping) {
+      return;
+    }
+
+    std::shared_ptr<Session> session = NextSession();
+    AnalysisRequest request = std::move(session->queue.front());
+    session->queue.pop_front();
+    queued--;
+    session->running++;
+    running++;
+
+    // Capped by the session, and by what is left of its budget, which is
+    // held back until the search is done
+    const SessionLimits &caps = session->limits;
+    SearchLimits limits = request.limits;
+    limits.depth = Tighter(limits.depth, caps.depth);
+    limits.nodes = Tighter(limits.nodes, caps.nodes);
+    limits.moveTime = Tighter(limits.moveTime, caps.moveTime);
+    uint64_t reserved = 0;
+    bool refused = false;
+    if (caps.nodeBudget) {
+      uint64_t left = caps.nodeBudget - std::min(session->nodesUsed, caps.nodeBudget);
+      refused = left == 0;
+      limits.nodes = Tighter(limits.nodes, left);
+      reserved = refused ? 0 : limits.nodes;
+      session->nodesUsed += reserved;
+    }
+    if (!limits.depth) {
+      limits.depth = limits.nodes || limits.moveTime ? MAX_PLY - 1 : DEFAULT_ANALYSIS_DEPTH;
+    }
+    lock.unlock();
+
+    Board board;
+    int color;
+    uint64_t searched = 0;
+    if (refused) {
+      session->reply("error " + request.id + " budget used up");
+    } else if (!board.FromFEN(request.fen, color)) {
+      session->reply("error " + request.id + " invalid position");
+    } else {
+      SearchResult result = searcher.Search(board, color, limits);
+      searched = result.nodes;
+      positions++;
+      nodes += searched;
+      session->reply(FormatResult(request.id, result, limits.multiPV));
+    }
+
+    lock.lock();
+    session->nodesUsed = session->nodesUsed - reserved + searched;
+    session->running--;
+    running--;
+    workDone.notify_all();
+  }
+}
+
+#ifndef _WIN32
+
+// analyze <id> <fen> [depth <d>] [nodes <n>] [movetime <ms>] [multipv <k>]
+static bool ParseAnalyze(std::istringstream &input, AnalysisRequest &request) {
+  if (!(input >> request.id)) {
+    return false;
+  }
+  request.limits.depth = 0;
+
+  std::string token;
+  while (input >> token) {
+    if (token == "depth") {
+      input >> request.limits.depth;
+    } else if (token == "nodes") {
+      input >> request.limits.nodes;
+    } else if (token == "movetime") {
+      input >> request.limits.moveTime;
+    } else if (token == "multipv") {
+      input >> request.limits.multiPV;
+      request.limits.multiPV = std::clamp(request.limits.multiPV, 1, MAX_MULTIPV);
+    } else {
+      request.fen += (request.fen.empty() ? "" : " ") + token;
+    }
+  }
+  return !request.fen.empty();
+}
+
+AnalysisServer::~AnalysisServer() {
+  if (listener != -1) {
+    ::close(listener);
+  }
+  if (!socketPath.empty()) {
+    unlink(socketPath.c_str());
+  }
+}
+
+bool AnalysisServer::Listen(const std::string &address) {
+  if (address.rfind("unix:", 0) == 0) {
+    sockaddr_un local{};
+    std::string path = address.substr(5);
+    if (path.empty() || path.size() >= sizeof(local.sun_path)) {
+      return false;
+    }
+    local.sun_family = AF_UNIX;
+    std::strncpy(local.sun_path, path.c_str(), sizeof(local.sun_path) - 1);
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (listener == -1 || bind(listener, reinterpret_cast<sockaddr *>(&local), sizeof(local)) == -1) {
+      return false;
+    }
+    socketPath = path;
+  } else {
+    int port = std::atoi(address.c_str());
+    if (port <= 0 || port > 65535) {
+      return false;
+    }
+    sockaddr_in loopback{};
+    loopback.sin_family = AF_INET;
+    loopback.sin_port = htons(static_cast<uint16_t>(port));
+    loopback.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    if (listener == -1 || setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == -1
+        || bind(listener, reinterpret_cast<sockaddr *>(&loopback), sizeof(loopback)) == -1) {
+      return false;
+    }
+  }
+  return ::listen(listener, SOMAXCONN) == 0;
+}
+
+void AnalysisServer::Run() {
+  while (!stopped) {
+    // Wakes up now and then to see if the server was stopped
+    pollfd waiting{listener, POLLIN, 0};
+    if (poll(&waiting, 1, 100) <= 0) {
+      continue;
+    }
+    int connection = accept(listener, nullptr, nullptr);
+    if (connection == -1) {
+      continue;
+    }
+    ReapSessions();
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    connections.push_back(connection);
+    sessionThreads.push_back(std::make_unique<SessionThread>());
+    SessionThread &session = *sessionThreads.back();
+    session.thread = std::thread(&AnalysisServer::Serve, this, connection, std::ref(session.finished));
+  }
+
+  // Unblocks the sessions still reading, they then end themselves
+  {
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    for (int connection : connections) {
+      shutdown(connection, SHUT_RDWR);
+    }
+  }
+  for (std::unique_ptr<SessionThread> &session : sessionThreads) {
+    session->thread.join();
+  }
+  sessionThreads.clear();
+}
+
+void AnalysisServer::ReapSessions() {
+  auto ended = std::remove_if(sessionThreads.begin(), sessionThreads.end(), [](std::unique_ptr<SessionThread> &session) {
+    if (!session->finished) {
+      return false;
+    }
+    session->thread.join();
+    return true;
+  });
+  sessionThreads.erase(ended, sessionThreads.end());
+}
+
+void AnalysisServer::Stop() {
+  stopped = true;
+}
+
+void AnalysisServer::Serve(int connection, std::atomic<bool> &finished) {
+  std::mutex writeMutex;
+  auto reply = [&](const std::string &line) {
+    std::string text = line + "\n";
+    std::lock_guard<std::mutex> lock(writeMutex);
+    for (size_t sent = 0; sent < text.size();) {
+      // A client gone mid-reply is a failed send, not a SIGPIPE for the whole process
+      ssize_t written = send(connection, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+      if (written <= 0) {
+        return;
+      }
+      sent += written;
+    }
+  };
+  int session = pool.OpenSession(limits, reply);
+  SessionLimits sessionLimits = limits;
+
+  std::string pending;
+  char buffer[4096];
+  bool open = true;
+  while (open) {
+    ssize_t received = recv(connection, buffer, sizeof(buffer), 0);
+    if (received <= 0) {
+      break;
+    }
+    pending.append(buffer, received);
+
+    size_t end;
+    while (open && (end = pending.find('\n')) != std::string::npos) {
+      std::istringstream input(pending.substr(0, end));
+      pending.erase(0, end + 1);
+      std::string command;
+      input >> command;
+
+      if (command == "analyze") {
+        AnalysisRequest request;
+        if (ParseAnalyze(input, request)) {
+          pool.Submit(session, request);
+        } else {
+          reply("error " + (request.id.empty() ? "-" : request.id) + " no position");
+        }
+      } else if (command == "limits") {
+        // A session can tighten the server's limits, not lift them
+        SessionLimits requested;
+        std::string token;
+        while (input >> token) {
+          if (token == "depth") {
+            input >> requested.depth;
+          } else if (token == "nodes") {
+            input >> requested.nodes;
+          } else if (token == "movetime") {
+            input >> requested.moveTime;
+          } else if (token == "budget") {
+            input >> requested.nodeBudget;
+          }
+        }
+        sessionLimits.depth = Tighter(requested.depth, limits.depth);
+        sessionLimits.nodes = Tighter(requested.nodes, limits.nodes);
+        sessionLimits.moveTime = Tighter(requested.moveTime, limits.moveTime);
+        sessionLimits.nodeBudget = Tighter(requested.nodeBudget, limits.nodeBudget);
+        pool.SetLimits(session, sessionLimits);
+      } else if (command == "cancel") {
+        pool.Cancel(session);
+      } else if (command == "quit") {
+        open = false;
+      } else if (command == "shutdown") {
+        Stop();
+        open = false;
+      }
+    }
+  }
+
+  pool.CloseSession(session);
+
+  {
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    connections.erase(std::find(connections.begin(), connections.end(), connection));
+    ::close(connection);
+  }
+  finished = true;
+}
+
+#else
+
+AnalysisServer::~AnalysisServer() {
+}
+
+bool AnalysisServer::Listen(const std::string &address) {
+  return false;
+}
+
+void AnalysisServer::Run() {
+}
+
+void AnalysisServer::Stop() {
+  stopped = true;
+}
+
+void AnalysisServer::Serve(int connection, std::atomic<bool> &finished) {
+}
+
+void AnalysisServer::ReapSessions() {
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef NP_SERVER_HPP
+#define NP_SERVER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Search.hpp"
+
+// Depth an analysis goes to when neither it nor its session sets a limit
+#define DEFAULT_ANALYSIS_DEPTH 8
+
+// What a session may spend. The limits of each request are capped to these,
+// and once the node budget is used up the session's requests are refused.
+struct SessionLimits {
+  int depth = 0;            // per request, 0 means no cap
+  uint64_t nodes = 0;       // per request, 0 means no cap
+  int64_t moveTime = 0;     // per request, milliseconds, 0 means no cap
+  uint64_t nodeBudget = 0;  // over the whole session, 0 means no budget
+};
+
+struct AnalysisRequest {
+  std::string id;
+  std::string fen;
+  SearchLimits limits;  // depth 0 means not given
+};
+
+// Gets the reply line of every request, called from a pool thread
+using ReplyFunction = std::function<void(const std::string &reply)>;
+
+// Searches the positions of many sessions on one set of threads. Every thread
+// has its own Searcher, with a share of the hash, and the move tables are
+// filled once for the whole process. A free thread takes the next request of
+// the next session in turn, so a session with a long queue can't hold the
+// others back.
+class AnalysisPool {
+public:
+  AnalysisPool(int threadCount, size_t hashMegabytes, const SearchOptions &options);
+  ~AnalysisPool();
+
+  AnalysisPool(const AnalysisPool &) = delete;
+  AnalysisPool &operator=(const AnalysisPool &) = delete;
+
+  int OpenSession(const SessionLimits &limits, ReplyFunction reply);
+  // Drops the queued requests and waits for the running ones, reply isn't
+  // called for the session after this returns
+  void CloseSession(int session);
+
+  // False if there is no such session
+  bool Submit(int session, const AnalysisRequest &request);
+  // Drops the requests still queued, they get no reply
+  void Cancel(int session);
+  void SetLimits(int session, const SessionLimits &limits);
+
+  // Blocks until no request is queued or running
+  void Wait();
+
+  uint64_t PositionsAnalyzed() const {
+    return positions;
+  }
+  uint64_t NodesSearched() const {
+    return nodes;
+  }
+
+private:
+  struct Session;
+
+  void Worker();
+  // The next session after the last one served that has work, under the lock
+  std::shared_ptr<Session> NextSession();
+  std::shared_ptr<Session> FindSession(int session);
+
+private:
+  SearchOptions options;
+  size_t tableMegabytes;
+
+  std::mutex mutex;
+  std::condition_variable workReady;
+  std::condition_variable workDone;
+  std::vector<std::shared_ptr<Session>> sessions;
+  size_t lastServed = 0;
+  int nextSessionId = 1;
+  int queued = 0;
+  int running = 0;
+  bool stopping = false;
+
+  std::atomic<uint64_t> positions{0};
+  std::atomic<uint64_t> nodes{0};
+
+  std::vector<std::thread> threads;
+};
+
+// Serves a pool over a local socket, one session per connection. The address
+// is a port on the loopback interface, or unix:<path> for a UNIX domain socket.
+// Lines in, lines out; results come back in the order they finish:
+//   analyze <id> <fen> [depth <d>] [nodes <n>] [movetime <ms>] [multipv <k>]
+//     result <id> bestmove <move> score <score> depth <d> nodes <n> [multipv <i> <move> <score> ...]
+//     error <id> <reason>
+//   limits [depth <d>] [nodes <n>] [movetime <ms>] [budget <nodes>]
+//   cancel     drops the session's queued requests
+//   quit       ends the session
+//   shutdown   stops the server
+class AnalysisServer {
+public:
+  AnalysisServer(AnalysisPool &pool, const SessionLimits &limits) : pool(pool), limits(limits) {}
+  ~AnalysisServer();
+
+  AnalysisServer(const AnalysisServer &) = delete;
+  AnalysisServer &operator=(const AnalysisServer &) = delete;
+
+  // False if the address can't be bound, or there are no sockets on this platform
+  bool Listen(const std::string &address);
+  // Takes connections until Stop or a shutdown command, then ends every session
+  void Run();
+  void Stop();
+
+private:
+  struct SessionThread {
+    std::thread thread;
+    std::atomic<bool> finished{false};  // set by the session as it ends, so it can be joined
+  };
+
+  // Raises finished once the session is over
+  void Serve(int connection, std::atomic<bool> &finished);
+  // Joins the sessions that have ended
+  void ReapSessions();
+
+private:
+  AnalysisPool &pool;
+  SessionLimits limits;
+
+  int listener = -1;
+  std::string socketPath;
+  std::atomic<bool> stopped{false};
+
+  std::mutex connectionsMutex;
+  std::vector<int> connections;
+  std::vector<std::unique_ptr<SessionThread>> sessionThreads;
+};
+
+#endif // NP_SERVER_HPP
@@ -0,0 +1,1336 @@
+#include "Syzygy.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// The decoding below follows the layout of the Syzygy files as documented by
+// their author (Ronald de Man) and the reference probing code.
+
+namespace Syzygy {
+
+namespace {
+
+#define TB_PIECES 7
+
+enum TBType { WDL, DTZ };
+enum TBFlag { STM = 1, Mapped = 2, WinPlies = 4, LossPlies = 8, Wide = 16, SingleValue = 128 };
+enum Endian { BigEndian, LittleEndian };
+
+// Tablebase piece codes: white pawn..king are 1..6, black pawn..king are 9..14
+inline int TBPiece(int color, int pieceType) { return (color << 3) | (pieceType + 1); }
+inline int TBPieceColor(int piece) { return piece >> 3; }
+
+inline int FileOf(int square) { return square & 7; }
+inline int RankOf(int square) { return square >> 3; }
+inline int FlipFile(int square) { return square ^ 7; }
+inline int FlipRank(int square) { return square ^ 56; }
+inline int MapToQueenside(int file) { return std::min(file, 7 - file); }
+inline int OffA1H8(int square) { return RankOf(square) - FileOf(square); }
+
+int maxCardinality = 0;
+std::string tablebasePaths;
+
+int MapPawns[64];
+int MapB1H1H7[64];
+int MapA1D1D4[64];
+int MapKK[10][64];
+
+int Binomial[6][64];      // [k][n] k elements from a set of n elements
+int LeadPawnIdx[6][64];   // [leadPawnsCount][square]
+int LeadPawnsSize[6][4];  // [leadPawnsCount][file a..d]
+
+bool PawnsCompare(int i, int j) { return MapPawns[i] < MapPawns[j]; }
+
+template<typename T>
+inline void SwapEndian(T &x) {
+  uint8_t *c = reinterpret_cast<uint8_t *>(&x);
+  std::reverse(c, c + sizeof(T));
+}
+
+template<typename T, int LE>
+T Number(void *address) {
+  T value;
+  std::memcpy(&value, address, sizeof(T));
+
+  const uint16_t probe = 1;
+  const bool isLittleEndian = *reinterpret_cast<const uint8_t *>(&probe) == 1;
+  if (LE != isLittleEndian) {
+    SwapEndian(value);
+  }
+  return value;
+}
+
+// DTZ tables don't store valid scores for moves that reset the 50-move counter,
+// but the DTZ of the move before can be recovered from the WDL score.
+int DTZBeforeZeroing(WDLScore wdl) {
+  return wdl == WDL_WIN          ?  1   :
+         wdl == WDL_CURSED_WIN   ?  101 :
+         wdl == WDL_BLESSED_LOSS ? -101 :
+         wdl == WDL_LOSS         ? -1   : 0;
+}
+
+inline int SignOf(int value) {
+  return (0 < value) - (value < 0);
+}
+
+// Little endian pointers from SparseIndex[] into blockLength[]
+struct SparseEntry {
+  char block[4];   // Number of block
+  char offset[2];  // Offset within the block
+};
+
+static_assert(sizeof(SparseEntry) == 6, "SparseEntry must be 6 bytes");
+
+typedef uint16_t Sym; // Huffman symbol
+
+// Pair of 12 bit symbols that a symbol expands to. For a leaf the left
+// symbol is the stored value.
+struct LR {
+  uint8_t lr[3];
+
+  Sym Left() const { return ((lr[1] & 0xF) << 8) | lr[0]; }
+  Sym Right() const { return (lr[2] << 4) | (lr[1] >> 4); }
+};
+
+static_assert(sizeof(LR) == 3, "LR tree entry must be 3 bytes");
+
+// Low level indexing information for one sub-table of a file: one per side
+// to move, and per leading pawn file for tables with pawns.
+struct PairsData {
+  uint8_t flags = 0;               // TBFlag
+  uint8_t maxSymLen = 0;           // Longest Huffman symbol, in bits
+  uint8_t minSymLen = 0;           // Shortest Huffman symbol, in bits
+  uint32_t numBlocks = 0;          // Number of blocks in the file
+  size_t sizeofBlock = 0;          // Block size in bytes
+  size_t span = 0;                 // About every span values there is a SparseIndex[] entry
+  Sym *lowestSym = nullptr;        // lowestSym[l] is the lowest symbol of length l
+  LR *btree = nullptr;             // btree[sym] holds the symbols sym expands to
+  uint16_t *blockLength = nullptr; // Number of stored positions (minus one) per block
+  uint32_t blockLengthSize = 0;    // Size of blockLength[], padded past numBlocks
+  SparseEntry *sparseIndex = nullptr;
+  size_t sparseIndexSize = 0;
+  uint8_t *data = nullptr;         // Start of the compressed data
+  std::vector<uint64_t> base64;    // base64[l - minSymLen] is the 64 bit padded lowest symbol of length l
+  std::vector<uint8_t> symlen;     // Number of values (minus one) a symbol expands to
+  int pieces[TB_PIECES] = {};      // Order of the pieces, defines the groups
+  uint64_t groupIdx[TB_PIECES + 1] = {}; // Start index of each group
+  int groupLen[TB_PIECES + 1] = {};      // Number of pieces per group, KRKN -> (3, 1)
+  uint16_t mapIdx[4] = {};         // WDL_WIN, WDL_LOSS, WDL_CURSED_WIN, WDL_BLESSED_LOSS (DTZ only)
+};
+
+// One .rtbw or .rtbz file with its indexing information
+template<TBType Type>
+struct TBTable {
+  typedef typename std::conditional<Type == WDL, WDLScore, int>::type Ret;
+
+  static constexpr int Sides = Type == WDL ? 2 : 1;
+
+  void *baseAddress = nullptr;
+  uint64_t mapping = 0;
+  uint8_t *map = nullptr;
+  uint64_t key = 0;  // Material key with the stronger side as white
+  uint64_t key2 = 0; // Material key with the stronger side as black
+  int pieceCount = 0;
+  bool hasPawns = false;
+  bool hasUniquePieces = false;
+  uint8_t pawnCount[2] = {}; // [lead color / other color]
+  PairsData items[Sides][4]; // [white / black to move][file a..d or 0]
+
+  PairsData *Get(int stm, int file) {
+    return &items[stm % Sides][hasPawns ? file : 0];
+  }
+
+  ~TBTable();
+};
+
+// Material key: 4 bits for the count of every colored piece type
+uint64_t MaterialKey(const int counts[2][6]) {
+  uint64_t key = 0;
+  for (int color = WHITE; color <= BLACK; ++color) {
+    for (int pieceType = PAWN; pieceType <= KING; ++pieceType) {
+      key |= uint64_t(counts[color][pieceType]) << (4 * (color * 6 + pieceType));
+    }
+  }
+  return key;
+}
+
+uint64_t MaterialKey(const Board &board) {
+  int counts[2][6];
+  for (int color = WHITE; color <= BLACK; ++color) {
+    for (int pieceType = PAWN; pieceType <= KING; ++pieceType) {
+      counts[color][pieceType] = board.GetPieces(color, pieceType).Count();
+    }
+  }
+  return MaterialKey(counts);
+}
+
+void UnmapFile(void *baseAddress, uint64_t mapping) {
+#if defined(_WIN32)
+  UnmapViewOfFile(baseAddress);
+  CloseHandle(reinterpret_cast<HANDLE>(mapping));
+#else
+  munmap(baseAddress, mapping);
+#endif
+}
+
+template<TBType Type>
+TBTable<Type>::~TBTable() {
+  if (baseAddress) {
+    UnmapFile(baseAddress, mapping);
+  }
+}
+
+// Finds a file among the tablebase paths
+bool FindFile(const std::string &name, std::string &fullPath) {
+#if defined(_WIN32)
+  const char separator = ';';
+#else
+  const char separator = ':';
+#endif
+  std::stringstream ss(tablebasePaths);
+  std::string path;
+
+  while (std::getline(ss, path, separator)) {
+    fullPath = path + "/" + name;
+    std::ifstream file(fullPath);
+    if (file.is_open()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Memory maps a tablebase file and checks its magic. Returns the data after the magic.
+uint8_t *MapFile(const std::string &name, void **baseAddress, uint64_t *mapping, TBType type) {
+  std::string fullPath;
+  *baseAddress = nullptr;
+  if (!FindFile(name, fullPath)) {
+    return nullptr;
+  }
+
+#if defined(_WIN32)
+  HANDLE fd = CreateFileA(fullPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                          OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+  if (fd == INVALID_HANDLE_VALUE) {
+    return nullptr;
+  }
+
+  DWORD sizeHigh;
+  DWORD sizeLow = GetFileSize(fd, &sizeHigh);
+  uint64_t size = (uint64_t(sizeHigh) << 32) | sizeLow;
+  if (size % 64 != 16) {
+    std::cerr << "Corrupt tablebase file " << fullPath << std::endl;
+    CloseHandle(fd);
+    return nullptr;
+  }
+
+  HANDLE mmap = CreateFileMapping(fd, nullptr, PAGE_READONLY, sizeHigh, sizeLow, nullptr);
+  CloseHandle(fd);
+  if (!mmap) {
+    return nullptr;
+  }
+
+  *mapping = reinterpret_cast<uint64_t>(mmap);
+  *baseAddress = MapViewOfFile(mmap, FILE_MAP_READ, 0, 0, 0);
+  if (!*baseAddress) {
+    CloseHandle(mmap);
+    return nullptr;
+  }
+#else
+  int fd = ::open(fullPath.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return nullptr;
+  }
+
+  struct stat statbuf;
+  fstat(fd, &statbuf);
+  if (statbuf.st_size % 64 != 16) {
+    std::cerr << "Corrupt tablebase file " << fullPath << std::endl;
+    ::close(fd);
+    return nullptr;
+  }
+
+  *mapping = statbuf.st_size;
+  void *address = mmap(nullptr, statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (address == MAP_FAILED) {
+    std::cerr << "Could not mmap tablebase file " << fullPath << std::endl;
+    return nullptr;
+  }
+  madvise(address, statbuf.st_size, MADV_RANDOM);
+  *baseAddress = address;
+#endif
+
+  const uint8_t magics[][4] = { { 0xD7, 0x66, 0x0C, 0xA5 },
+                                { 0x71, 0xE8, 0x23, 0x5D } };
+
+  uint8_t *data = static_cast<uint8_t *>(*baseAddress);
+  if (std::memcmp(data, magics[type == WDL], 4)) {
+    std::cerr << "Corrupt tablebase file " << fullPath << std::endl;
+    UnmapFile(*baseAddress, *mapping);
+    *baseAddress = nullptr;
+    return nullptr;
+  }
+
+  return data + 4;
+}
+
+// Owns the tables and looks them up by material key. Filled by Init(), read-only afterwards.
+class TBTables {
+  struct Entry {
+    uint64_t key;
+    TBTable<WDL> *wdl;
+    TBTable<DTZ> *dtz;
+  };
+
+  static constexpr int Size = 1 << 12;
+  static constexpr int Overflow = 1; // Keeps the last bucket empty, so lookups always stop
+
+  Entry hashTable[Size + Overflow];
+
+  std::deque<TBTable<WDL>> wdlTable;
+  std::deque<TBTable<DTZ>> dtzTable;
+
+  static uint32_t Bucket(uint64_t key) {
+    return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ULL) >> 52);
+  }
+
+  void Insert(uint64_t key, TBTable<WDL> *wdl, TBTable<DTZ> *dtz);
+
+public:
+  TBTables() { Clear(); }
+
+  TBTable<WDL> *GetWDL(uint64_t key) const {
+    for (const Entry *entry = &hashTable[Bucket(key)]; ; ++entry) {
+      if (entry->key == key || !entry->wdl) {
+        return entry->wdl;
+      }
+    }
+  }
+
+  TBTable<DTZ> *GetDTZ(uint64_t key) const {
+    for (const Entry *entry = &hashTable[Bucket(key)]; ; ++entry) {
+      if (entry->key == key || !entry->wdl) {
+        return entry->dtz;
+      }
+    }
+  }
+
+  void Clear() {
+    std::memset(hashTable, 0, sizeof(hashTable));
+    wdlTable.clear();
+    dtzTable.clear();
+  }
+
+  size_t Count() const { return wdlTable.size(); }
+
+  void Add(const std::vector<int> &pieceTypes);
+};
+
+TBTables tbTables;
+
+void TBTables::Insert(uint64_t key, TBTable<WDL> *wdl, TBTable<DTZ> *dtz) {
+  uint32_t homeBucket = Bucket(key);
+  Entry entry{ key, wdl, dtz };
+
+  for (uint32_t bucket = homeBucket; bucket < Size + Overflow - 1; ++bucket) {
+    uint64_t otherKey = hashTable[bucket].key;
+    if (otherKey == key || !hashTable[bucket].wdl) {
+      hashTable[bucket] = entry;
+      return;
+    }
+
+    // Robin Hood hashing: whoever is closer to home gives up the bucket
+    uint32_t otherHomeBucket = Bucket(otherKey);
+    if (otherHomeBucket > homeBucket) {
+      std::swap(entry, hashTable[bucket]);
+      key = otherKey;
+      homeBucket = otherHomeBucket;
+    }
+  }
+  std::cerr << "Tablebase hash table too small" << std::endl;
+}
+
+// Group together pieces that are encoded together. A group holds pieces of the
+// same type and color, except for the leading group which, without pawns, holds
+// three unique pieces or the two kings. KRKN -> KRK + N, KNNK -> KK + NN, KPPKP -> P + PP + K + K
+template<typename T>
+void SetGroups(T &e, PairsData *d, int order[], int file) {
+  int n = 0;
+  int firstLen = e.hasPawns ? 0 : e.hasUniquePieces ? 3 : 2;
+  d->groupLen[n] = 1;
+
+  for (int i = 1; i < e.pieceCount; ++i) {
+    if (--firstLen > 0 || d->pieces[i] == d->pieces[i - 1]) {
+      d->groupLen[n]++;
+    } else {
+      d->groupLen[++n] = 1;
+    }
+  }
+
+  d->groupLen[++n] = 0; // Zero-terminated
+
+  // The groups are encoded as g1 * N(g2) * N(g3) + g2 * N(g3) + g3, in a per
+  // table order: the leading group is at order[0] and the remaining pawns, when
+  // present, at order[1].
+  bool pp = e.hasPawns && e.pawnCount[1]; // Pawns on both sides
+  int next = pp ? 2 : 1;
+  int freeSquares = 64 - d->groupLen[0] - (pp ? d->groupLen[1] : 0);
+  uint64_t idx = 1;
+
+  for (int k = 0; next < n || k == order[0] || k == order[1]; ++k) {
+    if (k == order[0]) { // Leading pawns or pieces
+      d->groupIdx[0] = idx;
+      idx *= e.hasPawns ? LeadPawnsSize[d->groupLen[0]][file]
+           : e.hasUniquePieces ? 31332 : 462;
+    } else if (k == order[1]) { // Remaining pawns
+      d->groupIdx[1] = idx;
+      idx *= Binomial[d->groupLen[1]][48 - d->groupLen[0]];
+    } else { // Remaining pieces
+      d->groupIdx[next] = idx;
+      idx *= Binomial[d->groupLen[next]][freeSquares];
+      freeSquares -= d->groupLen[next++];
+    }
+  }
+
+  d->groupIdx[n] = idx;
+}
+
+// Recursive Pairing: every symbol stands for a pair of child symbols, expand
+// them down to the leaves to know how many values each symbol represents.
+uint8_t SetSymlen(PairsData *d, Sym s, std::vector<bool> &visited) {
+  visited[s] = true; // The tree is acyclic
+  Sym sr = d->btree[s].Right();
+
+  if (sr == 0xFFF) {
+    return 0;
+  }
+
+  Sym sl = d->btree[s].Left();
+
+  if (!visited[sl]) {
+    d->symlen[sl] = SetSymlen(d, sl, visited);
+  }
+
+  if (!visited[sr]) {
+    d->symlen[sr] = SetSymlen(d, sr, visited);
+  }
+
+  return d->symlen[sl] + d->symlen[sr] + 1;
+}
+
+uint8_t *SetSizes(PairsData *d, uint8_t *data) {
+  d->flags = *data++;
+
+  if (d->flags & SingleValue) {
+    d->numBlocks = d->blockLengthSize = 0;
+    d->span = d->sparseIndexSize = 0;
+    d->minSymLen = *data++; // The single value
+    return data;
+  }
+
+  // The last groupIdx[] holds the biggest index, which is the table size
+  uint64_t tbSize = d->groupIdx[std::find(d->groupLen, d->groupLen + TB_PIECES, 0) - d->groupLen];
+
+  d->sizeofBlock = 1ULL << *data++;
+  d->span = 1ULL << *data++;
+  d->sparseIndexSize = size_t((tbSize + d->span - 1) / d->span);
+  uint8_t padding = Number<uint8_t, LittleEndian>(data++);
+  d->numBlocks = Number<uint32_t, LittleEndian>(data);
+  data += sizeof(uint32_t);
+  d->blockLengthSize = d->numBlocks + padding; // Padded so SparseIndex[] never points out of range
+  d->maxSymLen = *data++;
+  d->minSymLen = *data++;
+  d->lowestSym = reinterpret_cast<Sym *>(data);
+  d->base64.resize(d->maxSymLen - d->minSymLen + 1);
+
+  // Canonical Huffman code: longer symbols have lower values, so base64[]
+  // decreases with the symbol length.
+  for (int i = static_cast<int>(d->base64.size()) - 2; i >= 0; --i) {
+    d->base64[i] = (d->base64[i + 1] + Number<Sym, LittleEndian>(&d->lowestSym[i])
+                                     - Number<Sym, LittleEndian>(&d->lowestSym[i + 1])) / 2;
+  }
+
+  // Right-pad to 64 bits, so a symbol s64 of length i has base64[i - 1] > s64 >= base64[i]
+  for (size_t i = 0; i < d->base64.size(); ++i) {
+    d->base64[i] <<= 64 - i - d->minSymLen;
+  }
+
+  data += d->base64.size() * sizeof(Sym);
+  d->symlen.resize(Number<uint16_t, LittleEndian>(data));
+  data += sizeof(uint16_t);
+  d->btree = reinterpret_cast<LR *>(data);
+
+  std::vector<bool> visited(d->symlen.size());
+
+  for (Sym sym = 0; sym < d->symlen.size(); ++sym) {
+    if (!visited[sym]) {
+      d->symlen[sym] = SetSymlen(d, sym, visited);
+    }
+  }
+
+  return data + d->symlen.size() * sizeof(LR) + (d->symlen.size() & 1);
+}
+
+uint8_t *SetDTZMap(TBTable<WDL> &, uint8_t *data, int) {
+  return data;
+}
+
+uint8_t *SetDTZMap(TBTable<DTZ> &e, uint8_t *data, int maxFile) {
+  e.map = data;
+
+  for (int file = 0; file <= maxFile; ++file) {
+    uint8_t flags = e.Get(0, file)->flags;
+    if (flags & Mapped) {
+      if (flags & Wide) {
+        data += reinterpret_cast<uintptr_t>(data) & 1; // Word alignment
+        for (int i = 0; i < 4; ++i) {
+          e.Get(0, file)->mapIdx[i] = uint16_t(reinterpret_cast<uint16_t *>(data) - reinterpret_cast<uint16_t *>(e.map) + 1);
+          data += 2 * Number<uint16_t, LittleEndian>(data) + 2;
+        }
+      } else {
+        for (int i = 0; i < 4; ++i) {
+          e.Get(0, file)->mapIdx[i] = uint16_t(data - e.map + 1);
+          data += *data + 1;
+        }
+      }
+    }
+  }
+
+  return data + (reinterpret_cast<uintptr_t>(data) & 1); // Word alignment
+}
+
+// Fills the PairsData records from a freshly mapped file
+template<typename T>
+bool SetTable(T &e, uint8_t *data) {
+  enum { Split = 1, HasPawns = 2 };
+
+  if (e.hasPawns != bool(*data & HasPawns) || (e.key != e.key2) != bool(*data & Split)) {
+    return false;
+  }
+
+  data++; // Flags
+
+  const int sides = T::Sides == 2 && (e.key != e.key2) ? 2 : 1;
+  const int maxFile = e.hasPawns ? 3 : 0;
+
+  bool pp = e.hasPawns && e.pawnCount[1]; // Pawns on both sides
+
+  for (int file = 0; file <= maxFile; ++file) {
+    int order[][2] = { { *data & 0xF, pp ? *(data + 1) & 0xF : 0xF },
+                       { *data >> 4, pp ? *(data + 1) >> 4 : 0xF } };
+    data += 1 + pp;
+
+    for (int k = 0; k < e.pieceCount; ++k, ++data) {
+      for (int i = 0; i < sides; ++i) {
+        e.Get(i, file)->pieces[k] = i ? *data >> 4 : *data & 0xF;
+      }
+    }
+
+    for (int i = 0; i < sides; ++i) {
+      SetGroups(e, e.Get(i, file), order[i], file);
+    }
+  }
+
+  data += reinterpret_cast<uintptr_t>(data) & 1; // Word alignment
+
+  for (int file = 0; file <= maxFile; ++file) {
+    for (int i = 0; i < sides; ++i) {
+      data = SetSizes(e.Get(i, file), data);
+    }
+  }
+
+  data = SetDTZMap(e, data, maxFile);
+
+  for (int file = 0; file <= maxFile; ++file) {
+    for (int i = 0; i < sides; ++i) {
+      PairsData *d = e.Get(i, file);
+      d->sparseIndex = reinterpret_cast<SparseEntry *>(data);
+      data += d->sparseIndexSize * sizeof(SparseEntry);
+    }
+  }
+
+  for (int file = 0; file <= maxFile; ++file) {
+    for (int i = 0; i < sides; ++i) {
+      PairsData *d = e.Get(i, file);
+      d->blockLength = reinterpret_cast<uint16_t *>(data);
+      data += d->blockLengthSize * sizeof(uint16_t);
+    }
+  }
+
+  for (int file = 0; file <= maxFile; ++file) {
+    for (int i = 0; i < sides; ++i) {
+      PairsData *d = e.Get(i, file);
+      data = reinterpret_cast<uint8_t *>((reinterpret_cast<uintptr_t>(data) + 0x3F) & ~uintptr_t(0x3F)); // 64 byte alignment
+      d->data = data;
+      data += d->numBlocks * d->sizeofBlock;
+    }
+  }
+
+  return true;
+}
+
+template<typename T>
+void MapTable(T &e, const std::string &name, TBType type) {
+  uint8_t *data = MapFile(name, &e.baseAddress, &e.mapping, type);
+  if (data && !SetTable(e, data)) {
+    std::cerr << "Unexpected layout in tablebase file " << name << std::endl;
+    UnmapFile(e.baseAddress, e.mapping);
+    e.baseAddress = nullptr;
+  }
+}
+
+// Creates and maps the tables for a piece list like K R K, if its WDL file exists
+void TBTables::Add(const std::vector<int> &pieceTypes) {
+  const char pieceToChar[] = "PNBRQK";
+  std::string code;
+  int counts[2][6] = {};
+  int side = WHITE;
+
+  for (size_t i = 0; i < pieceTypes.size(); ++i) {
+    if (i > 0 && pieceTypes[i] == KING) {
+      code += 'v';
+      side = BLACK;
+    }
+    code += pieceToChar[pieceTypes[i]];
+    counts[side][pieceTypes[i]]++;
+  }
+
+  std::string fullPath;
+  if (!FindFile(code + ".rtbw", fullPath)) {
+    return;
+  }
+
+  wdlTable.emplace_back();
+  dtzTable.emplace_back();
+  TBTable<WDL> &wdl = wdlTable.back();
+  TBTable<DTZ> &dtz = dtzTable.back();
+
+  int swapped[2][6];
+  for (int pieceType = PAWN; pieceType <= KING; ++pieceType) {
+    swapped[WHITE][pieceType] = counts[BLACK][pieceType];
+    swapped[BLACK][pieceType] = counts[WHITE][pieceType];
+  }
+
+  wdl.key = MaterialKey(counts);
+  wdl.key2 = MaterialKey(swapped);
+  wdl.pieceCount = static_cast<int>(pieceTypes.size());
+  wdl.hasPawns = counts[WHITE][PAWN] || counts[BLACK][PAWN];
+
+  for (int color = WHITE; color <= BLACK; ++color) {
+    for (int pieceType = PAWN; pieceType < KING; ++pieceType) {
+      if (counts[color][pieceType] == 1) {
+        wdl.hasUniquePieces = true;
+      }
+    }
+  }
+
+  // The leading color is the side with fewer pawns, as it compresses better
+  bool lead = !counts[BLACK][PAWN] || (counts[WHITE][PAWN] && counts[BLACK][PAWN] >= counts[WHITE][PAWN]);
+  wdl.pawnCount[0] = counts[lead ? WHITE : BLACK][PAWN];
+  wdl.pawnCount[1] = counts[lead ? BLACK : WHITE][PAWN];
+
+  dtz.key = wdl.key;
+  dtz.key2 = wdl.key2;
+  dtz.pieceCount = wdl.pieceCount;
+  dtz.hasPawns = wdl.hasPawns;
+  dtz.hasUniquePieces = wdl.hasUniquePieces;
+  dtz.pawnCount[0] = wdl.pawnCount[0];
+  dtz.pawnCount[1] = wdl.pawnCount[1];
+
+  MapTable(wdl, code + ".rtbw", WDL);
+  MapTable(dtz, code + ".rtbz", DTZ);
+
+  if (!wdl.baseAddress) {
+    return;
+  }
+
+  maxCardinality = std::max(wdl.pieceCount, maxCardinality);
+
+  // Both colors can be the stronger side: KRvK with the rook white and black
+  Insert(wdl.key, &wdl, &dtz);
+  Insert(wdl.key2, &wdl, &dtz);
+}
+
+// Values are compressed with canonical Huffman codes into blocks of
+// d->sizeofBlock bytes. Each symbol is a WDL or (remapped) DTZ value, or a
+// pair of other symbols (recursively), so a block expands to up to 65536 values.
+int DecompressPairs(PairsData *d, uint64_t idx) {
+  // Every position in the table stores the same value
+  if (d->flags & SingleValue) {
+    return d->minSymLen;
+  }
+
+  // Block n stores blockLength[n] + 1 values. SparseIndex[k] gives the block and
+  // the offset inside it of the value with index k * span + span / 2, start
+  // from the nearest one and walk to the block holding idx.
+  uint32_t k = uint32_t(idx / d->span);
+
+  uint32_t block = Number<uint32_t, LittleEndian>(&d->sparseIndex[k].block);
+  int offset = Number<uint16_t, LittleEndian>(&d->sparseIndex[k].offset);
+
+  int diff = static_cast<int>(idx % d->span) - static_cast<int>(d->span / 2);
+  offset += diff;
+
+  while (offset < 0) {
+    offset += d->blockLength[--block] + 1;
+  }
+
+  while (offset > d->blockLength[block]) {
+    offset -= d->blockLength[block++] + 1;
+  }
+
+  uint32_t *ptr = reinterpret_cast<uint32_t *>(d->data + (uint64_t(block) * d->sizeofBlock));
+
+  // The first symbol of the block starts at the beginning of these 64 bits
+  uint64_t buf64 = Number<uint64_t, BigEndian>(ptr);
+  ptr += 2;
+  int buf64Size = 64;
+  Sym sym;
+
+  while (true) {
+    int len = 0; // Symbol length - minSymLen
+
+    while (buf64 < d->base64[len]) {
+      ++len;
+    }
+
+    // Symbols of a given length are consecutive integers
+    sym = Sym((buf64 - d->base64[len]) >> (64 - len - d->minSymLen));
+    sym += Number<Sym, LittleEndian>(&d->lowestSym[len]);
+
+    if (offset < d->symlen[sym] + 1) {
+      break;
+    }
+
+    offset -= d->symlen[sym] + 1;
+    len += d->minSymLen;
+    buf64 <<= len; // Consume the symbol
+    buf64Size -= len;
+
+    if (buf64Size <= 32) { // Refill the buffer
+      buf64Size += 32;
+      buf64 |= uint64_t(Number<uint32_t, BigEndian>(ptr++)) << (64 - buf64Size);
+    }
+  }
+
+  // Expand the symbol into its left and right children until reaching the leaf
+  // that holds our value
+  while (d->symlen[sym]) {
+    Sym left = d->btree[sym].Left();
+
+    if (offset < d->symlen[left] + 1) {
+      sym = left;
+    } else {
+      offset -= d->symlen[left] + 1;
+      sym = d->btree[sym].Right();
+    }
+  }
+
+  return d->btree[sym].Left();
+}
+
+bool CheckDTZStm(TBTable<WDL> *, int, int) {
+  return true;
+}
+
+bool CheckDTZStm(TBTable<DTZ> *entry, int stm, int file) {
+  uint8_t flags = entry->Get(stm, file)->flags;
+  return (flags & STM) == stm || ((entry->key == entry->key2) && !entry->hasPawns);
+}
+
+WDLScore MapScore(TBTable<WDL> *, int, int value, WDLScore) {
+  return WDLScore(value - 2);
+}
+
+// DTZ values are stored as ranks by frequency, the per WDL value map gives them back
+int MapScore(TBTable<DTZ> *entry, int file, int value, WDLScore wdl) {
+  const int wdlMap[] = { 1, 3, 0, 2, 0 };
+
+  uint8_t flags = entry->Get(0, file)->flags;
+
+  uint8_t *map = entry->map;
+  uint16_t *idx = entry->Get(0, file)->mapIdx;
+  if (flags & Mapped) {
+    if (flags & Wide) {
+      value = reinterpret_cast<uint16_t *>(map)[idx[wdlMap[wdl + 2]] + value];
+    } else {
+      value = map[idx[wdlMap[wdl + 2]] + value];
+    }
+  }
+
+  // Tables store either moves or plies, we want plies
+  if ((wdl == WDL_WIN && !(flags & WinPlies))
+      || (wdl == WDL_LOSS && !(flags & LossPlies))
+      || wdl == WDL_CURSED_WIN
+      || wdl == WDL_BLESSED_LOSS) {
+    value *= 2;
+  }
+
+  return value + 1;
+}
+
+// Computes the index of the position inside the table and decodes its value.
+// k pieces of the same type and color on squares s1 < s2 < ... < sk are
+// encoded as Binomial[1][s1] + Binomial[2][s2] + ... + Binomial[k][sk].
+template<typename T, typename Ret = typename T::Ret>
+Ret DoProbeTable(const Board &board, int color, T *entry, WDLScore wdl, ProbeState *result) {
+  int squares[TB_PIECES] = {};
+  int pieces[TB_PIECES] = {};
+  uint64_t idx;
+  int next = 0, size = 0, leadPawnsCount = 0;
+  Bitboard leadPawns;
+  int tbFile = 0;
+
+  // With the same material on both sides the tables only store white to move
+  bool symmetricBlackToMove = (entry->key == entry->key2 && color == BLACK);
+
+  // Tables are stored with white as the stronger side
+  bool blackStronger = (MaterialKey(board) != entry->key);
+
+  bool flip = symmetricBlackToMove || blackStronger;
+  int flipColor = flip * 8;
+  int flipSquares = flip * 56;
+  int stm = flip ^ color;
+
+  // Tables with pawns are split by the file of the leading pawn: the one with
+  // the highest MapPawns[] value, nearest the edge and on the lowest rank.
+  if (entry->hasPawns) {
+    int leadPiece = entry->Get(0, 0)->pieces[0] ^ flipColor;
+
+    leadPawns = board.GetPieces(TBPieceColor(leadPiece), PAWN);
+    Bitboard b = leadPawns;
+    while (b.IsNotEmpty()) {
+      squares[size++] = b.PopLeastSignificantBit() ^ flipSquares;
+    }
+
+    leadPawnsCount = size;
+
+    std::swap(squares[0], *std::max_element(squares, squares + leadPawnsCount, PawnsCompare));
+
+    tbFile = MapToQueenside(FileOf(squares[0]));
+  }
+
+  // DTZ tables only store one side to move
+  if (!CheckDTZStm(entry, stm, tbFile)) {
+    *result = PROBE_CHANGE_STM;
+    return Ret();
+  }
+
+  // Now the remaining pieces, mapped to the table's colors and squares
+  for (int c = WHITE; c <= BLACK; ++c) {
+    for (int pieceType = PAWN; pieceType <= KING; ++pieceType) {
+      Bitboard b = board.GetPieces(c, pieceType);
+      if (pieceType == PAWN) {
+        b.SetBoard(b.GetBoard() & ~leadPawns.GetBoard());
+      }
+      while (b.IsNotEmpty()) {
+        squares[size] = b.PopLeastSignificantBit() ^ flipSquares;
+        pieces[size++] = TBPiece(c, pieceType) ^ flipColor;
+      }
+    }
+  }
+
+  PairsData *d = entry->Get(stm, tbFile);
+
+  // Reorder the pieces to the sequence stored in the table
+  for (int i = leadPawnsCount; i < size - 1; ++i) {
+    for (int j = i + 1; j < size; ++j) {
+      if (d->pieces[i] == pieces[j]) {
+        std::swap(pieces[i], pieces[j]);
+        std::swap(squares[i], squares[j]);
+        break;
+      }
+    }
+  }
+
+  // Mirror so the leading piece is on files a..d
+  if (FileOf(squares[0]) > 3) {
+    for (int i = 0; i < size; ++i) {
+      squares[i] = FlipFile(squares[i]);
+    }
+  }
+
+  if (entry->hasPawns) {
+    // Encode the leading pawns in ascending MapPawns[] order
+    idx = LeadPawnIdx[leadPawnsCount][squares[0]];
+
+    std::stable_sort(squares + 1, squares + leadPawnsCount, PawnsCompare);
+
+    for (int i = 1; i < leadPawnsCount; ++i) {
+      idx += Binomial[i][MapPawns[squares[i]]];
+    }
+  } else {
+    // Without pawns, also mirror the leading piece below rank 5
+    if (RankOf(squares[0]) > 3) {
+      for (int i = 0; i < size; ++i) {
+        squares[i] = FlipRank(squares[i]);
+      }
+    }
+
+    // The first piece of the leading group off the a1-h8 diagonal must end up below it
+    for (int i = 0; i < d->groupLen[0]; ++i) {
+      if (!OffA1H8(squares[i])) {
+        continue;
+      }
+
+      if (OffA1H8(squares[i]) > 0) { // a1-h8 diagonal flip: a3 -> c1
+        for (int j = i; j < size; ++j) {
+          squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+        }
+      }
+      break;
+    }
+
+    // With three unique pieces (kings included) they are encoded together,
+    // squares taken by earlier pieces are skipped for the later ones.
+    if (entry->hasUniquePieces) {
+      int adjust1 = (squares[1] > squares[0]);
+      int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+      if (OffA1H8(squares[0])) {
+        // First piece below the diagonal: MapA1D1D4[] maps the b1-d1-d3 triangle to 0..5
+        idx = (MapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+      } else if (OffA1H8(squares[1])) {
+        // First on the diagonal, second below it
+        idx = (6 * 63 + RankOf(squares[0]) * 28 + MapB1H1H7[squares[1]]) * 62 + squares[2] - adjust2;
+      } else if (OffA1H8(squares[2])) {
+        // First two on the diagonal, third below it
+        idx = 6 * 63 * 62 + 4 * 28 * 62
+            + RankOf(squares[0]) * 7 * 28
+            + (RankOf(squares[1]) - adjust1) * 28
+            + MapB1H1H7[squares[2]];
+      } else {
+        // All three on the diagonal
+        idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28
+            + RankOf(squares[0]) * 6 * 5
+            + (RankOf(squares[1]) - adjust1) * 5
+            + RankOf(squares[2]) - adjust2;
+      }
+    } else {
+      // Only the two kings lead, like in KRRvKBB
+      idx = MapKK[MapA1D1D4[squares[0]]][squares[1]];
+    }
+  }
+
+  idx *= d->groupIdx[0];
+  int *groupSq = squares + d->groupLen[0];
+
+  // Remaining pawns, then pieces, each group in ascending square order
+  bool remainingPawns = entry->hasPawns && entry->pawnCount[1];
+
+  while (d->groupLen[++next]) {
+    std::stable_sort(groupSq, groupSq + d->groupLen[next]);
+    uint64_t n = 0;
+
+    // Skip the squares taken by the previous groups
+    for (int i = 0; i < d->groupLen[next]; ++i) {
+      int adjust = static_cast<int>(std::count_if(squares, groupSq, [&](int s) { return groupSq[i] > s; }));
+      n += Binomial[i + 1][groupSq[i] - adjust - 8 * remainingPawns];
+    }
+
+    remainingPawns = false;
+    idx += n * d->groupIdx[next];
+    groupSq += d->groupLen[next];
+  }
+
+  return MapScore(entry, tbFile, DecompressPairs(d, idx), wdl);
+}
+
+template<TBType Type, typename Ret = typename TBTable<Type>::Ret>
+Ret ProbeTable(const Board &board, int color, ProbeState *result, WDLScore wdl = WDL_DRAW) {
+  if (board.CountPieces() == 2) { // KvK
+    return Ret(WDL_DRAW);
+  }
+
+  TBTable<Type> *entry;
+  if constexpr (Type == WDL) {
+    entry = tbTables.GetWDL(MaterialKey(board));
+  } else {
+    entry = tbTables.GetDTZ(MaterialKey(board));
+  }
+
+  if (!entry || !entry->baseAddress) {
+    *result = PROBE_FAIL;
+    return Ret();
+  }
+
+  return DoProbeTable(board, color, entry, wdl, result);
+}
+
+inline bool IsZeroing(const Board &board, Move move) {
+  return board.IsCapture(move) || board.GetPieceAt(move.fromSquare).pieceType == PAWN;
+}
+
+// A winning capture makes the stored value of a position a "don't care", and a
+// drawing capture means it is at least a draw, so the captures are searched and
+// the best of them and the stored value is the real result. DTZ does not store
+// values when the best move zeroes the counter (or is en passant), which is
+// reported as PROBE_ZEROING_BEST_MOVE.
+template<bool CheckZeroingMoves = false>
+WDLScore Search(Board &board, int color, ProbeState *result) {
+  WDLScore value, bestValue = WDL_LOSS;
+
+  MoveList moveList;
+  board.GenerateLegalMoves(color, moveList);
+  int moveCount = 0;
+
+  for (Move move : moveList) {
+    if (!board.IsCapture(move)
+        && (!CheckZeroingMoves || board.GetPieceAt(move.fromSquare).pieceType != PAWN)) {
+      continue;
+    }
+
+    moveCount++;
+
+    Board child = board;
+    child.MakeMove(move, color);
+    value = WDLScore(-Search(child, !color, result));
+
+    if (*result == PROBE_FAIL) {
+      return WDL_DRAW;
+    }
+
+    if (value > bestValue) {
+      bestValue = value;
+
+      if (value >= WDL_WIN) {
+        *result = PROBE_ZEROING_BEST_MOVE; // Winning zeroing move
+        return value;
+      }
+    }
+  }
+
+  // With every legal move searched the stored value is not needed (and could
+  // be wrong, tables know nothing about en passant rights)
+  bool noMoreMoves = (moveCount && moveCount == moveList.Size());
+
+  if (noMoreMoves) {
+    value = bestValue;
+  } else {
+    value = ProbeTable<WDL>(board, color, result);
+
+    if (*result == PROBE_FAIL) {
+      return WDL_DRAW;
+    }
+  }
+
+  // DTZ stores a "don't care" value if bestValue is a win
+  if (bestValue >= value) {
+    *result = (bestValue > WDL_DRAW || noMoreMoves) ? PROBE_ZEROING_BEST_MOVE : PROBE_OK;
+    return bestValue;
+  }
+
+  *result = PROBE_OK;
+  return value;
+}
+
+void InitIndexTables() {
+  // MapB1H1H7[] encodes a square below the a1-h8 diagonal to 0..27
+  int code = 0;
+  for (int square = 0; square < 64; ++square) {
+    if (OffA1H8(square) < 0) {
+      MapB1H1H7[square] = code++;
+    }
+  }
+
+  // MapA1D1D4[] encodes a square in the a1-d1-d4 triangle to 0..9, diagonal last
+  std::vector<int> diagonal;
+  code = 0;
+  for (int square = 0; square <= 27; ++square) {
+    if (OffA1H8(square) < 0 && FileOf(square) <= 3) {
+      MapA1D1D4[square] = code++;
+    } else if (!OffA1H8(square) && FileOf(square) <= 3) {
+      diagonal.push_back(square);
+    }
+  }
+
+  for (int square : diagonal) {
+    MapA1D1D4[square] = code++;
+  }
+
+  // MapKK[] encodes the 462 legal placements of two kings with the first in the
+  // a1-d1-d4 triangle. With the first on the diagonal, the second is not above it.
+  std::vector<std::pair<int, int>> bothOnDiagonal;
+  code = 0;
+  for (int idx = 0; idx < 10; ++idx) {
+    for (int s1 = 0; s1 <= 27; ++s1) {
+      if (MapA1D1D4[s1] == idx && (idx || s1 == 1)) { // b1 is mapped to 0
+        Bitboard adjacent;
+        adjacent.KingMoves(s1);
+        adjacent.SetBit(s1);
+
+        for (int s2 = 0; s2 < 64; ++s2) {
+          if (adjacent.IsSet(s2)) {
+            continue; // Illegal position
+          } else if (!OffA1H8(s1) && OffA1H8(s2) > 0) {
+            continue; // First on the diagonal, second above it
+          } else if (!OffA1H8(s1) && !OffA1H8(s2)) {
+            bothOnDiagonal.emplace_back(idx, s2);
+          } else {
+            MapKK[idx][s2] = code++;
+          }
+        }
+      }
+    }
+  }
+
+  for (const auto &p : bothOnDiagonal) {
+    MapKK[p.first][p.second] = code++;
+  }
+
+  // Binomial[k][n] ways to choose k elements from a set of n, by Pascal's rule
+  Binomial[0][0] = 1;
+
+  for (int n = 1; n < 64; ++n) {
+    for (int k = 0; k < 6 && k <= n; ++k) {
+      Binomial[k][n] = (k > 0 ? Binomial[k - 1][n - 1] : 0)
+                     + (k < n ? Binomial[k][n - 1] : 0);
+    }
+  }
+
+  // MapPawns[] encodes a2-h7 to 0..47, the number of squares left for the other
+  // pawns when the leading one is there. The leading pawn has the highest value.
+  int availableSquares = 47;
+
+  for (int leadPawnsCount = 1; leadPawnsCount <= 5; ++leadPawnsCount) {
+    for (int file = 0; file <= 3; ++file) {
+      // Tables are split by file, so the index restarts at every file
+      int idx = 0;
+
+      for (int rank = 1; rank <= 6; ++rank) {
+        int square = rank * 8 + file;
+
+        if (leadPawnsCount == 1) {
+          MapPawns[square] = availableSquares--;
+          MapPawns[square ^ 7] = availableSquares--; // Mirrored file
+        }
+        LeadPawnIdx[leadPawnsCount][square] = idx;
+        idx += Binomial[leadPawnsCount - 1][MapPawns[square]];
+      }
+      LeadPawnsSize[leadPawnsCount][file] = idx;
+    }
+  }
+}
+
+}
+
+void Init(const std::string &paths) {
+  tbTables.Clear();
+  maxCardinality = 0;
+  tablebasePaths = paths;
+
+  if (paths.empty() || paths == "<empty>") {
+    return;
+  }
+
+  InitIndexTables();
+
+  // Every material combination of up to 7 pieces, stronger side first
+  for (int p1 = PAWN; p1 < KING; ++p1) {
+    tbTables.Add({KING, p1, KING});
+
+    for (int p2 = PAWN; p2 <= p1; ++p2) {
+      tbTables.Add({KING, p1, p2, KING});
+      tbTables.Add({KING, p1, KING, p2});
+
+      for (int p3 = PAWN; p3 < KING; ++p3) {
+        tbTables.Add({KING, p1, p2, KING, p3});
+      }
+
+      for (int p3 = PAWN; p3 <= p2; ++p3) {
+        tbTables.Add({KING, p1, p2, p3, KING});
+
+        for (int p4 = PAWN; p4 <= p3; ++p4) {
+          tbTables.Add({KING, p1, p2, p3, p4, KING});
+
+          for (int p5 = PAWN; p5 <= p4; ++p5) {
+            tbTables.Add({KING, p1, p2, p3, p4, p5, KING});
+          }
+
+          for (int p5 = PAWN; p5 < KING; ++p5) {
+            tbTables.Add({KING, p1, p2, p3, p4, KING, p5});
+          }
+        }
+
+        for (int p4 = PAWN; p4 < KING; ++p4) {
+          tbTables.Add({KING, p1, p2, p3, KING, p4});
+
+          for (int p5 = PAWN; p5 <= p4; ++p5) {
+            tbTables.Add({KING, p1, p2, p3, KING, p4, p5});
+          }
+        }
+      }
+
+      for (int p3 = PAWN; p3 <= p1; ++p3) {
+        for (int p4 = PAWN; p4 <= (p1 == p3 ? p2 : p3); ++p4) {
+          tbTables.Add({KING, p1, p2, KING, p3, p4});
+        }
+      }
+    }
+  }
+
+  std::cout << "info string Found " << tbTables.Count() << " tablebases" << std::endl;
+}
+
+int MaxCardinality() {
+  return maxCardinality;
+}
+
+WDLScore ProbeWDL(Board &board, int color, ProbeState *result) {
+  *result = PROBE_OK;
+  return Search(board, color, result);
+}
+
+// The result can be off by one ply: -n can mean a loss in n + 1 plies and n a
+// win in n + 1 plies. A win is certain when dtz + 50-move counter <= 99.
+int ProbeDTZ(Board &board, int color, ProbeState *result) {
+  *result = PROBE_OK;
+  WDLScore wdl = Search<true>(board, color, result);
+
+  if (*result == PROBE_FAIL || wdl == WDL_DRAW) { // DTZ tables don't store draws
+    return 0;
+  }
+
+  if (*result == PROBE_ZEROING_BEST_MOVE) {
+    return DTZBeforeZeroing(wdl);
+  }
+
+  int dtz = ProbeTable<DTZ>(board, color, result, wdl);
+
+  if (*result == PROBE_FAIL) {
+    return 0;
+  }
+
+  if (*result != PROBE_CHANGE_STM) {
+    return (dtz + 100 * (wdl == WDL_BLESSED_LOSS || wdl == WDL_CURSED_WIN)) * SignOf(wdl);
+  }
+
+  // The table stores the other side to move: take the best DTZ over the moves
+  int minDTZ = 0xFFFF;
+
+  MoveList moveList;
+  board.GenerateLegalMoves(color, moveList);
+  for (Move move : moveList) {
+    bool zeroing = IsZeroing(board, move);
+
+    Board child = board;
+    child.MakeMove(move, color);
+
+    // For zeroing moves we want the DTZ before the move, the sign comes from the WDL after it
+    dtz = zeroing ? -DTZBeforeZeroing(Search(child, !color, result))
+                  : -ProbeDTZ(child, !color, result);
+
+    // A mating move gets DTZ 1
+    if (dtz == 1 && child.IsInCheck(!color)) {
+      MoveList replies;
+      child.GenerateLegalMoves(!color, replies);
+      if (replies.IsEmpty()) {
+        minDTZ = 1;
+      }
+    }
+
+    if (!zeroing) {
+      dtz += SignOf(dtz);
+    }
+
+    // Skip draws, and only take positive values when winning
+    if (dtz < minDTZ && SignOf(dtz) == SignOf(wdl)) {
+      minDTZ = dtz;
+    }
+
+    if (*result == PROBE_FAIL) {
+      return 0;
+    }
+  }
+
+  // No legal moves: mated
+  return minDTZ == 0xFFFF ? -1 : minDTZ;
+}
+
+bool RootProbe(Board &board, int color, MoveList &rootMoves) {
+  if (board.CountPieces() > maxCardinality || board.HasCastlingRights()) {
+    return false;
+  }
+
+  ProbeState result;
+  int ranks[MAX_MOVES];
+  int bestRank = -1000;
+  int halfmoveClock = board.GetHalfmoveClock();
+
+  for (int i = 0; i < rootMoves.Size(); ++i) {
+    Move move = rootMoves[i];
+
+    Board child = board;
+    child.MakeMove(move, color);
+
+    int dtz;
+    if (child.GetHalfmoveClock() == 0) {
+      dtz = DTZBeforeZeroing(WDLScore(-ProbeWDL(child, !color, &result)));
+    } else {
+      // DTZ of the new position, one ply further from the root
+      dtz = -ProbeDTZ(child, !color, &result);
+      dtz = dtz > 0 ? dtz + 1 : dtz < 0 ? dtz - 1 : dtz;
+    }
+
+    // A mating move gets DTZ 1
+    if (dtz == 2 && child.IsInCheck(!color)) {
+      MoveList replies;
+      child.GenerateLegalMoves(!color, replies);
+      if (replies.IsEmpty()) {
+        dtz = 1;
+      }
+    }
+
+    if (result == PROBE_FAIL) {
+      return false;
+    }
+
+    // Certain wins rank equally, losses too unless a 50-move draw is in sight
+    ranks[i] = dtz > 0 ? (dtz + halfmoveClock <= 99 ? 1000 : 1000 - (dtz + halfmoveClock))
+             : dtz < 0 ? (-dtz * 2 + halfmoveClock < 100 ? -1000 : -1000 + (-dtz + halfmoveClock))
+             : 0;
+    bestRank = std::max(bestRank, ranks[i]);
+  }
+
+  // Keep the moves that preserve the best result
+  MoveList kept;
+  for (int i = 0; i < rootMoves.Size(); ++i) {
+    if (ranks[i] == bestRank) {
+      kept.Add(rootMoves[i]);
+    }
+  }
+  rootMoves = kept;
+
+  return true;
+}
+
+int ScoreFromWDL(WDLScore wdl) {
+  switch (wdl) {
+    case WDL_LOSS: return -TB_WIN_SCORE;
+    case WDL_BLESSED_LOSS: return -2;
+    case WDL_CURSED_WIN: return 2;
+    case WDL_WIN: return TB_WIN_SCORE;
+    default: return 0;
+  }
+}
+
+}
@@ -0,0 +1,55 @@
+#ifndef NP_SYZYGY_HPP
+#define NP_SYZYGY_HPP
+
+#include <string>
+
+#include "Board.hpp"
+
+// Score of a tablebase win, well inside the +-9999 bounds of the search
+#define TB_WIN_SCORE 5000
+
+// Syzygy WDL/DTZ tablebase probing.
+//
+// Init() maps every table found on the search path up front, so probing only
+// reads shared, read-only memory: it is safe to call from any number of search
+// threads at once and never allocates. Init() itself must not run during a search.
+namespace Syzygy {
+
+enum WDLScore {
+  WDL_LOSS = -2,         // Loss
+  WDL_BLESSED_LOSS = -1, // Loss, but draw under the 50-move rule
+  WDL_DRAW = 0,          // Draw
+  WDL_CURSED_WIN = 1,    // Win, but draw under the 50-move rule
+  WDL_WIN = 2            // Win
+};
+
+enum ProbeState {
+  PROBE_FAIL = 0,              // Probe failed (missing file or table)
+  PROBE_OK = 1,                // Probe successful
+  PROBE_CHANGE_STM = -1,       // DTZ should check the other side
+  PROBE_ZEROING_BEST_MOVE = 2  // Best move zeroes the 50-move counter
+};
+
+// Paths are separated by ':' (';' on Windows). An empty path or "<empty>" disables probing.
+void Init(const std::string &paths);
+
+// Largest number of pieces (kings included) of any table found, 0 when disabled
+int MaxCardinality();
+
+// WDL value of the position for the side to move (color)
+WDLScore ProbeWDL(Board &board, int color, ProbeState *result);
+
+// Distance to zeroing the 50-move counter, in plies, for the side to move (color).
+// Positive when winning, negative when losing, 0 for draws.
+int ProbeDTZ(Board &board, int color, ProbeState *result);
+
+// Keeps only the root moves that preserve the best tablebase result, ranked by DTZ.
+// Returns false (and leaves rootMoves untouched) if the position could not be probed.
+bool RootProbe(Board &board, int color, MoveList &rootMoves);
+
+// Search score for a WDL value, from the point of view of the side to move
+int ScoreFromWDL(WDLScore wdl);
+
+}
+
+#endif // NP_SYZYGY_HPP
@@ -0,0 +1,159 @@
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// How often the writer empties the buffers
+#define TRACE_FLUSH_MILLISECONDS 2
+
+struct TraceFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t eventBytes;
+};
+
+struct TraceChunkHeader {
+  uint32_t thread;
+  uint32_t events;
+  uint64_t dropped;
+};
+
+static const char traceMagic[8] = {'N', 'P', 'T', 'R', 'A', 'C', 'E', '\0'};
+
+const char *TraceKindName(TraceKind kind) {
+  switch (kind) {
+    case TRACE_ITERATION: return "iteration";
+    case TRACE_NODE: return "node";
+    case TRACE_QUIESCENCE: return "quiescence";
+    case TRACE_FAIL_HIGH: return "fail high";
+    case TRACE_FAIL_LOW: return "fail low";
+    case TRACE_EXACT: return "exact";
+    case TRACE_TABLE_CUTOFF: return "table cutoff";
+    case TRACE_TABLEBASE: return "tablebase";
+    case TRACE_NULL_MOVE_CUTOFF: return "null move cutoff";
+    case TRACE_REVERSE_FUTILITY: return "reverse futility";
+    case TRACE_STAND_PAT: return "stand pat";
+    case TRACE_DRAW: return "draw";
+    case TRACE_NO_MOVES: return "no moves";
+    case TRACE_MAX_PLY: return "max ply";
+    case TRACE_STOPPED: return "stopped";
+    case TRACE_KIND_COUNT: break;
+  }
+  return "unknown";
+}
+
+TraceWriter::~TraceWriter() {
+  Close();
+}
+
+bool TraceWriter::Open(const std::string &path) {
+  Close();
+
+  file = std::fopen(path.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+  TraceFileHeader header{};
+  std::memcpy(header.magic, traceMagic, sizeof(header.magic));
+  header.version = TRACE_VERSION;
+  header.eventBytes = sizeof(TraceEvent);
+  std::fwrite(&header, sizeof(header), 1, file);
+
+  stopping = false;
+  written = 0;
+  droppedTotal = 0;
+  flusher = std::thread(&TraceWriter::Run, this);
+  return true;
+}
+
+void TraceWriter::Close() {
+  if (!file) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+  flusher.join();
+
+  // The threads are done recording, whatever is left goes out now
+  for (auto &buffer : buffers) {
+    Drain(*buffer);
+  }
+  buffers.clear();
+  std::fclose(file);
+  file = nullptr;
+}
+
+TraceBuffer *TraceWriter::AddThread() {
+  std::lock_guard<std::mutex> lock(mutex);
+  buffers.emplace_back(new TraceBuffer(static_cast<uint32_t>(buffers.size())));
+  return buffers.back().get();
+}
+
+void TraceWriter::Run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopping) {
+    for (auto &buffer : buffers) {
+      Drain(*buffer);
+    }
+    wake.wait_for(lock, std::chrono::milliseconds(TRACE_FLUSH_MILLISECONDS));
+  }
+}
+
+void TraceWriter::Drain(TraceBuffer &buffer) {
+  uint64_t head = buffer.head.load(std::memory_order_acquire);
+  uint64_t tail = buffer.tail.load(std::memory_order_relaxed);
+  uint64_t dropped = buffer.dropped.load(std::memory_order_relaxed);
+  if (head == tail && dropped == buffer.droppedWritten) {
+    return;
+  }
+
+  TraceChunkHeader chunk{buffer.thread, static_cast<uint32_t>(head - tail), dropped - buffer.droppedWritten};
+  std::fwrite(&chunk, sizeof(chunk), 1, file);
+
+  // The events may wrap around the end of the ring
+  uint64_t start = tail & (TRACE_BUFFER_EVENTS - 1);
+  uint64_t first = std::min<uint64_t>(head - tail, TRACE_BUFFER_EVENTS - start);
+  std::fwrite(buffer.events.get() + start, sizeof(TraceEvent), first, file);
+  std::fwrite(buffer.events.get(), sizeof(TraceEvent), head - tail - first, file);
+
+  buffer.tail.store(head, std::memory_order_release);
+  written += head - tail;
+  droppedTotal += dropped - buffer.droppedWritten;
+  buffer.droppedWritten = dropped;
+}
+
+bool ReadTrace(const std::string &path, const std::function<void(uint32_t thread, const TraceEvent &event)> &visit,
+               uint64_t &dropped) {
+  FILE *file = std::fopen(path.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+
+  TraceFileHeader header;
+  if (std::fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic, traceMagic, sizeof(header.magic)) != 0
+      || header.version != TRACE_VERSION || header.eventBytes != sizeof(TraceEvent)) {
+    std::fclose(file);
+    return false;
+  }
+
+  std::vector<TraceEvent> events;
+  TraceChunkHeader chunk;
+  while (std::fread(&chunk, sizeof(chunk), 1, file) == 1) {
+    events.resize(chunk.events);
+    if (std::fread(events.data(), sizeof(TraceEvent), chunk.events, file) != chunk.events) {
+      break;
+    }
+    dropped += chunk.dropped;
+    for (const TraceEvent &event : events) {
+      visit(chunk.thread, event);
+    }
+  }
+
+  std::fclose(file);
+  return true;
+}
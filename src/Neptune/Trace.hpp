@@ -0,0 +1,167 @@
+#ifndef NP_TRACE_HPP
+#define NP_TRACE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Move.hpp"
+
+// Search tree tracing. Off unless built with NP_TRACE=1, and then only while a
+// Searcher has a buffer; built without it the calls in the search are removed.
+#ifndef NP_TRACE
+#define NP_TRACE 0
+#endif
+
+// Events a thread can hold before the writer catches up, a power of two.
+// Events that don't fit are dropped and counted, the search never waits.
+#define TRACE_BUFFER_EVENTS (1 << 20)
+
+#define TRACE_VERSION 1
+
+enum TraceKind : uint8_t {
+  // Nodes, with the move that led to them and the window they got
+  TRACE_ITERATION,   // the root at the start of an iteration (one per multipv line)
+  TRACE_NODE,        // a node of the main search
+  TRACE_QUIESCENCE,  // a quiescence node
+
+  // How a node ended, with its score
+  TRACE_FAIL_HIGH,          // a move reached beta
+  TRACE_FAIL_LOW,           // no move raised alpha
+  TRACE_EXACT,              // within the window
+  TRACE_TABLE_CUTOFF,       // settled by the transposition table
+  TRACE_TABLEBASE,          // settled by the tablebases
+  TRACE_NULL_MOVE_CUTOFF,   // passing still failed high
+  TRACE_REVERSE_FUTILITY,   // static evaluation far enough above beta
+  TRACE_STAND_PAT,          // quiescence static evaluation at or above beta
+  TRACE_DRAW,               // 50-move rule or repetition
+  TRACE_NO_MOVES,           // checkmate or stalemate
+  TRACE_MAX_PLY,            // too deep, evaluated
+  TRACE_STOPPED,            // limits ran out, the score means nothing
+
+  TRACE_KIND_COUNT
+};
+
+const char *TraceKindName(TraceKind kind);
+
+// One event, 12 bytes in memory and on disk. Fields an event has no use for are 0.
+struct TraceEvent {
+  uint8_t kind;
+  uint8_t ply;
+  int8_t depth;
+  uint8_t reserved;
+  uint16_t move;  // from | to << 6 | (promotion + 1) << 12, 0 for none or a null move
+  int16_t alpha;
+  int16_t beta;
+  int16_t score;
+};
+
+static_assert(sizeof(TraceEvent) == 12, "TraceEvent records are 12 bytes on disk");
+
+inline uint16_t PackTraceMove(Move move) {
+  return static_cast<uint16_t>(move.fromSquare | move.toSquare << 6 | (move.promotionPiece + 1) << 12);
+}
+
+inline Move UnpackTraceMove(uint16_t bits) {
+  Move move(bits & 63, bits >> 6 & 63);
+  move.promotionPiece = (bits >> 12 & 7) - 1;
+  return move;
+}
+
+// The events of one searching thread. Only that thread records and only the
+// writer takes events out, so the ring needs no lock.
+class TraceBuffer {
+public:
+  inline void Record(TraceKind kind, int ply, int depth, Move move, int alpha, int beta, int score) {
+    uint64_t position = head.load(std::memory_order_relaxed);
+    if (position - knownTail == TRACE_BUFFER_EVENTS) {
+      knownTail = tail.load(std::memory_order_acquire);
+      if (position - knownTail == TRACE_BUFFER_EVENTS) {
+        dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+      }
+    }
+    events[position & (TRACE_BUFFER_EVENTS - 1)] = {kind, static_cast<uint8_t>(ply), static_cast<int8_t>(depth), 0,
+                                                     PackTraceMove(move), static_cast<int16_t>(alpha),
+                                                     static_cast<int16_t>(beta), static_cast<int16_t>(score)};
+    head.store(position + 1, std::memory_order_release);
+  }
+
+private:
+  friend class TraceWriter;
+  explicit TraceBuffer(uint32_t thread) : events(new TraceEvent[TRACE_BUFFER_EVENTS]), thread(thread) {}
+
+  std::unique_ptr<TraceEvent[]> events;
+  uint32_t thread;
+
+  // The recording thread's side
+  alignas(64) std::atomic<uint64_t> head{0};
+  uint64_t knownTail = 0;
+  std::atomic<uint64_t> dropped{0};
+
+  // The writer's side
+  alignas(64) std::atomic<uint64_t> tail{0};
+  uint64_t droppedWritten = 0;
+};
+
+// Writes the events of every buffer to one file from a thread of its own.
+// The file is a header, then chunks: thread, event count and events the
+// thread dropped since its last chunk, followed by the events.
+class TraceWriter {
+public:
+  TraceWriter() = default;
+  ~TraceWriter();
+
+  TraceWriter(const TraceWriter &) = delete;
+  TraceWriter &operator=(const TraceWriter &) = delete;
+
+  // Starts a new trace, closing the one before. False if the file can't be created.
+  bool Open(const std::string &path);
+  // Writes out the events recorded so far and closes the file. The buffers
+  // must no longer be recording.
+  void Close();
+  bool IsOpen() const {
+    return file != nullptr;
+  }
+
+  // A buffer for one more thread, valid until Close
+  TraceBuffer *AddThread();
+
+  uint64_t EventsWritten() const {
+    return written;
+  }
+  uint64_t EventsDropped() const {
+    return droppedTotal;
+  }
+
+private:
+  void Run();
+  // Writes out what the buffer holds, under the lock
+  void Drain(TraceBuffer &buffer);
+
+private:
+  FILE *file = nullptr;
+  std::thread flusher;
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool stopping = false;
+  std::vector<std::unique_ptr<TraceBuffer>> buffers;
+
+  std::atomic<uint64_t> written{0};
+  std::atomic<uint64_t> droppedTotal{0};
+};
+
+// Calls visit for every event of a trace file, in the order each thread
+// recorded them, and adds up the dropped events. False if the file can't be
+// read or isn't a trace; a file cut short ends at its last whole chunk.
+bool ReadTrace(const std::string &path, const std::function<void(uint32_t thread, const TraceEvent &event)> &visit,
+               uint64_t &dropped);
+
+#endif // NP_TRACE_HPP
@@ -0,0 +1,534 @@
+#include "TranspositionTable.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+// Data layout: move (16 bits) | score (16) | depth (8) | bound (2) | generation (6)
+#define GENERATION_MASK 0x3F
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+// Tables smaller than this are cleared by a single thread
+#define CLEAR_BYTES_PER_THREAD (64 * 1024 * 1024)
+
+#define SNAPSHOT_MAGIC "NPTTSNAP"
+
+// Native byte order, a snapshot is for the machine that wrote it
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t slotBytes;
+  uint64_t slotCount;
+  uint64_t generation;
+  uint64_t dataChecksum;
+  uint64_t headerChecksum;  // of the fields before it
+};
+
+static_assert(sizeof(SnapshotHeader) <= SNAPSHOT_HEADER_BYTES, "The snapshot header fits its page");
+
+#define SHARED_MAGIC "NPTTSHM"
+// How long attaching waits for the process creating a shared table to set it up
+#define SHARED_SETUP_MILLISECONDS 2000
+
+struct SharedHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t slotBytes;
+  uint64_t slotCount;
+  uint32_t ready;     // set by the creator once the fields above are filled in
+  uint32_t attached;  // processes using the table
+};
+
+static_assert(sizeof(SharedHeader) <= SHARED_HEADER_BYTES, "The shared table header fits its page");
+
+// FNV-1a over 64-bit words
+static uint64_t Checksum(const void *data, size_t bytes) {
+  const uint64_t *words = static_cast<const uint64_t *>(data);
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < bytes / 8; ++i) {
+    hash = (hash ^ words[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+static bool IsValidHeader(const SnapshotHeader &header, size_t fileBytes, size_t slotBytes) {
+  return std::memcmp(header.magic, SNAPSHOT_MAGIC, 8) == 0
+         && header.version == SNAPSHOT_VERSION
+         && header.slotBytes == slotBytes
+         && header.slotCount && (header.slotCount & (header.slotCount - 1)) == 0
+         && fileBytes == SNAPSHOT_HEADER_BYTES + header.slotCount * slotBytes
+         && header.headerChecksum == Checksum(&header, offsetof(SnapshotHeader, headerChecksum));
+}
+
+static uint64_t PackMove(Move move) {
+  return move.fromSquare | move.toSquare << 6 | (move.promotionPiece + 1) << 12;
+}
+
+static Move UnpackMove(uint64_t bits) {
+  Move move(bits & 63, bits >> 6 & 63);
+  move.promotionPiece = static_cast<int>(bits >> 12 & 7) - 1;
+  return move;
+}
+
+static inline uint64_t Load(uint64_t &word) {
+  return std::atomic_ref<uint64_t>(word).load(std::memory_order_relaxed);
+}
+
+static inline void Save(uint64_t &word, uint64_t value) {
+  std::atomic_ref<uint64_t>(word).store(value, std::memory_order_relaxed);
+}
+
+const char *PageTypeName(PageType type) {
+  switch (type) {
+    case HUGE_PAGES: return "huge pages";
+    case TRANSPARENT_HUGE_PAGES: return "transparent huge pages";
+    case SMALL_PAGES: return "small pages";
+  }
+  return "";
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes, bool largePages) {
+  if (!Resize(megabytes, largePages)) {
+    Resize(1, false);
+  }
+}
+
+TranspositionTable::~TranspositionTable() {
+  Free();
+}
+
+// Largest power of two that fits, so the index is a mask of the key
+static size_t SlotCount(size_t megabytes, size_t slotBytes) {
+  size_t count = 1;
+  while (count * 2 * slotBytes <= megabytes * 1024 * 1024) {
+    count *= 2;
+  }
+  return count;
+}
+
+bool TranspositionTable::Resize(size_t megabytes, bool largePages) {
+  size_t count = SlotCount(megabytes, sizeof(Slot));
+  size_t bytes = count * sizeof(Slot);
+
+  void *block = nullptr;
+  bool memoryMapped = false;
+  PageType type = SMALL_PAGES;
+
+#ifdef __linux__
+  // Reserved huge pages first, then ordinary pages the kernel may merge into
+  // huge ones. Without largePages they are kept small, for comparison.
+  if (largePages && bytes >= HUGE_PAGE_SIZE) {
+    block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    type = HUGE_PAGES;
+  }
+  if (!block || block == MAP_FAILED) {
+    block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    type = SMALL_PAGES;
+    if (block != MAP_FAILED && bytes >= HUGE_PAGE_SIZE) {
+      if (largePages && madvise(block, bytes, MADV_HUGEPAGE) == 0) {
+        type = TRANSPARENT_HUGE_PAGES;
+      } else if (!largePages) {
+        madvise(block, bytes, MADV_NOHUGEPAGE);
+      }
+    }
+  }
+  if (block == MAP_FAILED) {
+    return false;
+  }
+  memoryMapped = true;
+#else
+  (void)largePages;
+  block = ::operator new(bytes, std::align_val_t(64), std::nothrow);
+  if (!block) {
+    return false;
+  }
+#endif
+
+  Free();
+  memory = block;
+  slots = static_cast<Slot *>(block);
+  mask = count - 1;
+  allocatedBytes = bytes;
+  mapped = memoryMapped;
+  pageType = type;
+  Clear();
+  return true;
+}
+
+void TranspositionTable::Free() {
+  if (!memory) {
+    return;
+  }
+#ifndef _WIN32
+  if (shared) {
+    // The last process out removes the name, the memory goes with the last
+    // mapping. No process joins a segment once it is down to 0, but the name
+    // may already stand for a newer one, which is left alone.
+    if (std::atomic_ref<uint32_t>(static_cast<SharedHeader *>(memory)->attached).fetch_sub(1) == 1) {
+      int fd = shm_open(sharedName.c_str(), O_RDONLY, 0);
+      if (fd != -1) {
+        struct stat info;
+        if (fstat(fd, &info) == 0 && static_cast<uint64_t>(info.st_dev) == sharedDevice
+            && static_cast<uint64_t>(info.st_ino) == sharedInode) {
+          shm_unlink(sharedName.c_str());
+        }
+        ::close(fd);
+      }
+    }
+    shared = false;
+  }
+  if (mapped) {
+    munmap(memory, allocatedBytes);
+  } else {
+    ::operator delete(memory, std::align_val_t(64));
+  }
+#else
+  ::operator delete(memory, std::align_val_t(64));
+#endif
+  memory = nullptr;
+  slots = nullptr;
+}
+
+bool TranspositionTable::SaveSnapshot(const std::string &path) const {
+  SnapshotHeader header{};
+  std::memcpy(header.magic, SNAPSHOT_MAGIC, 8);
+  header.version = SNAPSHOT_VERSION;
+  header.slotBytes = sizeof(Slot);
+  header.slotCount = mask + 1;
+  header.generation = generation;
+  header.dataChecksum = Checksum(slots, SizeInBytes());
+  header.headerChecksum = Checksum(&header, offsetof(SnapshotHeader, headerChecksum));
+
+  std::string temporary = path + ".tmp";
+  FILE *file = std::fopen(temporary.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+  char page[SNAPSHOT_HEADER_BYTES] = {};
+  std::memcpy(page, &header, sizeof(header));
+  bool written = std::fwrite(page, 1, sizeof(page), file) == sizeof(page)
+                 && std::fwrite(slots, 1, SizeInBytes(), file) == SizeInBytes();
+  written = std::fclose(file) == 0 && written;
+
+#ifdef _WIN32
+  std::remove(path.c_str());
+#endif
+  if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool TranspositionTable::LoadSnapshot(const std::string &path, bool verify) {
+  SnapshotHeader header;
+#ifndef _WIN32
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+  struct stat info;
+  fstat(fd, &info);
+  size_t fileBytes = info.st_size;
+  if (fileBytes < SNAPSHOT_HEADER_BYTES || pread(fd, &header, sizeof(header), 0) != sizeof(header)
+      || !IsValidHeader(header, fileBytes, sizeof(Slot))) {
+    ::close(fd);
+    return false;
+  }
+
+  // Private, so what the search stores stays in memory and the file as it was saved
+  void *block = mmap(nullptr, fileBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (block == MAP_FAILED) {
+    return false;
+  }
+  Slot *loaded = reinterpret_cast<Slot *>(static_cast<char *>(block) + SNAPSHOT_HEADER_BYTES);
+  if (verify && Checksum(loaded, header.slotCount * sizeof(Slot)) != header.dataChecksum) {
+    munmap(block, fileBytes);
+    return false;
+  }
+  // Probes go all over the table, reading ahead would only fetch slots nobody asked for
+  madvise(block, fileBytes, MADV_RANDOM);
+  bool memoryMapped = true;
+#else
+  // No mapping here, the slots are read in whole and always checked
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return false;
+  }
+  size_t fileBytes = file.tellg();
+  file.seekg(0);
+  if (fileBytes < SNAPSHOT_HEADER_BYTES || !file.read(reinterpret_cast<char *>(&header), sizeof(header))
+      || !IsValidHeader(header, fileBytes, sizeof(Slot))) {
+    return false;
+  }
+  size_t bytes = header.slotCount * sizeof(Slot);
+  void *block = ::operator new(bytes, std::align_val_t(64), std::nothrow);
+  if (!block) {
+    return false;
+  }
+  file.seekg(SNAPSHOT_HEADER_BYTES);
+  if (!file.read(static_cast<char *>(block), bytes) || Checksum(block, bytes) != header.dataChecksum) {
+    ::operator delete(block, std::align_val_t(64));
+    return false;
+  }
+  Slot *loaded = static_cast<Slot *>(block);
+  fileBytes = bytes;
+  bool memoryMapped = false;
+#endif
+
+  Free();
+  memory = block;
+  slots = loaded;
+  mask = header.slotCount - 1;
+  allocatedBytes = fileBytes;
+  mapped = memoryMapped;
+  pageType = SMALL_PAGES;
+  generation = header.generation & GENERATION_MASK;
+  return true;
+}
+
+bool TranspositionTable::AttachShared(const std::string &name, size_t megabytes) {
+#ifndef _WIN32
+  if (name.empty()) {
+    return false;
+  }
+  // Portable names are a single component starting with a slash
+  std::string path = name[0] == '/' ? name : "/" + name;
+  size_t count = SlotCount(megabytes, sizeof(Slot));
+  size_t bytes = SHARED_HEADER_BYTES + count * sizeof(Slot);
+  void *block = MAP_FAILED;
+
+  struct stat info;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(SHARED_SETUP_MILLISECONDS);
+  while (true) {
+    int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd != -1) {
+      // New segments come zeroed, which is an empty table
+      if (ftruncate(fd, bytes) == 0 && fstat(fd, &info) == 0) {
+        block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      }
+      ::close(fd);
+      if (block == MAP_FAILED) {
+        shm_unlink(path.c_str());
+        return false;
+      }
+      SharedHeader *header = static_cast<SharedHeader *>(block);
+      std::memcpy(header->magic, SHARED_MAGIC, 8);
+      header->version = SHARED_TABLE_VERSION;
+      header->slotBytes = sizeof(Slot);
+      header->slotCount = count;
+      header->attached = 1;
+      std::atomic_ref<uint32_t>(header->ready).store(1, std::memory_order_release);
+      break;
+    }
+    if (errno != EEXIST) {
+      return false;
+    }
+    // Removed again before it could be opened, try creating it once more
+    if ((fd = shm_open(path.c_str(), O_RDWR, 0)) == -1) {
+      if (errno != ENOENT || std::chrono::steady_clock::now() > deadline) {
+        return false;
+      }
+      continue;
+    }
+
+    // The creator may not have sized or set up the table yet
+    while (block == MAP_FAILED) {
+      if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= SHARED_HEADER_BYTES) {
+        bytes = info.st_size;
+        block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (block != MAP_FAILED
+            && !std::atomic_ref<uint32_t>(static_cast<SharedHeader *>(block)->ready).load(std::memory_order_acquire)) {
+          munmap(block, bytes);
+          block = MAP_FAILED;
+        }
+      }
+      if (block == MAP_FAILED) {
+        if (std::chrono::steady_clock::now() > deadline) {
+          ::close(fd);
+          return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+    ::close(fd);
+
+    SharedHeader *header = static_cast<SharedHeader *>(block);
+    count = header->slotCount;
+    if (std::memcmp(header->magic, SHARED_MAGIC, 8) != 0 || header->version != SHARED_TABLE_VERSION
+        || header->slotBytes != sizeof(Slot) || !count || (count & (count - 1)) != 0
+        || bytes != SHARED_HEADER_BYTES + count * sizeof(Slot)) {
+      munmap(block, bytes);
+      return false;
+    }
+
+    // A segment no process is attached to any more is being removed by the
+    // last one out. Joining it would leave this one on a table no one else
+    // finds, so wait for the name to go and create it anew.
+    std::atomic_ref<uint32_t> attached(header->attached);
+    uint32_t processes = attached.load();
+    while (processes && !attached.compare_exchange_weak(processes, processes + 1)) {
+    }
+    if (processes) {
+      break;
+    }
+    munmap(block, bytes);
+    block = MAP_FAILED;
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  Free();
+  memory = block;
+  slots = reinterpret_cast<Slot *>(static_cast<char *>(block) + SHARED_HEADER_BYTES);
+  mask = count - 1;
+  allocatedBytes = bytes;
+  mapped = true;
+  pageType = SMALL_PAGES;
+  shared = true;
+  sharedName = path;
+  sharedDevice = info.st_dev;
+  sharedInode = info.st_ino;
+  generation = 0;
+  return true;
+#else
+  (void)name;
+  (void)megabytes;
+  return false;
+#endif
+}
+
+int TranspositionTable::AttachedProcesses() const {
+  if (!shared) {
+    return 0;
+  }
+  return std::atomic_ref<uint32_t>(static_cast<SharedHeader *>(memory)->attached).load();
+}
+
+void TranspositionTable::Clear() {
+  if (!slots) {
+    return;
+  }
+  size_t bytes = SizeInBytes();
+  size_t threadCount = std::clamp<size_t>(bytes / CLEAR_BYTES_PER_THREAD, 1, std::max(1u, std::thread::hardware_concurrency()));
+
+  // Each thread also touches its part first, so the pages get mapped in parallel too
+  auto clearRange = [this, threadCount, bytes](size_t thread) {
+    size_t begin = bytes * thread / threadCount;
+    size_t end = bytes * (thread + 1) / threadCount;
+    std::memset(reinterpret_cast<char *>(slots) + begin, 0, end - begin);
+  };
+
+  if (threadCount == 1) {
+    clearRange(0);
+  } else {
+    std::vector<std::thread> threads;
+    for (size_t thread = 0; thread < threadCount; ++thread) {
+      threads.emplace_back(clearRange, thread);
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+  }
+  generation = 0;
+}
+
+void TranspositionTable::NewSearch() {
+  generation = (generation + 1) & GENERATION_MASK;
+}
+
+bool TranspositionTable::Probe(uint64_t key, TableEntry &entry) const {
+  Slot &slot = slots[key & mask];
+  uint64_t data = Load(slot.data);
+  if ((Load(slot.check) ^ data) != key || !data) {
+    return false;
+  }
+
+  entry.move = UnpackMove(data & 0xFFFF);
+  entry.score = static_cast<int16_t>(data >> 16);
+  entry.depth = static_cast<int8_t>(data >> 32);
+  entry.bound = static_cast<Bound>(data >> 40 & 3);
+  return true;
+}
+
+// Returns the data written, 0 when the slot is kept
+inline uint64_t TranspositionTable::Write(uint64_t key, Move move, int score, int depth, Bound bound) {
+  Slot &slot = slots[key & mask];
+  uint64_t oldData = Load(slot.data);
+  bool sameKey = (Load(slot.check) ^ oldData) == key;
+
+  // Keep deeper results of this search for other positions
+  if (!sameKey && oldData && (oldData >> 42 & GENERATION_MASK) == generation
+      && static_cast<int8_t>(oldData >> 32) > depth && bound != BOUND_EXACT) {
+    return 0;
+  }
+  // Don't lose the best move of a position to a result without one
+  if (sameKey && move.fromSquare == move.toSquare) {
+    move = UnpackMove(oldData & 0xFFFF);
+  }
+
+  uint64_t data = PackMove(move)
+                  | static_cast<uint64_t>(static_cast<uint16_t>(score)) << 16
+                  | static_cast<uint64_t>(static_cast<uint8_t>(depth)) << 32
+                  | static_cast<uint64_t>(bound) << 40
+                  | static_cast<uint64_t>(generation) << 42;
+  Save(slot.check, key ^ data);
+  Save(slot.data, data);
+  return data;
+}
+
+void TranspositionTable::Store(uint64_t key, Move move, int score, int depth, Bound bound) {
+  uint64_t data = Write(key, move, score, depth, bound);
+
+  if (exportDepth && depth >= exportDepth && data) {
+    std::lock_guard<std::mutex> lock(exportMutex);
+    if (exported.size() < MAX_EXPORTED_ENTRIES) {
+      exported.push_back({key, data});
+    }
+  }
+}
+
+void TranspositionTable::TakeExported(std::vector<ExportedEntry> &entries) {
+  entries.clear();
+  std::lock_guard<std::mutex> lock(exportMutex);
+  std::swap(entries, exported);
+}
+
+void TranspositionTable::Import(const ExportedEntry &entry) {
+  TableEntry known;
+  int depth = static_cast<int8_t>(entry.data >> 32);
+  if (Probe(entry.key, known) && known.depth >= depth) {
+    return;
+  }
+  Write(entry.key, UnpackMove(entry.data & 0xFFFF), static_cast<int16_t>(entry.data >> 16), depth,
+        static_cast<Bound>(entry.data >> 40 & 3));
+}
+
+
+int TranspositionTable::Hashfull() const {
+  int used = 0;
+  for (uint64_t i = 0; i < 1000 && i <= mask; ++i) {
+    uint64_t data = Load(slots[i].data);
+    used += data && (data >> 42 & GENERATION_MASK) == generation;
+  }
+  return used;
+}
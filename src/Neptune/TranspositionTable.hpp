@@ -0,0 +1,164 @@
+#ifndef NP_TRANSPOSITION_TABLE_HPP
+#define NP_TRANSPOSITION_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Move.hpp"
+
+#define DEFAULT_HASH_MB 16
+
+// Snapshot files: a header padded to a page, then the slots as they are in memory
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HEADER_BYTES 4096
+
+// Shared tables: a header page, then the slots
+#define SHARED_TABLE_VERSION 1
+#define SHARED_HEADER_BYTES 4096
+
+// Most stores kept for TakeExported between two calls, later ones are left out
+#define MAX_EXPORTED_ENTRIES 65536
+
+enum Bound {
+  BOUND_NONE,
+  BOUND_UPPER,  // the score is at most this (failed low)
+  BOUND_LOWER,  // the score is at least this (failed high)
+  BOUND_EXACT
+};
+
+struct TableEntry {
+  Move move;  // isCastle is not kept, compare with ==
+  int score;
+  int depth;
+  Bound bound;
+};
+
+// How the table's memory is backed, from best to worst for TLB misses
+enum PageType {
+  HUGE_PAGES,              // reserved 2 MB pages (MAP_HUGETLB)
+  TRANSPARENT_HUGE_PAGES,  // ordinary memory the kernel was asked to back with 2 MB pages
+  SMALL_PAGES
+};
+
+const char *PageTypeName(PageType type);
+
+// A slot as another table gets it: the key and the data packed as the table
+// keeps it, with the generation of the table it came from
+struct ExportedEntry {
+  uint64_t key;
+  uint64_t data;
+};
+
+// Hash table of search results, indexed by Zobrist key. Slots hold the key
+// XORed with the data next to the data itself, so a slot torn by two threads
+// writing at once fails the key check instead of returning a mix of both.
+// That makes the table safe to share between threads without locks.
+class TranspositionTable {
+public:
+  explicit TranspositionTable(size_t megabytes = DEFAULT_HASH_MB, bool largePages = true);
+  ~TranspositionTable();
+
+  TranspositionTable(const TranspositionTable &) = delete;
+  TranspositionTable &operator=(const TranspositionTable &) = delete;
+
+  // Drops everything stored. On Linux large tables go on 2 MB pages unless
+  // largePages is false. False, with the old table kept, if there isn't the memory.
+  bool Resize(size_t megabytes, bool largePages = true);
+  // Spread over several threads for large tables
+  void Clear();
+
+  // Writes the table to a snapshot file, through a temporary file that is
+  // renamed over the old one, so a snapshot being used is never overwritten
+  bool SaveSnapshot(const std::string &path) const;
+  // Replaces the table with a snapshot, taking its size. The file is mapped,
+  // not read, so slots come in from disk as the search first touches them and
+  // the file itself is never written. The header is always checked, the
+  // checksum of the slots only with verify, as that reads them all; a damaged
+  // slot fails its key check anyway. False, with the old table kept, if the
+  // file is missing, from another version or damaged.
+  bool LoadSnapshot(const std::string &path, bool verify = false);
+
+  // Replaces the table with the named POSIX shared memory segment, so every
+  // process attached to the name uses one table. The first process creates it
+  // with the size asked for, later ones take the size it has; the same key
+  // check that lets threads share slots covers processes too. The last process
+  // to detach, by Resize, LoadSnapshot or destruction, removes the segment.
+  // One that dies attached leaves it behind until it is removed by hand (from
+  // /dev/shm on Linux). False, with the old table kept, if the segment can't be
+  // created or holds a table of another version.
+  bool AttachShared(const std::string &name, size_t megabytes);
+  bool IsShared() const {
+    return shared;
+  }
+  // Processes attached to the shared table, 0 for a table of this process alone
+  int AttachedProcesses() const;
+
+  // Called before every search, so results of old searches get replaced first
+  void NewSearch();
+
+  bool Probe(uint64_t key, TableEntry &entry) const;
+  void Store(uint64_t key, Move move, int score, int depth, Bound bound);
+
+  // Stores at least this deep are also kept for TakeExported, 0 keeps none
+  void SetExportDepth(int depth) {
+    exportDepth = depth;
+  }
+  // Moves the stores kept since the last call into entries
+  void TakeExported(std::vector<ExportedEntry> &entries);
+  // Stores an entry of another table, unless this one knows the position at
+  // least as deep. Imports aren't exported again.
+  void Import(const ExportedEntry &entry);
+
+  // Starts loading the slot of a position that is about to be probed
+  inline void Prefetch(uint64_t key) const {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(&slots[key & mask]);
+#endif
+  }
+
+  // Permille of slots used by the current search, for UCI hashfull
+  int Hashfull() const;
+
+  size_t SizeInBytes() const {
+    return (mask + 1) * sizeof(Slot);
+  }
+  PageType GetPageType() const {
+    return pageType;
+  }
+
+private:
+  // Plain words, accessed through std::atomic_ref, so the table can live in
+  // memory that comes straight from mmap
+  struct Slot {
+    uint64_t check;  // key ^ data
+    uint64_t data;
+  };
+
+  void Free();
+  uint64_t Write(uint64_t key, Move move, int score, int depth, Bound bound);
+
+private:
+  Slot *slots = nullptr;
+  uint64_t mask = 0;
+  uint8_t generation = 0;
+
+  // Where slots live, a snapshot mapping or shared segment starts with its header
+  void *memory = nullptr;
+  size_t allocatedBytes = 0;
+  bool mapped = false;
+  PageType pageType = SMALL_PAGES;
+  bool shared = false;
+  std::string sharedName;
+  // Of the segment mapped, so detaching never removes a newer one of the same name
+  uint64_t sharedDevice = 0;
+  uint64_t sharedInode = 0;
+
+  int exportDepth = 0;
+  std::mutex exportMutex;
+  std::vector<ExportedEntry> exported;
+};
+
+#endif // NP_TRANSPOSITION_TABLE_HPP
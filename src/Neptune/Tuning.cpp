@@ -0,0 +1,34 @@
+#include "Tuning.hpp"
+
+#include "EvalParams.hpp"
+
+int ExtractFeatures(const PackedPosition &position, TuningFeature *features) {
+  int count = 0;
+
+  Bitboard occupied;
+  occupied.SetBoard(position.occupancy);
+  for (int index = 0; occupied.IsNotEmpty(); ++index) {
+    int code = position.pieces[index / 2] >> (index % 2 * 4) & 0xF;
+    int color = code / 6;
+    int pieceType = code % 6;
+    int square = occupied.PopLeastSignificantBit();
+
+    // Black uses the tables turned around, like EvaluateBoard
+    int tableIndex = color == BLACK ? 63 - square : square;
+    int8_t sign = color == WHITE ? 1 : -1;
+    features[count++] = {static_cast<uint16_t>(TUNING_TABLES + pieceType * 64 + tableIndex), sign};
+    features[count++] = {static_cast<uint16_t>(TUNING_MATERIAL + pieceType), sign};
+  }
+  return count;
+}
+
+void GetEvalParameters(double *parameters) {
+  const int *tables[6] = {pawnTable, knightTable, bishopTable, rookTable, queenTable, kingTable};
+
+  for (int pieceType = PAWN; pieceType <= KING; ++pieceType) {
+    for (int square = 0; square < 64; ++square) {
+      parameters[TUNING_TABLES + pieceType * 64 + square] = tables[pieceType][square];
+    }
+    parameters[TUNING_MATERIAL + pieceType] = materialValues[pieceType];
+  }
+}
@@ -0,0 +1,38 @@
+#ifndef NP_TUNING_HPP
+#define NP_TUNING_HPP
+
+#include <cstdint>
+
+#include "PackedPosition.hpp"
+
+// The evaluation as a linear function of its parameters: the square tables of
+// the six piece types, then their material values
+#define TUNING_TABLES 0
+#define TUNING_MATERIAL (6 * 64)
+#define TUNING_PARAMETERS (6 * 64 + 6)
+
+// At most two features per piece
+#define MAX_TUNING_FEATURES 64
+
+// A parameter a position's evaluation depends on, counted +1 for white and -1 for black
+struct TuningFeature {
+  uint16_t index;
+  int8_t sign;
+};
+
+// Decodes the features straight from the packed record, returns how many there are
+int ExtractFeatures(const PackedPosition &position, TuningFeature *features);
+
+// The parameters EvaluateBoard currently uses
+void GetEvalParameters(double *parameters);
+
+// Same as EvaluateBoard, from white's view, for any parameters
+inline double LinearEvaluate(const TuningFeature *features, int count, const double *parameters) {
+  double score = 0.0;
+  for (int i = 0; i < count; ++i) {
+    score += features[i].sign * parameters[features[i].index];
+  }
+  return score;
+}
+
+#endif // NP_TUNING_HPP
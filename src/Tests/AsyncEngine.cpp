@@ -0,0 +1,94 @@
+#include "Neptune/AsyncEngine.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <vector>
+
+TEST_CASE("Asynchronous engine") {
+  SearchLimits limits;
+
+  SECTION("Engines sharing a pool search like a Searcher") {
+    limits.depth = 5;
+    Board board;
+    board.InitMoves();
+    board.Reset();
+    Searcher reference;
+    reference.verbose = false;
+    SearchResult expected = reference.Search(board, WHITE, limits);
+
+    ThreadPool pool(2);
+    std::vector<std::unique_ptr<AsyncEngine>> engines;
+    std::vector<std::future<SearchResult>> results;
+    std::atomic<int> deepest[4] = {};
+    for (int i = 0; i < 4; ++i) {
+      engines.push_back(std::make_unique<AsyncEngine>(pool.GetExecutor()));
+      results.push_back(engines[i]->Search(limits, [&deepest, i](const SearchProgress &progress) {
+        deepest[i] = std::max(deepest[i].load(), progress.depth);
+      }));
+    }
+    for (int i = 0; i < 4; ++i) {
+      SearchResult result = results[i].get();
+      REQUIRE(result.bestMove == expected.bestMove);
+      REQUIRE(result.score == expected.score);
+      REQUIRE(result.nodes == expected.nodes);
+      REQUIRE(deepest[i] == 5);
+    }
+  }
+
+  AsyncEngine engine;
+
+  SECTION("Positions are taken when the search starts") {
+    REQUIRE_FALSE(engine.SetPosition("not a fen"));
+    REQUIRE_FALSE(engine.SetPosition("startpos", {"e2e5"}));
+    REQUIRE(engine.SetPosition("6k1/5ppp/8/8/8/8/8/R3K3 w - - 0 1"));
+    limits.depth = 3;
+    std::future<SearchResult> mate = engine.Search(limits);
+    REQUIRE(engine.SetPosition("startpos", {"e2e4", "e7e5"}));
+    std::future<SearchResult> opening = engine.Search(limits);
+
+    SearchResult result = mate.get();
+    REQUIRE(result.bestMove == Move::FromAlgebraicNotation("a1a8"));
+    REQUIRE(result.score == MATE_SCORE - 1);
+    REQUIRE(opening.get().depth == 3);
+    engine.Wait();
+    REQUIRE(engine.IsIdle());
+  }
+
+  SECTION("Searches end when their token is stopped") {
+    std::stop_source stop;
+    std::atomic<int> lines{0};
+    std::future<SearchResult> result = engine.Search(limits, [&](const SearchProgress &) {
+      if (++lines == 3) {
+        stop.request_stop();
+      }
+    }, stop.get_token());
+    REQUIRE(result.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    SearchResult stopped = result.get();
+    REQUIRE(stopped.depth >= 3);
+    REQUIRE(stopped.depth < MAX_PLY - 1);
+    REQUIRE(stopped.bestMove.fromSquare != stopped.bestMove.toSquare);
+  }
+
+  SECTION("Stop ends the running search and the queued ones") {
+    std::vector<std::future<SearchResult>> results;
+    for (int i = 0; i < 3; ++i) {
+      results.push_back(engine.Search(limits));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    engine.Stop();
+    for (std::future<SearchResult> &result : results) {
+      REQUIRE(result.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+      REQUIRE(result.get().depth < MAX_PLY - 1);
+    }
+
+    // The next search isn't stopped
+    limits.depth = 4;
+    REQUIRE(engine.Search(limits).get().depth == 4);
+    REQUIRE(engine.ResizeHash(1).get());
+    engine.NewGame().get();
+    REQUIRE(engine.Search(limits).get().depth == 4);
+  }
+}
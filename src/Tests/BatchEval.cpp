@@ -0,0 +1,38 @@
+#include "Neptune/BatchEval.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <vector>
+
+TEST_CASE("Batch evaluation") {
+  Board board;
+  board.Reset();
+  board.InitMoves();
+
+  // Positions from random games, not a whole number of SIMD groups
+  std::vector<Board> boards;
+  std::mt19937_64 random(47);
+  MoveList moves;
+  while (boards.size() < 203) {
+    Board game = board;
+    int color = WHITE;
+    for (int ply = 0; ply < 80 && boards.size() < 203; ++ply) {
+      game.GenerateLegalMoves(color, moves);
+      if (moves.IsEmpty()) {
+        break;
+      }
+      game.MakeMove(moves[random() % moves.Size()], color);
+      color = !color;
+      boards.push_back(game);
+    }
+  }
+
+  std::vector<int> batch(boards.size()), scalar(boards.size());
+  EvaluateBatch(boards, batch);
+  EvaluateBatchScalar(boards, scalar);
+  for (size_t i = 0; i < boards.size(); ++i) {
+    REQUIRE(batch[i] == boards[i].EvaluateBoard());
+    REQUIRE(scalar[i] == boards[i].EvaluateBoard());
+  }
+}
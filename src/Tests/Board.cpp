@@ -0,0 +1,286 @@
+#include "Neptune/Board.hpp"
+#include "Neptune/History.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+static uint64_t Perft(Board &board, int depth, int color) {
+  MoveList moves;
+  board.GenerateLegalMoves(color, moves);
+  if (depth == 1) {
+    return moves.Size();
+  }
+
+  uint64_t nodes = 0;
+  for (Move move : moves) {
+    Board child = board;
+    child.MakeMove(move, color);
+    nodes += Perft(child, depth - 1, !color);
+  }
+  return nodes;
+}
+
+// Checks the incrementally updated key against one computed from scratch
+static bool KeysMatch(Board &board, int depth, int color) {
+  if (board.GetKey() != board.ComputeKey(color)) {
+    return false;
+  }
+  if (depth == 0) {
+    return true;
+  }
+
+  MoveList moves;
+  board.GenerateLegalMoves(color, moves);
+  for (Move move : moves) {
+    Board child = board;
+    child.MakeMove(move, color);
+    if (!KeysMatch(child, depth - 1, !color)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Checks GivesCheck against making every move and looking
+static bool GivesCheckMatches(Board &board, int depth, int color) {
+  AttackInfo attackInfo;
+  board.ComputeAttackInfo(color, attackInfo);
+  MoveList moves;
+  board.GenerateLegalMoves(color, moves, attackInfo);
+
+  for (Move move : moves) {
+    Board child = board;
+    child.MakeMove(move, color);
+    if (board.GivesCheck(move, color, attackInfo) != child.IsInCheck(!color)) {
+      return false;
+    }
+    if (depth > 1 && !GivesCheckMatches(child, depth - 1, !color)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Checks IsPseudoLegal and IsLegal on every from, to and promotion against the generated moves
+static bool ValidationMatches(Board &board, int depth, int color) {
+  AttackInfo attackInfo;
+  board.ComputeAttackInfo(color, attackInfo);
+  MoveList moves;
+  board.GenerateLegalMoves(color, moves, attackInfo);
+
+  for (int from = 0; from < 64; ++from) {
+    for (int to = 0; to < 64; ++to) {
+      for (int promotionPiece = EMPTY; promotionPiece <= KING; ++promotionPiece) {
+        Move move(from, to);
+        move.promotionPiece = promotionPiece;
+        bool generated = false;
+        for (Move legal : moves) {
+          generated |= legal == move;
+        }
+        if ((board.IsPseudoLegal(move, color) && board.IsLegal(move, color, attackInfo)) != generated) {
+          return false;
+        }
+      }
+    }
+  }
+
+  if (depth > 1) {
+    for (Move move : moves) {
+      Board child = board;
+      child.MakeMove(move, color);
+      if (!ValidationMatches(child, depth - 1, !color)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+TEST_CASE("Move generation") {
+  Board board;
+  board.Reset();
+  board.InitMoves();
+
+  SECTION("Perft from the starting position") {
+    REQUIRE(Perft(board, 1, WHITE) == 20);
+    REQUIRE(Perft(board, 2, WHITE) == 400);
+    REQUIRE(Perft(board, 3, WHITE) == 8902);
+    REQUIRE(Perft(board, 4, WHITE) == 197281);
+  }
+  SECTION("Perft with pins, checks and en passant along the king's rank") {
+    int color;
+    REQUIRE(board.FromFEN("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", color));
+    REQUIRE(Perft(board, 4, color) == 43238);
+    REQUIRE(Perft(board, 5, color) == 674624);
+  }
+  SECTION("Gives check") {
+    int color;
+    // Castling, promotions, en passant and discovered checks all show up in these
+    for (const char *fen : {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+                            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+                            "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+                            "5k2/8/8/8/8/8/8/4K2R w K - 0 1",
+                            "8/8/8/R2pP2k/8/8/8/K7 w - d6 0 1"}) {
+      REQUIRE(board.FromFEN(fen, color));
+      REQUIRE(GivesCheckMatches(board, 3, color));
+    }
+  }
+  SECTION("Move validation") {
+    int color;
+    for (const char *fen : {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+                            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+                            "8/8/8/R2pP2k/8/8/8/K7 w - d6 0 1"}) {
+      REQUIRE(board.FromFEN(fen, color));
+      REQUIRE(ValidationMatches(board, 2, color));
+    }
+  }
+  SECTION("Attack info") {
+    int color;
+    // The bishop on d3 is pinned by the queen, the rook on e7 gives check
+    REQUIRE(board.FromFEN("4k3/4r3/8/1q6/8/3B4/4K3/8 w - - 0 1", color));
+    AttackInfo attackInfo;
+    board.ComputeAttackInfo(color, attackInfo);
+
+    REQUIRE(attackInfo.checkers.GetBoard() == 1ULL << 52);
+    REQUIRE(attackInfo.pinned.GetBoard() == 1ULL << 19);
+    REQUIRE(attackInfo.attackedBy[BLACK][ROOK].IsSet(12));
+    // Through the king, so it can't step back along the rook's file
+    REQUIRE(attackInfo.attacks[BLACK].IsSet(4));
+    REQUIRE(attackInfo.attackedBy[WHITE][BISHOP].IsSet(55));
+
+    // Only the king can answer, the pinned bishop can't block on e4
+    MoveList moves;
+    board.GenerateLegalMoves(color, moves);
+    REQUIRE_FALSE(moves.IsEmpty());
+    for (Move move : moves) {
+      REQUIRE(move.fromSquare == 12);
+      REQUIRE(move.toSquare != 4);
+    }
+  }
+}
+
+TEST_CASE("Position history") {
+  Board board;
+  board.Reset();
+  board.InitMoves();
+
+  SECTION("Incremental keys match computed keys") {
+    REQUIRE(KeysMatch(board, 3, WHITE));
+
+    // Castling, en passant and promotion
+    const char *moves[] = {"e2e4", "d7d5", "e4e5", "f7f5", "e5f6", "g8h6", "f6g7", "e8f7", "g7h8q", "b8c6", "g1f3", "c8e6", "f1c4", "d8d6", "e1g1"};
+    int color = WHITE;
+    for (const char *move : moves) {
+      board.MakeMove(Move::FromAlgebraicNotation(move), color);
+      color = !color;
+      REQUIRE(board.GetKey() == board.ComputeKey(color));
+      REQUIRE(KeysMatch(board, 2, color));
+    }
+  }
+
+  SECTION("Repetition and fifty-move counting") {
+    PositionHistory history;
+    uint64_t startKey = board.GetKey();
+
+    const char *moves[] = {"g1f3", "g8f6", "f3g1", "f6g8"};
+    int color = WHITE;
+    for (const char *move : moves) {
+      REQUIRE_FALSE(history.IsRepetition(board.GetKey(), board.GetHalfmoveClock()));
+      history.Push(board.GetKey());
+      board.MakeMove(Move::FromAlgebraicNotation(move), color);
+      color = !color;
+    }
+
+    REQUIRE(board.GetKey() == startKey);
+    REQUIRE(board.GetHalfmoveClock() == 4);
+    REQUIRE(history.IsRepetition(board.GetKey(), board.GetHalfmoveClock()));
+
+    // A pawn move is irreversible
+    history.Push(board.GetKey());
+    board.MakeMove(Move::FromAlgebraicNotation("e2e4"), color);
+    REQUIRE(board.GetHalfmoveClock() == 0);
+    REQUIRE_FALSE(history.IsRepetition(board.GetKey(), board.GetHalfmoveClock()));
+    REQUIRE(history.Back(5) == startKey);
+
+    // Past MAX_GAME_PLY pushes the newest keys are kept, so repetitions still show
+    while (history.Size() < MAX_GAME_PLY + 2) {
+      history.Push(history.Size());
+    }
+    history.Push(startKey);
+    history.Push(1);
+    REQUIRE(history.Back(2) == startKey);
+    REQUIRE(history.Back(3) == MAX_GAME_PLY + 1);
+    REQUIRE(history.Back(MAX_GAME_PLY - 1) == 5);
+    REQUIRE(history.Back(MAX_GAME_PLY + 1) == 0);
+    REQUIRE(history.IsRepetition(startKey, 100));
+    REQUIRE(history.Repetitions(startKey, 100) == 1);
+  }
+}
+
+TEST_CASE("FEN") {
+  Board board;
+  board.Reset();
+  board.InitMoves();
+  int color = BLACK;
+
+  SECTION("Starting position") {
+    REQUIRE(board.ToFEN(WHITE) == "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+
+    Board parsed;
+    REQUIRE(parsed.FromFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", color));
+    REQUIRE(color == WHITE);
+    REQUIRE(parsed.GetKey() == board.GetKey());
+  }
+
+  SECTION("Round trip") {
+    const char *fens[] = {
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+      "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 b - - 11 40",
+    };
+    for (const char *fen : fens) {
+      REQUIRE(board.FromFEN(fen, color));
+      int fullmove = std::stoi(std::string(fen).substr(std::string(fen).rfind(' ') + 1));
+      REQUIRE(board.ToFEN(color, fullmove) == fen);
+      REQUIRE(board.GetKey() == board.ComputeKey(color));
+    }
+  }
+
+  SECTION("EPD style, without the clocks") {
+    REQUIRE(board.FromFEN("4k3/8/8/8/8/8/8/4K2R w K -", color));
+    REQUIRE(board.GetCastlingRights() == WHITE_KINGSIDE_CASTLE);
+    REQUIRE(board.GetHalfmoveClock() == 0);
+  }
+
+  SECTION("Castling rights go with the king and rooks") {
+    REQUIRE(board.FromFEN("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1", color));
+    // The rook leaves a1 and takes the one on a8
+    board.MakeMove(Move::FromAlgebraicNotation("a1a8"), color);
+    REQUIRE(board.GetCastlingRights() == (WHITE_KINGSIDE_CASTLE | BLACK_KINGSIDE_CASTLE));
+    board.MakeMove(Move::FromAlgebraicNotation("e8e7"), BLACK);
+    REQUIRE(board.GetCastlingRights() == WHITE_KINGSIDE_CASTLE);
+    REQUIRE(board.GetKey() == board.ComputeKey(WHITE));
+  }
+
+  SECTION("Invalid positions are refused") {
+    REQUIRE_FALSE(board.FromFEN("", color));
+    REQUIRE_FALSE(board.FromFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1", color));
+    REQUIRE_FALSE(board.FromFEN("rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", color));
+    REQUIRE_FALSE(board.FromFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1", color));
+    REQUIRE_FALSE(board.FromFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQXBNR w KQkq - 0 1", color));
+    // No white king, and black to move while giving check
+    REQUIRE_FALSE(board.FromFEN("4k3/8/8/8/8/8/8/8 w - - 0 1", color));
+    REQUIRE_FALSE(board.FromFEN("4k3/8/8/8/8/8/8/4K2r b - - 0 1", color));
+
+    // A failed parse leaves the board alone
+    REQUIRE(board.ToFEN(WHITE) == "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+  }
+
+  SECTION("Perft from a position with castling, en passant and promotions") {
+    REQUIRE(board.FromFEN("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", color));
+    REQUIRE(Perft(board, 1, color) == 48);
+    REQUIRE(Perft(board, 2, color) == 2039);
+    REQUIRE(Perft(board, 3, color) == 97862);
+  }
+}
@@ -0,0 +1,88 @@
+#include "Neptune/Cluster.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+
+// A worker in a process of its own, on a free loopback port. Returns the port, 0 if it didn't start.
+static int StartWorker(std::vector<pid_t> &children) {
+  int channel[2];
+  if (pipe(channel) == -1) {
+    return 0;
+  }
+  pid_t child = fork();
+  if (child == 0) {
+    ClusterWorker worker(4, SearchOptions());
+    int port = worker.Listen("0") ? worker.Port() : 0;
+    ssize_t written = write(channel[1], &port, sizeof(port));
+    if (port && written == sizeof(port)) {
+      worker.Run();
+    }
+    _exit(0);
+  }
+  ::close(channel[1]);
+  int port = 0;
+  if (child == -1 || read(channel[0], &port, sizeof(port)) != sizeof(port)) {
+    port = 0;
+  }
+  ::close(channel[0]);
+  if (child != -1) {
+    children.push_back(child);
+  }
+  return port;
+}
+
+TEST_CASE("Cluster search") {
+  Board board;
+  board.InitMoves();
+
+  std::vector<pid_t> children;
+  ClusterCoordinator cluster;
+  for (int i = 0; i < 2; ++i) {
+    int port = StartWorker(children);
+    REQUIRE(port);
+    REQUIRE(cluster.Connect("127.0.0.1:" + std::to_string(port)));
+  }
+  REQUIRE(cluster.WorkerCount() == 2);
+  REQUIRE_FALSE(cluster.Connect("not an address"));
+
+  SearchLimits limits;
+
+  SECTION("Finds the move of whichever worker has it") {
+    int color;
+    REQUIRE(board.FromFEN("6k1/5ppp/8/8/8/8/8/R3K3 w - - 0 1", color));
+    limits.depth = 3;
+    SearchResult result = cluster.Search(board, color, limits);
+    REQUIRE(result.bestMove == Move::FromAlgebraicNotation("a1a8"));
+    REQUIRE(result.score == MATE_SCORE - 1);
+  }
+
+  SECTION("Merges the lines and passes deep entries around") {
+    int color = WHITE;
+    board.Reset();
+    limits.depth = 7;
+    limits.multiPV = 3;
+    SearchResult result = cluster.Search(board, color, limits, PositionHistory(), true);
+    REQUIRE(result.depth == 7);
+    REQUIRE(result.lineCount == 3);
+    REQUIRE(result.lines[0].score >= result.lines[1].score);
+    REQUIRE(result.lines[1].score >= result.lines[2].score);
+    REQUIRE(result.bestMove == result.lines[0].move);
+    REQUIRE(result.nodes > 0);
+    REQUIRE(cluster.EntriesExchanged() > 0);
+  }
+
+  cluster.Shutdown();
+  REQUIRE(cluster.WorkerCount() == 0);
+  for (pid_t child : children) {
+    int status = 0;
+    REQUIRE(waitpid(child, &status, 0) == child);
+    REQUIRE(WIFEXITED(status));
+  }
+}
+#endif
@@ -0,0 +1,50 @@
+#include "Neptune/Match.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("Match") {
+  SECTION("Elo from the score") {
+    MatchScore score;
+    score.wins = 3;
+    score.losses = 1;
+    REQUIRE(score.Score() == 0.75);
+    REQUIRE(score.Elo() > 190.0);
+    REQUIRE(score.Elo() < 191.0);
+
+    score.wins = score.losses = 0;
+    score.draws = 4;
+    REQUIRE(score.Elo() == 0.0);
+    REQUIRE(score.EloMargin() == 0.0);
+  }
+
+  SECTION("SPRT accepts a clear improvement and rejects a regression") {
+    SPRT sprt;
+    MatchScore better;
+    better.wins = 400;
+    better.losses = 200;
+    better.draws = 400;
+    REQUIRE(sprt.LLR(better) >= sprt.UpperBound());
+
+    MatchScore worse;
+    worse.wins = 200;
+    worse.losses = 400;
+    worse.draws = 400;
+    REQUIRE(sprt.LLR(worse) <= sprt.LowerBound());
+  }
+
+  SECTION("Plays a game to checkmate") {
+    Board board;
+    board.InitMoves();
+
+    Searcher white, black;
+    white.verbose = black.verbose = false;
+    TimeControl timeControl;
+    timeControl.nodes = 2000;
+
+    // White mates with Qxf7 right away
+    Game game = PlayGame(white, black, "e2e4 e7e5 f1c4 b8c6 d1h5 g8f6", timeControl);
+    REQUIRE(game.result == WHITE_WINS);
+    REQUIRE(game.end == CHECKMATE);
+    REQUIRE(game.plies == 1);
+  }
+}
@@ -0,0 +1,100 @@
+#include "Neptune/MateSearch.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+// Plays the mate out, true if it ends with the other side mated
+static bool EndsInMate(Board board, int color, const MateResult &result) {
+  for (Move move : result.pv) {
+    AttackInfo attacks;
+    board.ComputeAttackInfo(color, attacks);
+    if (!board.IsPseudoLegal(move, color) || !board.IsLegal(move, color, attacks)) {
+      return false;
+    }
+    board.MakeMove(move, color);
+    color = !color;
+  }
+  MoveList moves;
+  board.GenerateLegalMoves(color, moves);
+  return moves.IsEmpty() && board.IsInCheck(color);
+}
+
+TEST_CASE("Proof-number mate search") {
+  Board board;
+  board.InitMoves();
+  int color;
+  MateSearcher searcher(1);
+  searcher.verbose = false;
+
+  SECTION("Proves the shortest mate") {
+    REQUIRE(board.FromFEN("6k1/5ppp/8/8/8/8/8/R3K3 w - - 0 1", color));
+    MateResult result = searcher.Search(board, color, 3);
+    REQUIRE(result.status == MATE_PROVEN);
+    REQUIRE(result.moves == 1);
+    REQUIRE(result.bestMove == Move::FromAlgebraicNotation("a1a8"));
+
+    // The rook has to cut the king off before it mates
+    REQUIRE(board.FromFEN("8/8/8/8/8/8/k7/2K4R w - - 0 1", color));
+    result = searcher.Search(board, color, 3);
+    REQUIRE(result.status == MATE_PROVEN);
+    REQUIRE(result.moves == 2);
+    REQUIRE(result.pv.size() == 3);
+    REQUIRE(EndsInMate(board, color, result));
+
+    // Queen sacrifice, then mate with bishop and rook
+    REQUIRE(board.FromFEN("r1b3kr/ppp1Bp1p/1b6/n2P4/2p3q1/2Q2N2/P4PPP/RN2R1K1 w - - 1 0", color));
+    result = searcher.Search(board, color, 3);
+    REQUIRE(result.status == MATE_PROVEN);
+    REQUIRE(result.moves == 3);
+    REQUIRE(result.bestMove == Move::FromAlgebraicNotation("c3h8"));
+    REQUIRE(EndsInMate(board, color, result));
+  }
+
+  SECTION("Disproves mates that aren't there") {
+    REQUIRE(board.FromFEN("8/8/8/8/8/2k5/8/2K5 w - - 0 1", color));
+    REQUIRE(searcher.Search(board, color, 2).status == MATE_DISPROVEN);
+
+    // Legal's mate takes two moves
+    REQUIRE(board.FromFEN("r2qkbnr/ppp2ppp/2np4/4N3/2B1P1b1/2N5/PPPP1PPP/R1BbK2R w KQkq - 0 6", color));
+    REQUIRE(searcher.Search(board, color, 1).status == MATE_DISPROVEN);
+    MateResult result = searcher.Search(board, color, 2);
+    REQUIRE(result.status == MATE_PROVEN);
+    REQUIRE(EndsInMate(board, color, result));
+
+    // Stalemate is no mate
+    REQUIRE(board.FromFEN("k7/8/1Q6/8/8/8/8/K7 b - - 0 1", color));
+    REQUIRE(searcher.Search(board, color, 2).status == MATE_DISPROVEN);
+  }
+
+  SECTION("Only tries the search moves at the root") {
+    REQUIRE(board.FromFEN("6k1/5ppp/8/8/8/8/8/R3K3 w - - 0 1", color));
+    SearchLimits limits;
+    limits.searchMoves.Add(Move::FromAlgebraicNotation("e1e2"));
+    REQUIRE(searcher.Search(board, color, 1, limits).status == MATE_DISPROVEN);
+
+    // What was left out at the root doesn't stay out of the next search
+    MateResult result = searcher.Search(board, color, 1);
+    REQUIRE(result.status == MATE_PROVEN);
+    REQUIRE(result.bestMove == Move::FromAlgebraicNotation("a1a8"));
+
+    limits.searchMoves.Add(Move::FromAlgebraicNotation("a1a8"));
+    result = searcher.Search(board, color, 1, limits);
+    REQUIRE(result.status == MATE_PROVEN);
+    REQUIRE(result.bestMove == Move::FromAlgebraicNotation("a1a8"));
+  }
+
+  SECTION("Stops at the node limit") {
+    REQUIRE(board.FromFEN("2b1q3/rppp4/p4p1k/3B2p1/P4P2/6QP/RBPP2R1/5K2 w - - 0 1", color));
+    SearchLimits limits;
+    limits.nodes = 100;
+    MateResult result = searcher.Search(board, color, 4, limits);
+    REQUIRE(result.status == MATE_UNKNOWN);
+    REQUIRE(result.nodes < 200);
+
+    result = searcher.Search(board, color, 4);
+    REQUIRE(result.status == MATE_PROVEN);
+    REQUIRE(result.moves == 4);
+    REQUIRE(EndsInMate(board, color, result));
+  }
+}
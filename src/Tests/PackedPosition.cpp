@@ -0,0 +1,48 @@
+#include "Neptune/PackedPosition.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("Packed positions") {
+  Board board;
+  board.Reset();
+  board.InitMoves();
+
+  SECTION("Round trip keeps the position") {
+    // Ends with an en passant square, both sides having lost some castling rights
+    const char *moves[] = {"e2e4", "g8f6", "g1f3", "f6g8", "h1g1", "b8c6", "e1e2", "a7a5", "e4e5", "d7d5"};
+    int color = WHITE;
+    for (const char *move : moves) {
+      board.MakeMove(Move::FromAlgebraicNotation(move), color);
+      color = !color;
+    }
+
+    PackedPosition packed = PackedPosition::FromBoard(board, color);
+    Board unpacked;
+    int unpackedColor = packed.ToBoard(unpacked);
+
+    REQUIRE(unpackedColor == color);
+    REQUIRE(unpacked.GetKey() == board.GetKey());
+    REQUIRE(unpacked.GetEnPassantSquare() == board.GetEnPassantSquare());
+    REQUIRE(unpacked.GetCastlingRights() == (BLACK_KINGSIDE_CASTLE | BLACK_QUEENSIDE_CASTLE));
+    REQUIRE(unpacked.GetHalfmoveClock() == 0);
+
+    MoveList expected, actual;
+    board.GenerateLegalMoves(color, expected);
+    unpacked.GenerateLegalMoves(unpackedColor, actual);
+    REQUIRE(actual.Size() == expected.Size());
+    for (int i = 0; i < expected.Size(); ++i) {
+      REQUIRE(actual[i] == expected[i]);
+    }
+  }
+
+  SECTION("Starting position") {
+    PackedPosition packed = PackedPosition::FromBoard(board, WHITE);
+    REQUIRE(packed.occupancy == 0xFFFF00000000FFFFULL);
+    REQUIRE(packed.enPassant == NO_EN_PASSANT);
+    REQUIRE(packed.flags >> 1 == 0xF);
+
+    Board unpacked;
+    packed.ToBoard(unpacked);
+    REQUIRE(unpacked.GetKey() == board.GetKey());
+  }
+}
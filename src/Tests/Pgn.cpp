@@ -0,0 +1,134 @@
+#include "Neptune/Pgn.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+static std::string SAN(Board &board, int color, const char *move) {
+  char buffer[MAX_SAN_LENGTH];
+  return std::string(buffer, WriteSAN(board, color, Move::FromAlgebraicNotation(move), buffer) - buffer);
+}
+
+TEST_CASE("PGN") {
+  Board board;
+  board.Reset();
+  board.InitMoves();
+  int color;
+
+  SECTION("Writing SAN") {
+    REQUIRE(board.FromFEN("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", color));
+    REQUIRE(SAN(board, color, "e1g1") == "O-O");
+    REQUIRE(SAN(board, color, "e1c1") == "O-O-O");
+    REQUIRE(SAN(board, color, "e5f7") == "Nxf7");
+    REQUIRE(SAN(board, color, "d5e6") == "dxe6");
+    REQUIRE(SAN(board, color, "c3b1") == "Nb1");
+    REQUIRE(SAN(board, color, "d2c1") == "Bc1");
+
+    REQUIRE(board.FromFEN("4k3/8/8/8/8/8/8/1N2KN2 w - - 0 1", color));
+    REQUIRE(SAN(board, color, "b1d2") == "Nbd2");
+    REQUIRE(SAN(board, color, "f1d2") == "Nfd2");
+
+    REQUIRE(board.FromFEN("4k3/1P6/8/8/8/8/8/R3K2R w - - 0 1", color));
+    REQUIRE(SAN(board, color, "b7b8q") == "b8=Q+");
+    REQUIRE(SAN(board, color, "a1a8") == "Ra8+");
+
+    REQUIRE(board.FromFEN("4k3/8/8/8/8/8/4K3/R6R w - - 0 1", color));
+    REQUIRE(SAN(board, color, "a1d1") == "Rad1");
+    REQUIRE(SAN(board, color, "h1d1") == "Rhd1");
+
+    REQUIRE(board.FromFEN("6k1/5ppp/8/8/8/8/8/R3K3 w - - 0 1", color));
+    REQUIRE(SAN(board, color, "a1a8") == "Ra8#");
+
+    REQUIRE(board.FromFEN("6k1/8/8/8/Q7/8/8/Q2Q3K w - - 0 1", color));
+    REQUIRE(SAN(board, color, "a1d4") == "Qa1d4");
+  }
+
+  SECTION("Reading SAN") {
+    REQUIRE(board.FromFEN("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", color));
+    Move move;
+    REQUIRE(ParseSAN(board, color, "O-O", move));
+    REQUIRE(move == Move::FromAlgebraicNotation("e1g1"));
+    REQUIRE(ParseSAN(board, color, "0-0-0", move));
+    REQUIRE(move == Move::FromAlgebraicNotation("e1c1"));
+    REQUIRE(ParseSAN(board, color, "Nxf7!?", move));
+    REQUIRE(move == Move::FromAlgebraicNotation("e5f7"));
+    REQUIRE_FALSE(ParseSAN(board, color, "Ke3", move));  // illegal
+    REQUIRE_FALSE(ParseSAN(board, color, "xyz", move));
+
+    REQUIRE(board.FromFEN("4k3/8/8/8/8/8/8/1N2KN2 w - - 0 1", color));
+    REQUIRE(ParseSAN(board, color, "Nbd2", move));
+    REQUIRE(move == Move::FromAlgebraicNotation("b1d2"));
+    REQUIRE_FALSE(ParseSAN(board, color, "Nd2", move));  // ambiguous
+
+    REQUIRE(board.FromFEN("4k3/1P6/8/8/8/8/8/4K3 w - - 0 1", color));
+    REQUIRE(ParseSAN(board, color, "b8=N", move));
+    REQUIRE(move == Move::FromAlgebraicNotation("b7b8n"));
+    REQUIRE(ParseSAN(board, color, "b8Q+", move));
+    REQUIRE(move == Move::FromAlgebraicNotation("b7b8q"));
+  }
+
+  SECTION("Reading and writing games") {
+    const char *pgn =
+      "[Event \"Test\"]\n"
+      "[White \"A\"]\n"
+      "[Black \"B\"]\n"
+      "[Result \"1-0\"]\n"
+      "\n"
+      "1. e4 {best by test} e5 2. Bc4 (2. Nf3 Nc6 (2... d6) 3. Bb5) 2... Nc6 $1\n"
+      "3. Qh5 Nf6?? 4. Qxf7# 1-0\n"
+      "\n"
+      "[Event \"Second\"]\n"
+      "[FEN \"4k3/8/8/8/8/8/8/4K2R w K - 0 1\"]\n"
+      "\n"
+      "1.O-O Kd7 *\n"
+      "\n"
+      "[Event \"Zeros\"]\n"
+      "[FEN \"r3k3/8/8/8/8/8/8/4K2R w Kq - 0 1\"]\n"
+      "\n"
+      "1. 0-0 0-0-0 *\n";
+
+    PgnReader reader(pgn);
+    PgnGame game;
+
+    REQUIRE(reader.NextGame(game));
+    REQUIRE(game.Tag("White") == "A");
+    REQUIRE(game.result == "1-0");
+    REQUIRE(game.moves.size() == 7);
+    REQUIRE(game.moves[6] == "Qxf7#");
+
+    PgnWriter writer;
+    writer.BeginGame();
+    writer.AddTag("Event", game.Tag("Event"));
+    REQUIRE(SetupGame(game, board, color));
+    for (std::string_view san : game.moves) {
+      Move move;
+      REQUIRE(ParseSAN(board, color, san, move));
+      writer.AddMove(board, color, move);
+      board.MakeMove(move, color);
+      color = !color;
+    }
+    writer.EndGame(game.result);
+    REQUIRE(writer.Buffer() == "[Event \"Test\"]\n\n1. e4 e5 2. Bc4 Nc6 3. Qh5 Nf6 4. Qxf7# 1-0\n\n");
+
+    REQUIRE(reader.NextGame(game));
+    REQUIRE(game.Tag("Event") == "Second");
+    REQUIRE(game.result == "*");
+    REQUIRE(game.moves.size() == 2);
+    REQUIRE(SetupGame(game, board, color));
+    Move move;
+    REQUIRE(ParseSAN(board, color, game.moves[0], move));
+    REQUIRE(move == Move::FromAlgebraicNotation("e1g1"));
+
+    REQUIRE(reader.NextGame(game));
+    REQUIRE(game.moves.size() == 2);
+    REQUIRE(game.moves[0] == "0-0");
+    REQUIRE(game.moves[1] == "0-0-0");
+    REQUIRE(SetupGame(game, board, color));
+    REQUIRE(ParseSAN(board, color, game.moves[0], move));
+    REQUIRE(move == Move::FromAlgebraicNotation("e1g1"));
+    board.MakeMove(move, color);
+    color = !color;
+    REQUIRE(ParseSAN(board, color, game.moves[1], move));
+    REQUIRE(move == Move::FromAlgebraicNotation("e8c8"));
+
+    REQUIRE_FALSE(reader.NextGame(game));
+  }
+}
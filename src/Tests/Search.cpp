@@ -0,0 +1,125 @@
+#include "Neptune/Search.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+
+// Counted by the global operator new in Testing.cpp
+extern std::atomic<uint64_t> allocationCount;
+
+TEST_CASE("Search") {
+  Board board;
+  board.Reset();
+  board.InitMoves();
+
+  Searcher searcher;
+  searcher.verbose = false;
+
+  SECTION("Finds a mate in one") {
+    int color = WHITE;
+    for (const char *move : {"e2e4", "e7e5", "f1c4", "b8c6", "d1h5", "g8f6"}) {
+      board.MakeMove(Move::FromAlgebraicNotation(move), color);
+      color = !color;
+    }
+
+    SearchLimits limits;
+    limits.depth = 3;
+    SearchResult result = searcher.Search(board, color, limits);
+
+    REQUIRE(result.bestMove == Move::FromAlgebraicNotation("h5f7"));
+    REQUIRE(result.score >= MATE_BOUND);
+  }
+  SECTION("Finds several lines") {
+    SearchLimits limits;
+    limits.depth = 4;
+    limits.multiPV = 3;
+    SearchResult result = searcher.Search(board, WHITE, limits);
+
+    REQUIRE(result.lineCount == 3);
+    REQUIRE(result.bestMove == result.lines[0].move);
+    REQUIRE(result.score == result.lines[0].score);
+    REQUIRE_FALSE(result.lines[0].move == result.lines[1].move);
+    REQUIRE_FALSE(result.lines[0].move == result.lines[2].move);
+    REQUIRE_FALSE(result.lines[1].move == result.lines[2].move);
+  }
+  SECTION("Searches only the given moves") {
+    SearchLimits limits;
+    limits.depth = 4;
+    limits.searchMoves.Add(Move::FromAlgebraicNotation("a2a3"));
+    limits.searchMoves.Add(Move::FromAlgebraicNotation("h2h3"));
+    SearchResult result = searcher.Search(board, WHITE, limits);
+
+    REQUIRE((result.bestMove == Move::FromAlgebraicNotation("a2a3") || result.bestMove == Move::FromAlgebraicNotation("h2h3")));
+  }
+  SECTION("Searches without allocating") {
+    int color = WHITE;
+    for (const char *move : {"e2e4", "e7e5", "g1f3", "b8c6", "f1b5", "a7a6"}) {
+      board.MakeMove(Move::FromAlgebraicNotation(move), color);
+      color = !color;
+    }
+
+    SearchLimits limits;
+    limits.depth = 5;
+
+    uint64_t allocationsBefore = allocationCount;
+    SearchResult result = searcher.Search(board, color, limits);
+    uint64_t allocations = allocationCount - allocationsBefore;
+
+    REQUIRE(result.nodes > 0);
+    REQUIRE(allocations == 0);
+  }
+  SECTION("Techniques can be switched off") {
+    struct Technique {
+      const char *name;
+      bool SearchOptions::*enabled;
+      bool compiled;
+    };
+    const Technique techniques[] = {
+      {"NullMove", &SearchOptions::nullMove, NP_NULL_MOVE},
+      {"LMR", &SearchOptions::lateMoveReductions, NP_LMR},
+      {"ReverseFutility", &SearchOptions::reverseFutility, NP_REVERSE_FUTILITY},
+      {"Futility", &SearchOptions::futility, NP_FUTILITY},
+      {"LateMovePruning", &SearchOptions::lateMovePruning, NP_LATE_MOVE_PRUNING},
+      {"CheckExtensions", &SearchOptions::checkExtensions, NP_CHECK_EXTENSIONS},
+      {"QuiescenceChecks", &SearchOptions::quiescenceChecks, NP_QUIESCENCE_CHECKS},
+    };
+
+    SearchOptions options;
+    for (const Technique &technique : techniques) {
+      REQUIRE(options.Set(technique.name, false));
+      REQUIRE_FALSE(options.*technique.enabled);
+      REQUIRE(options.Set(technique.name, true));
+      REQUIRE(options.*technique.enabled);
+    }
+    REQUIRE_FALSE(options.Set("Contempt", true));
+
+    // Each one compiled in changes the tree searched
+    int color;
+    REQUIRE(board.FromFEN("r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP1B1PPP/R2QKB1R w KQ - 0 8", color));
+    SearchLimits limits;
+    limits.depth = 7;
+    searcher.options = options;
+    searcher.table.Clear();
+    uint64_t allOn = searcher.Search(board, color, limits).nodes;
+    for (const Technique &technique : techniques) {
+      if (technique.compiled) {
+        searcher.options = options;
+        searcher.options.*technique.enabled = false;
+        searcher.table.Clear();
+        INFO(technique.name);
+        REQUIRE(searcher.Search(board, color, limits).nodes != allOn);
+      }
+    }
+
+    // With all of them off the search still sees a mate
+    for (const Technique &technique : techniques) {
+      searcher.options.*technique.enabled = false;
+    }
+    REQUIRE(board.FromFEN("6k1/5ppp/8/8/8/8/8/R3K3 w - - 0 1", color));
+    limits.depth = 3;
+    searcher.table.Clear();
+    SearchResult result = searcher.Search(board, color, limits);
+    REQUIRE(result.bestMove == Move::FromAlgebraicNotation("a1a8"));
+    REQUIRE(result.score == MATE_SCORE - 1);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "Neptune/Server.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+const char *startFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+TEST_CASE("Analysis pool") {
+  SearchOptions options;
+  std::mutex repliesMutex;
+  std::vector<std::string> replies;
+  auto collect = [&](const std::string &reply) {
+    std::lock_guard<std::mutex> lock(repliesMutex);
+    replies.push_back(reply);
+  };
+
+  SECTION("Sessions take turns") {
+    AnalysisPool pool(1, 1, options);
+    int busy = pool.OpenSession(SessionLimits(), collect);
+    int other = pool.OpenSession(SessionLimits(), collect);
+
+    AnalysisRequest request;
+    request.fen = startFen;
+    request.limits.depth = 3;
+    for (const char *id : {"a1", "a2", "a3", "a4"}) {
+      request.id = id;
+      REQUIRE(pool.Submit(busy, request));
+    }
+    request.id = "b1";
+    REQUIRE(pool.Submit(other, request));
+    pool.Wait();
+
+    // One thread, so at most the first request of the busy session goes first
+    REQUIRE(replies.size() == 5);
+    REQUIRE((replies[0].rfind("result b1 ", 0) == 0 || replies[1].rfind("result b1 ", 0) == 0));
+    pool.CloseSession(busy);
+    pool.CloseSession(other);
+  }
+
+  SECTION("Budgets and limits") {
+    AnalysisPool pool(2, 2, options);
+    SessionLimits limits;
+    limits.nodeBudget = 3000;
+    int session = pool.OpenSession(limits, collect);
+
+    AnalysisRequest request;
+    request.id = "deep";
+    request.fen = startFen;
+    request.limits.depth = 30;
+    REQUIRE(pool.Submit(session, request));
+    pool.Wait();
+    REQUIRE(pool.NodesSearched() <= 3000 + 64);
+
+    request.id = "late";
+    REQUIRE(pool.Submit(session, request));
+    request.id = "bad";
+    request.fen = "not a position";
+    REQUIRE(pool.Submit(session, request));
+    pool.Wait();
+
+    REQUIRE(replies.size() == 3);
+    REQUIRE(replies[0].rfind("result deep bestmove ", 0) == 0);
+    REQUIRE(replies[1] == "error late budget used up");
+    REQUIRE(replies[2] == "error bad budget used up");
+    pool.CloseSession(session);
+    REQUIRE_FALSE(pool.Submit(session, request));
+  }
+}
+
+#ifndef _WIN32
+TEST_CASE("Analysis server") {
+  SearchOptions options;
+  AnalysisPool pool(1, 1, options);
+  AnalysisServer server(pool, SessionLimits());
+  std::string path = "/tmp/neptune-test-" + std::to_string(getpid()) + ".sock";
+  REQUIRE(server.Listen("unix:" + path));
+  std::thread serving(&AnalysisServer::Run, &server);
+  // A failed REQUIRE mustn't leave the thread running
+  struct StopServer {
+    AnalysisServer &server;
+    std::thread &thread;
+    ~StopServer() {
+      if (thread.joinable()) {
+        server.Stop();
+        thread.join();
+      }
+    }
+  } stopServer{server, serving};
+
+  int client = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+  REQUIRE(connect(client, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0);
+
+  std::string request = std::string("analyze mate 6k1/5ppp/8/8/8/8/8/R3K3 w - - 0 1 depth 3\n") + "analyze start " + startFen + " depth 2\n";
+  REQUIRE(send(client, request.data(), request.size(), 0) == static_cast<ssize_t>(request.size()));
+
+  // Both replies, one thread answers them in order
+  std::string received;
+  char buffer[1024];
+  while (std::count(received.begin(), received.end(), '\n') < 2) {
+    ssize_t bytes = recv(client, buffer, sizeof(buffer), 0);
+    REQUIRE(bytes > 0);
+    received.append(buffer, bytes);
+  }
+  REQUIRE(received.rfind("result mate bestmove a1a8 score mate 1 ", 0) == 0);
+  REQUIRE(received.find("\nresult start bestmove ") != std::string::npos);
+
+  std::string shutdown = "shutdown\n";
+  send(client, shutdown.data(), shutdown.size(), 0);
+  serving.join();
+  close(client);
+}
+#endif
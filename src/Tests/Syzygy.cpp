@@ -0,0 +1,51 @@
+#include "Neptune/Syzygy.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("Syzygy without tablebases") {
+  Board board;
+  board.InitMoves();
+  int color;
+
+  SECTION("No tables are found") {
+    Syzygy::Init("");
+    REQUIRE(Syzygy::MaxCardinality() == 0);
+    Syzygy::Init("/nonexistent/neptune-tablebases");
+    REQUIRE(Syzygy::MaxCardinality() == 0);
+    Syzygy::Init("<empty>");
+    REQUIRE(Syzygy::MaxCardinality() == 0);
+  }
+
+  SECTION("Probes report failure") {
+    Syzygy::Init("/nonexistent/neptune-tablebases");
+    REQUIRE(board.FromFEN("8/8/8/8/8/2k5/8/2K1R3 w - - 0 1", color));
+    Syzygy::ProbeState result = Syzygy::PROBE_OK;
+    Syzygy::ProbeWDL(board, color, &result);
+    REQUIRE(result == Syzygy::PROBE_FAIL);
+
+    result = Syzygy::PROBE_OK;
+    REQUIRE(Syzygy::ProbeDTZ(board, color, &result) == 0);
+    REQUIRE(result == Syzygy::PROBE_FAIL);
+  }
+
+  SECTION("The root moves are left alone") {
+    Syzygy::Init("");
+    REQUIRE(board.FromFEN("8/8/8/8/8/2k5/8/2K1R3 w - - 0 1", color));
+    MoveList rootMoves, expected;
+    board.GenerateLegalMoves(color, rootMoves);
+    board.GenerateLegalMoves(color, expected);
+    REQUIRE_FALSE(Syzygy::RootProbe(board, color, rootMoves));
+    REQUIRE(rootMoves.Size() == expected.Size());
+    for (int i = 0; i < expected.Size(); ++i) {
+      REQUIRE(rootMoves[i] == expected[i]);
+    }
+  }
+
+  SECTION("Scores from WDL values") {
+    REQUIRE(Syzygy::ScoreFromWDL(Syzygy::WDL_LOSS) == -TB_WIN_SCORE);
+    REQUIRE(Syzygy::ScoreFromWDL(Syzygy::WDL_BLESSED_LOSS) == -2);
+    REQUIRE(Syzygy::ScoreFromWDL(Syzygy::WDL_DRAW) == 0);
+    REQUIRE(Syzygy::ScoreFromWDL(Syzygy::WDL_CURSED_WIN) == 2);
+    REQUIRE(Syzygy::ScoreFromWDL(Syzygy::WDL_WIN) == TB_WIN_SCORE);
+  }
+}
@@ -0,0 +1,104 @@
+#include "Neptune/Search.hpp"
+#include "Neptune/Trace.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+// Removes the file when the test ends, passed or not
+struct TemporaryFile {
+  std::string path;
+  ~TemporaryFile() {
+    std::remove(path.c_str());
+  }
+};
+
+TEST_CASE("Search tracing") {
+#ifndef _WIN32
+  TemporaryFile file{"/tmp/neptune-test-" + std::to_string(getpid()) + ".trace"};
+#else
+  TemporaryFile file{"neptune-test.trace"};
+#endif
+  const std::string &path = file.path;
+  TraceWriter writer;
+  uint64_t dropped = 0;
+
+  SECTION("Events come back per thread, in order") {
+    REQUIRE(writer.Open(path));
+    TraceBuffer *first = writer.AddThread();
+    TraceBuffer *second = writer.AddThread();
+    for (int i = 0; i < 1000; ++i) {
+      first->Record(TRACE_NODE, i % 64, 5, Move(12, 28), -i, i, 0);
+      second->Record(TRACE_FAIL_LOW, 3, 0, Move(), 0, 0, -i);
+    }
+    writer.Close();
+    REQUIRE(writer.EventsWritten() == 2000);
+
+    std::vector<TraceEvent> events[2];
+    REQUIRE(ReadTrace(path, [&](uint32_t thread, const TraceEvent &event) { events[thread].push_back(event); }, dropped));
+    REQUIRE(dropped == 0);
+    REQUIRE(events[0].size() == 1000);
+    REQUIRE(events[1].size() == 1000);
+    for (int i = 0; i < 1000; ++i) {
+      REQUIRE(events[0][i].kind == TRACE_NODE);
+      REQUIRE(events[0][i].ply == i % 64);
+      REQUIRE(events[0][i].alpha == -i);
+      REQUIRE(UnpackTraceMove(events[0][i].move) == Move(12, 28));
+      REQUIRE(events[1][i].score == -i);
+    }
+
+    // Not a trace
+    FILE *file = std::fopen(path.c_str(), "wb");
+    std::fputs("not a trace", file);
+    std::fclose(file);
+    REQUIRE_FALSE(ReadTrace(path, [](uint32_t, const TraceEvent &) {}, dropped));
+  }
+
+  SECTION("Every node of a search is traced") {
+    if (!NP_TRACE) {
+      return;
+    }
+    Board board;
+    board.Reset();
+    board.InitMoves();
+
+    Searcher searcher;
+    searcher.verbose = false;
+    REQUIRE(writer.Open(path));
+    searcher.trace = writer.AddThread();
+    SearchLimits limits;
+    limits.depth = 5;
+    SearchResult result = searcher.Search(board, WHITE, limits);
+    writer.Close();
+
+    // Each node ends once, nested within its parent
+    uint64_t nodes = 0;
+    int open = 0;
+    bool nested = true;
+    std::vector<int> plies;
+    REQUIRE(ReadTrace(path, [&](uint32_t, const TraceEvent &event) {
+      if (event.kind <= TRACE_QUIESCENCE) {
+        nodes += event.kind != TRACE_ITERATION;
+        nested &= event.ply == plies.size();
+        plies.push_back(event.ply);
+        open++;
+      } else {
+        nested &= !plies.empty() && event.ply == plies.back();
+        if (!plies.empty()) {
+          plies.pop_back();
+        }
+        open--;
+      }
+    }, dropped));
+    REQUIRE(dropped == 0);
+    REQUIRE(nodes == result.nodes);
+    REQUIRE(open == 0);
+    REQUIRE(nested);
+  }
+}
@@ -0,0 +1,151 @@
+#include "Neptune/TranspositionTable.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Removes the file when the test ends, passed or not
+struct TemporaryFile {
+  std::string path;
+  ~TemporaryFile() {
+    std::remove(path.c_str());
+  }
+};
+
+static void Overwrite(const std::string &path, long offset, char value) {
+  FILE *file = std::fopen(path.c_str(), "r+b");
+  std::fseek(file, offset, SEEK_SET);
+  std::fputc(value, file);
+  std::fclose(file);
+}
+
+TEST_CASE("Transposition table") {
+  TranspositionTable table(1, false);
+  Move move(12, 28);
+  table.Store(0x123456789ABCDEFULL, move, -35, 7, BOUND_LOWER);
+
+  SECTION("Stores and probes") {
+    TableEntry entry;
+    REQUIRE(table.Probe(0x123456789ABCDEFULL, entry));
+    REQUIRE(entry.move == move);
+    REQUIRE(entry.score == -35);
+    REQUIRE(entry.depth == 7);
+    REQUIRE(entry.bound == BOUND_LOWER);
+    REQUIRE_FALSE(table.Probe(0x123456789ABCDEEULL, entry));
+  }
+
+  SECTION("Snapshots") {
+#ifndef _WIN32
+    TemporaryFile file{"/tmp/neptune-test-" + std::to_string(getpid()) + ".snap"};
+#else
+    TemporaryFile file{"neptune-test.snap"};
+#endif
+    const std::string &path = file.path;
+    REQUIRE(table.SaveSnapshot(path));
+
+    TranspositionTable loaded(2, false);
+    REQUIRE(loaded.LoadSnapshot(path, true));
+    REQUIRE(loaded.SizeInBytes() == table.SizeInBytes());
+    TableEntry entry;
+    REQUIRE(loaded.Probe(0x123456789ABCDEFULL, entry));
+    REQUIRE(entry.move == move);
+    REQUIRE(entry.depth == 7);
+
+    // Stores go to memory, not to the file
+    loaded.Clear();
+    TranspositionTable again(1, false);
+    REQUIRE(again.LoadSnapshot(path));
+    REQUIRE(again.Probe(0x123456789ABCDEFULL, entry));
+
+    // A damaged slot is only caught by verifying, or by its key check
+    Overwrite(path, SNAPSHOT_HEADER_BYTES + (0x123456789ABCDEFULL & (table.SizeInBytes() / 16 - 1)) * 16 + 8, 0x55);
+    REQUIRE_FALSE(again.LoadSnapshot(path, true));
+    REQUIRE(again.LoadSnapshot(path));
+    REQUIRE_FALSE(again.Probe(0x123456789ABCDEFULL, entry));
+
+    // A damaged header never loads, and the table stays as it was
+    Overwrite(path, 20, 0x55);
+    REQUIRE_FALSE(loaded.LoadSnapshot(path));
+    REQUIRE(loaded.SizeInBytes() == table.SizeInBytes());
+    REQUIRE_FALSE(loaded.LoadSnapshot("neptune-missing.snap"));
+  }
+
+#ifndef _WIN32
+  SECTION("Shared between processes") {
+    std::string name = "/neptune-test-" + std::to_string(getpid());
+    TranspositionTable first(1, false);
+    REQUIRE(first.AttachShared(name, 2));
+    REQUIRE(first.AttachedProcesses() == 1);
+    first.Store(0x123456789ABCDEFULL, move, -35, 7, BOUND_LOWER);
+
+    // A second process asks for another size and gets the table as it is,
+    // sees what the first stored and stores something of its own
+    pid_t child = fork();
+    if (child == 0) {
+      TranspositionTable second(1, false);
+      TableEntry entry;
+      bool seen = second.AttachShared(name, 8) && second.SizeInBytes() == first.SizeInBytes()
+                  && second.AttachedProcesses() == 2 && second.Probe(0x123456789ABCDEFULL, entry)
+                  && entry.move == move && entry.depth == 7;
+      second.Store(0xFEDCBA9876543210ULL, Move(52, 36), 12, 3, BOUND_EXACT);
+      second.Resize(1, false);
+      _exit(seen ? 0 : 1);
+    }
+    int status = 0;
+    REQUIRE(waitpid(child, &status, 0) == child);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+    REQUIRE(first.AttachedProcesses() == 1);
+
+    TableEntry entry;
+    REQUIRE(first.Probe(0xFEDCBA9876543210ULL, entry));
+    REQUIRE(entry.move == Move(52, 36));
+    REQUIRE(entry.bound == BOUND_EXACT);
+
+    // The last one out removes the segment
+    first.Resize(1, false);
+    REQUIRE_FALSE(first.IsShared());
+    REQUIRE(shm_open(name.c_str(), O_RDWR, 0) == -1);
+  }
+
+  SECTION("Attaching while others detach") {
+    // Processes attach and detach at once, often leaving the segment with no
+    // one attached. A table attached by name must always be the one a table
+    // already attached by that name uses.
+    std::string name = "/neptune-test-churn-" + std::to_string(getpid());
+    std::vector<pid_t> children;
+    for (int i = 0; i < 4; ++i) {
+      pid_t child = fork();
+      if (child == 0) {
+        bool shared = true;
+        for (int round = 0; round < 300 && shared; ++round) {
+          uint64_t key = i * 1000 + round + 1;
+          TranspositionTable held(1, false), joined(1, false);
+          TableEntry entry;
+          shared = held.AttachShared(name, 1);
+          held.Store(key, move, round, 5, BOUND_EXACT);
+          shared = shared && joined.AttachShared(name, 1) && joined.Probe(key, entry) && entry.score == round;
+        }
+        _exit(shared ? 0 : 1);
+      }
+      children.push_back(child);
+    }
+    for (pid_t child : children) {
+      int status = 0;
+      REQUIRE(waitpid(child, &status, 0) == child);
+      REQUIRE(WIFEXITED(status));
+      REQUIRE(WEXITSTATUS(status) == 0);
+    }
+    REQUIRE(shm_open(name.c_str(), O_RDWR, 0) == -1);
+  }
+#endif
+}
@@ -0,0 +1,25 @@
+#include "Neptune/Tuning.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("Tuning") {
+  Board board;
+  board.Reset();
+  board.InitMoves();
+
+  double parameters[TUNING_PARAMETERS];
+  GetEvalParameters(parameters);
+
+  SECTION("Linear evaluation matches EvaluateBoard") {
+    const char *moves[] = {"e2e4", "d7d5", "e4d5", "g8f6", "f1b5", "c7c6", "d5c6", "d8d2", "b1d2", "b7c6"};
+    int color = WHITE;
+    for (const char *move : moves) {
+      board.MakeMove(Move::FromAlgebraicNotation(move), color);
+      color = !color;
+
+      TuningFeature features[MAX_TUNING_FEATURES];
+      int count = ExtractFeatures(PackedPosition::FromBoard(board, color), features);
+      REQUIRE(LinearEvaluate(features, count, parameters) == board.EvaluateBoard());
+    }
+  }
+}
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Neptune/Trace.hpp"
+
+struct TraceSettings {
+  std::string path;
+  bool folded = false;
+  int maxPly = 8;
+};
+
+void PrintUsage() {
+  std::cout << "Usage: NeptuneTrace <trace file> [options]\n"
+               "  -folded          one line per path, \"depth 9;e2e4;e7e5 <nodes>\", for flame graph tools\n"
+               "  -maxply <n>      longest path -folded writes, deeper nodes count for their ancestor (default 8)\n"
+               "Without -folded prints a summary: nodes per ply and how nodes ended.\n"
+               "Traces come from an engine built with NP_TRACE=1, see the TraceFile option.\n";
+}
+
+bool ParseArguments(int argc, char **argv, TraceSettings &settings) {
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    bool hasValue = i + 1 < argc;
+
+    if (argument == "-folded") {
+      settings.folded = true;
+    } else if (argument == "-maxply" && hasValue) {
+      settings.maxPly = std::max(1, std::atoi(argv[++i]));
+    } else if (argument[0] != '-' && settings.path.empty()) {
+      settings.path = argument;
+    } else {
+      PrintUsage();
+      return false;
+    }
+  }
+  if (settings.path.empty()) {
+    PrintUsage();
+    return false;
+  }
+  return true;
+}
+
+static std::string MoveName(uint16_t move) {
+  return move ? UnpackTraceMove(move).ToAlgebraicNotation() : "null";
+}
+
+static bool IsNode(uint8_t kind) {
+  return kind == TRACE_ITERATION || kind == TRACE_NODE || kind == TRACE_QUIESCENCE;
+}
+
+// What one thread was doing when its last event was read
+struct ThreadState {
+  std::vector<std::string> path;  // by ply, for -folded
+  std::vector<int> children;      // nodes entered below each ply so far
+};
+
+int main(int argc, char **argv) {
+  TraceSettings settings;
+  if (!ParseArguments(argc, argv, settings)) {
+    return 1;
+  }
+
+  std::unordered_map<uint32_t, ThreadState> threads;
+  uint64_t events = 0, dropped = 0;
+  uint64_t kinds[TRACE_KIND_COUNT] = {};
+  std::vector<uint64_t> nodesByPly(256, 0), quiescenceByPly(256, 0);
+  uint64_t cutoffs = 0, firstMoveCutoffs = 0;
+  int deepest = 0;
+  std::map<std::string, uint64_t> folded;
+
+  auto visit = [&](uint32_t thread, const TraceEvent &event) {
+    events++;
+    if (event.kind >= TRACE_KIND_COUNT) {
+      return;
+    }
+    kinds[event.kind]++;
+
+    ThreadState &state = threads[thread];
+    int ply = event.ply;
+    if (IsNode(event.kind)) {
+      (event.kind == TRACE_QUIESCENCE ? quiescenceByPly : nodesByPly)[ply]++;
+      if (event.kind == TRACE_ITERATION) {
+        deepest = std::max<int>(deepest, event.depth);
+      }
+
+      // Dropped events can leave gaps, the ply puts the node back in place
+      state.children.resize(ply + 1);
+      state.children[ply] = 0;
+      if (ply > 0) {
+        state.children[ply - 1]++;
+      }
+
+      if (settings.folded) {
+        state.path.resize(ply, "?");
+        state.path.push_back(event.kind == TRACE_ITERATION ? "depth " + std::to_string(event.depth) : MoveName(event.move));
+        std::string key;
+        for (int i = 0; i <= std::min(ply, settings.maxPly); ++i) {
+          key += (i ? ";" : "") + state.path[i];
+        }
+        folded[key]++;
+      }
+    } else if (event.kind == TRACE_FAIL_HIGH && ply < static_cast<int>(state.children.size())) {
+      cutoffs++;
+      firstMoveCutoffs += state.children[ply] == 1;
+    }
+  };
+
+  if (!ReadTrace(settings.path, visit, dropped)) {
+    std::cerr << "Can't read a trace from " << settings.path << std::endl;
+    return 1;
+  }
+
+  if (settings.folded) {
+    for (const auto &[path, nodes] : folded) {
+      std::cout << path << " " << nodes << "\n";
+    }
+    return 0;
+  }
+
+  uint64_t nodes = kinds[TRACE_NODE] + kinds[TRACE_QUIESCENCE];
+
+  std::cout << "Threads: " << threads.size() << "\n";
+  std::cout << "Events: " << events << ", dropped " << dropped << "\n";
+  std::cout << "Iterations: " << kinds[TRACE_ITERATION] << ", deepest " << deepest << "\n";
+  std::cout << "Nodes: " << nodes << ", quiescence " << kinds[TRACE_QUIESCENCE] << "\n";
+  if (cutoffs) {
+    std::cout << "Fail highs on the first move: " << std::fixed << std::setprecision(1)
+              << 100.0 * firstMoveCutoffs / cutoffs << "%\n";
+  }
+
+  std::cout << "\nPly        Nodes   Quiescence\n";
+  for (int ply = 0; ply < 256; ++ply) {
+    if (nodesByPly[ply] || quiescenceByPly[ply]) {
+      std::cout << std::setw(3) << ply << std::setw(13) << nodesByPly[ply] << std::setw(13) << quiescenceByPly[ply] << "\n";
+    }
+  }
+
+  std::cout << "\nEnded by                Nodes\n";
+  for (int kind = TRACE_FAIL_HIGH; kind < TRACE_KIND_COUNT; ++kind) {
+    if (kinds[kind]) {
+      std::cout << std::left << std::setw(18) << TraceKindName(static_cast<TraceKind>(kind)) << std::right
+                << std::setw(13) << kinds[kind] << std::setw(7) << std::fixed << std::setprecision(1)
+                << 100.0 * kinds[kind] / std::max<uint64_t>(nodes, 1) << "%\n";
+    }
+  }
+  return 0;
+}
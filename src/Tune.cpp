@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Neptune/Tuning.hpp"
+
+struct TuneSettings {
+  std::string data;
+  std::string output = "EvalParams.hpp";
+  int epochs = 300;
+  double learningRate = 1.0;
+  double lambda = 0.0;  // weight of the search score against the game result
+  double k = 0.0;       // sigmoid scale, fitted to the data when 0
+  int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+};
+
+// The training positions, mapped read-only or read in whole where there is no mmap
+class PositionFile {
+public:
+  bool Open(const std::string &path) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+      return false;
+    }
+    struct stat info;
+    fstat(fd, &info);
+    size = info.st_size;
+    void *mapped = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+      return false;
+    }
+    // Every record is read once per pass, front to back
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    positions = static_cast<const PackedPosition *>(mapped);
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+      return false;
+    }
+    size = file.tellg();
+    buffer.resize(size / sizeof(PackedPosition));
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(buffer.data()), buffer.size() * sizeof(PackedPosition));
+    positions = buffer.data();
+#endif
+    count = size / sizeof(PackedPosition);
+    return count > 0;
+  }
+
+  const PackedPosition *positions = nullptr;
+  size_t count = 0;
+
+private:
+  size_t size = 0;
+#ifdef _WIN32
+  std::vector<PackedPosition> buffer;
+#endif
+};
+
+void PrintUsage() {
+  std::cout << "Usage: NeptuneTune -data <file> [options]\n"
+               "  -data <file>      packed positions, as written by NeptuneDatagen\n"
+               "  -output <file>    parameter header to write (default EvalParams.hpp)\n"
+               "  -epochs <n>       gradient descent steps (default 300)\n"
+               "  -rate <x>         learning rate (default 1.0)\n"
+               "  -lambda <x>       how much the search score counts against the result (default 0)\n"
+               "  -k <x>            sigmoid scale (default: fitted to the data)\n"
+               "  -threads <n>      threads (default: all cores)\n";
+}
+
+bool ParseArguments(int argc, char **argv, TuneSettings &settings) {
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    bool hasValue = i + 1 < argc;
+
+    if (argument == "-data" && hasValue) {
+      settings.data = argv[++i];
+    } else if (argument == "-output" && hasValue) {
+      settings.output = argv[++i];
+    } else if (argument == "-epochs" && hasValue) {
+      settings.epochs = std::atoi(argv[++i]);
+    } else if (argument == "-rate" && hasValue) {
+      settings.learningRate = std::atof(argv[++i]);
+    } else if (argument == "-lambda" && hasValue) {
+      settings.lambda = std::atof(argv[++i]);
+    } else if (argument == "-k" && hasValue) {
+      settings.k = std::atof(argv[++i]);
+    } else if (argument == "-threads" && hasValue) {
+      settings.threads = std::max(1, std::atoi(argv[++i]));
+    } else {
+      PrintUsage();
+      return false;
+    }
+  }
+
+  if (settings.data.empty()) {
+    PrintUsage();
+    return false;
+  }
+  return true;
+}
+
+// Expected score for white from an evaluation
+inline double Sigmoid(double k, double eval) {
+  return 1.0 / (1.0 + std::pow(10.0, -k * eval / 400.0));
+}
+
+class Tuner {
+public:
+  Tuner(const PositionFile &file, const TuneSettings &settings) : file(file), settings(settings) {}
+
+  // Mean squared error of the predictions, adding the error gradient to gradient when given
+  double Pass(const double *parameters, double k, double *gradient) {
+    int threadCount = settings.threads;
+    std::vector<double> errors(threadCount, 0.0);
+    std::vector<std::vector<double>> gradients(gradient ? threadCount : 0, std::vector<double>(TUNING_PARAMETERS, 0.0));
+
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < threadCount; ++thread) {
+      threads.emplace_back([&, thread]() {
+        size_t begin = file.count * thread / threadCount;
+        size_t end = file.count * (thread + 1) / threadCount;
+        double *threadGradient = gradient ? gradients[thread].data() : nullptr;
+        TuningFeature features[MAX_TUNING_FEATURES];
+        double error = 0.0;
+
+        for (size_t i = begin; i < end; ++i) {
+          const PackedPosition &position = file.positions[i];
+          int count = ExtractFeatures(position, features);
+
+          double predicted = Sigmoid(k, LinearEvaluate(features, count, parameters));
+          double target = (1.0 - settings.lambda) * (position.result + 1) / 2.0
+                          + settings.lambda * Sigmoid(k, position.score);
+          double difference = predicted - target;
+          error += difference * difference;
+
+          if (threadGradient) {
+            // d(difference^2)/d(eval), every feature adds its sign times that
+            double slope = 2.0 * difference * predicted * (1.0 - predicted) * k * std::log(10.0) / 400.0;
+            for (int f = 0; f < count; ++f) {
+              threadGradient[features[f].index] += features[f].sign * slope;
+            }
+          }
+        }
+        errors[thread] = error;
+      });
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+
+    double error = 0.0;
+    for (int thread = 0; thread < threadCount; ++thread) {
+      error += errors[thread];
+      if (gradient) {
+        for (int p = 0; p < TUNING_PARAMETERS; ++p) {
+          gradient[p] += gradients[thread][p] / file.count;
+        }
+      }
+    }
+    return error / file.count;
+  }
+
+  // Golden section search for the scale that best fits the current evaluation
+  double FitK(const double *parameters) {
+    const double ratio = (std::sqrt(5.0) - 1.0) / 2.0;
+    double low = 0.0, high = 10.0;
+    for (int iteration = 0; iteration < 30; ++iteration) {
+      double left = high - ratio * (high - low);
+      double right = low + ratio * (high - low);
+      if (Pass(parameters, left, nullptr) < Pass(parameters, right, nullptr)) {
+        high = right;
+      } else {
+        low = left;
+      }
+    }
+    return (low + high) / 2.0;
+  }
+
+private:
+  const PositionFile &file;
+  const TuneSettings &settings;
+};
+
+void WriteTable(std::ofstream &output, const char *name, const double *values) {
+  output << "const int " << name << "[64] = {\n";
+  for (int row = 0; row < 8; ++row) {
+    output << " ";
+    for (int column = 0; column < 8; ++column) {
+      int index = row * 8 + column;
+      output << std::setw(4) << std::lround(values[index]) << (index < 63 ? "," : "");
+    }
+    output << "\n";
+  }
+  output << "};\n\n";
+}
+
+bool WriteParameters(const std::string &path, const double *parameters, size_t positions) {
+  std::ofstream output(path);
+  if (!output) {
+    return false;
+  }
+
+  output << "#ifndef NP_EVAL_PARAMS_HPP\n"
+            "#define NP_EVAL_PARAMS_HPP\n\n"
+            "// Evaluation parameters, in EvaluateBoard units. NeptuneTune writes this file,\n"
+            "// keep the layout when editing it by hand.\n"
+            "// Tuned on " << positions << " positions.\n\n";
+
+  output << "const int materialValues[6] = {";
+  for (int pieceType = PAWN; pieceType <= KING; ++pieceType) {
+    output << std::lround(parameters[TUNING_MATERIAL + pieceType]) << (pieceType < KING ? ", " : "");
+  }
+  output << "};\n\n";
+
+  const char *names[6] = {"pawnTable", "knightTable", "bishopTable", "rookTable", "queenTable", "kingTable"};
+  for (int pieceType = PAWN; pieceType <= KING; ++pieceType) {
+    WriteTable(output, names[pieceType], parameters + TUNING_TABLES + pieceType * 64);
+  }
+
+  output << "#endif // NP_EVAL_PARAMS_HPP\n";
+  return true;
+}
+
+int main(int argc, char **argv) {
+  TuneSettings settings;
+  if (!ParseArguments(argc, argv, settings)) {
+    return 1;
+  }
+
+  PositionFile file;
+  if (!file.Open(settings.data)) {
+    std::cerr << "Can't read positions from " << settings.data << std::endl;
+    return 1;
+  }
+  std::cout << "Positions: " << file.count << std::endl;
+
+  std::vector<double> parameters(TUNING_PARAMETERS);
+  GetEvalParameters(parameters.data());
+
+  Tuner tuner(file, settings);
+  double k = settings.k ? settings.k : tuner.FitK(parameters.data());
+  std::cout << "K: " << k << " Error: " << tuner.Pass(parameters.data(), k, nullptr) << std::endl;
+
+  // Adam, so parameters that rarely show up (pawns on the last ranks) still move
+  const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+  std::vector<double> gradient(TUNING_PARAMETERS);
+  std::vector<double> momentum(TUNING_PARAMETERS, 0.0);
+  std::vector<double> velocity(TUNING_PARAMETERS, 0.0);
+
+  for (int epoch = 1; epoch <= settings.epochs; ++epoch) {
+    std::fill(gradient.begin(), gradient.end(), 0.0);
+    double error = tuner.Pass(parameters.data(), k, gradient.data());
+
+    for (int p = 0; p < TUNING_PARAMETERS; ++p) {
+      // The kings always cancel out, their value only anchors the scale
+      if (p == TUNING_MATERIAL + KING) {
+        continue;
+      }
+      momentum[p] = beta1 * momentum[p] + (1.0 - beta1) * gradient[p];
+      velocity[p] = beta2 * velocity[p] + (1.0 - beta2) * gradient[p] * gradient[p];
+      double correctedMomentum = momentum[p] / (1.0 - std::pow(beta1, epoch));
+      double correctedVelocity = velocity[p] / (1.0 - std::pow(beta2, epoch));
+      parameters[p] -= settings.learningRate * correctedMomentum / (std::sqrt(correctedVelocity) + epsilon);
+    }
+
+    if (epoch % 10 == 0 || epoch == settings.epochs) {
+      std::cout << "Epoch " << epoch << " Error: " << std::setprecision(8) << error << std::endl;
+    }
+  }
+
+  if (!WriteParameters(settings.output, parameters.data(), file.count)) {
+    std::cerr << "Can't write " << settings.output << std::endl;
+    return 1;
+  }
+  std::cout << "Wrote " << settings.output << std::endl;
+  return 0;
+}